@@ -4,6 +4,8 @@
 #include <atomic>
 
 #include "bit_vector.h"
+#include "component.h"
+#include "wire.h"
 
 template <int N>
 class Adder : public Component {
@@ -50,11 +52,19 @@ public:
         }
     }
 
+    std::vector<Port*> get_inputs() override { return {&A, &B, &Cin}; }
+    std::vector<Net*> get_outwires() override {
+        if (Cout != nullptr)
+            return {outwire, Cout};
+        return {outwire};
+    }
+    Operation get_operation() const override { return Operation::Add; }
+
 private:
     Wire<N> *outwire;
     Wire<1> *Cout;
     std::atomic_int set_count = 0;
-    BitVector<N+1> const MASK = static_cast<BitVector<N+1>>((1 << N) - 1);
+    BitVector<N+1> const MASK{bitmask<N>()};
 };
 
 #endif  // ADDER_H_
@@ -0,0 +1,318 @@
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <functional>
+#include <stdexcept>
+
+#include "assertion.h"
+
+using namespace std;
+
+AssertionSet::AssertionSet(unordered_map<string, WatchSignal> const &names): names{names} {}
+
+AssertionSet::AssertionSet(Simulator const &simulator, unordered_map<string, WatchSignal> const &names):
+    names{names}, program{simulator.get_shared_program()} {}
+
+size_t AssertionSet::add_condition(string const &expression) {
+    auto it = condition_indices.find(expression);
+    if (it != condition_indices.end())
+        return it->second;
+    conditions.push_back({Watch{expression, names}, false, {}, 0});
+    condition_indices.emplace(expression, conditions.size() - 1);
+    return conditions.size() - 1;
+}
+
+size_t AssertionSet::add(string const &name, string const &antecedent, string const &consequent,
+        unsigned min_delay, unsigned max_delay) {
+    if (compiled)
+        throw runtime_error(name + ": assertions are added before the first sample");
+    if (min_delay > max_delay || max_delay > MAX_DELAY)
+        throw runtime_error(name + ": the window is 0 <= min <= max <= " + to_string(MAX_DELAY) + " cycles");
+    assertions.push_back({name, add_condition(antecedent), add_condition(consequent), min_delay, max_delay});
+    return assertions.size() - 1;
+}
+
+size_t AssertionSet::add_always(string const &name, string const &condition) {
+    return add(name, "1", condition, 0, 0);
+}
+
+size_t AssertionSet::add_never(string const &name, string const &condition) {
+    return add(name, "1", "!(" + condition + ")", 0, 0);
+}
+
+void AssertionSet::compile() {
+    // Every signal once, the constants after them
+    map<pair<Net const*, Clockable const*>, uint32_t> signal_indices{};
+    for (Condition const &condition : conditions) {
+        for (WatchSignal const &signal : condition.watch.get_signals()) {
+            if (signal_indices.emplace(make_pair(signal.net, signal.clockable), signals.size()).second)
+                signals.push_back(signal);
+        }
+    }
+    // The width of a register is only known in a Simulator
+    vector<int> widths{};
+    for (WatchSignal const &signal : signals) {
+        if (!program) {
+            widths.push_back(signal.net ? signal.net->get_width() : 64);
+        } else if (signal.net != nullptr) {
+            auto it = program->net_slots.find(signal.net);
+            if (it == program->net_slots.end())
+                throw runtime_error(signal.net->get_name() + " is not in the program");
+            locations.push_back(it->second);
+            widths.push_back(it->second.width);
+        } else {
+            auto it = program->state_slots.find(signal.clockable);
+            if (it == program->state_slots.end())
+                throw runtime_error("A register of the assertions is not in the program");
+            locations.push_back(it->second);
+            widths.push_back(it->second.width);
+        }
+    }
+    values.resize(signals.size());
+    auto signal_index = [&](Condition const &condition, uint64_t signal) {
+        WatchSignal const &watched = condition.watch.get_signals()[signal];
+        return signal_indices.at(make_pair(watched.net, watched.clockable));
+    };
+    map<uint64_t, uint32_t> constant_indices{};
+    auto operand = [&](Condition const &condition, bool is_signal, uint64_t value) -> uint32_t {
+        if (is_signal)
+            return signal_index(condition, value);
+        auto it = constant_indices.emplace(value, values.size()).first;
+        if (it->second == values.size())
+            values.push_back(value);
+        return it->second;
+    };
+    auto is_table = [&](Condition const &condition) {
+        return condition.watch.get_signals().size() == 1 && widths[signal_index(condition, 0)] <= TABLE_BITS;
+    };
+    vector<bool> generic_signal(signals.size(), false);
+    for (Condition &condition : conditions) {
+        condition.generic = !condition.watch.get_signals().empty() && !is_table(condition);
+        for (size_t i = 0; condition.generic && i < condition.watch.get_signals().size(); ++i) {
+            generic_signal[signal_index(condition, i)] = true;
+        }
+    }
+    for (uint32_t i = 0; i < signals.size(); ++i) {
+        if (generic_signal[i])
+            generic_signals.push_back(i);
+    }
+
+    // Every distinct compare of the generic conditions once, the results of
+    // each operator together
+    atoms.resize(static_cast<size_t>(Watch::Op::GreaterEqual) + 1);
+    map<tuple<Watch::Op, uint32_t, uint32_t>, uint32_t> distinct{};
+    for (Condition &condition : conditions) {
+        if (!condition.generic)
+            continue;
+        for (Watch::Compare const &compare : condition.watch.compares) {
+            uint32_t const left = operand(condition, compare.left_signal, compare.left);
+            uint32_t const right = operand(condition, compare.right_signal, compare.right);
+            Atoms &group = atoms[static_cast<size_t>(compare.op)];
+            auto it = distinct.emplace(make_tuple(compare.op, left, right), group.left.size()).first;
+            if (it->second == group.left.size()) {
+                group.left.push_back(left);
+                group.right.push_back(right);
+            }
+            condition.atoms.push_back(it->second);
+        }
+    }
+    uint32_t size = 0;
+    for (Atoms &group : atoms) {
+        group.first = size;
+        size += static_cast<uint32_t>(group.left.size());
+    }
+    // A single compare is its own result
+    for (size_t c = 0; c < conditions.size(); ++c) {
+        Condition &condition = conditions[c];
+        if (!condition.generic)
+            continue;
+        for (size_t i = 0; i < condition.atoms.size(); ++i) {
+            condition.atoms[i] += atoms[static_cast<size_t>(condition.watch.compares[i].op)].first;
+        }
+        if (condition.watch.steps.size() == 1) {
+            condition.result = condition.atoms[0];
+        } else {
+            condition.result = size++;
+            combined.push_back(static_cast<uint32_t>(c));
+        }
+    }
+    results.resize(size);
+
+    words = (assertions.size() + 63) / 64;
+    constant_chunks.assign(words * 64 / LANE, 0);
+    chunks.assign(words * 64 / LANE, 0);
+    map<pair<uint32_t, size_t>, size_t> lane_indices{};
+    for (size_t i = 0; i < assertions.size(); ++i) {
+        uint8_t const bit = static_cast<uint8_t>(1 << (i % LANE));
+        for (size_t side = 0; side < 2; ++side) {
+            Condition const &condition =
+                conditions[(side == 0) ? assertions[i].antecedent : assertions[i].consequent];
+            vector<Generic> &generic = (side == 0) ? generic_antecedents : generic_consequents;
+            if (condition.generic) {
+                generic.push_back({static_cast<uint32_t>(i), condition.result});
+            } else if (condition.watch.get_signals().empty()) {
+                if (condition.watch.evaluate(nullptr))
+                    constant_chunks[i / LANE] |= static_cast<uint8_t>(bit << (LANE * side));
+            } else {
+                uint32_t const signal = signal_index(condition, 0);
+                auto it = lane_indices.find({signal, i / LANE});
+                if (it == lane_indices.end()) {
+                    it = lane_indices.emplace(make_pair(signal, i / LANE), lanes.size()).first;
+                    lanes.push_back({static_cast<uint32_t>(tables.size()), signal, static_cast<uint32_t>(i / LANE),
+                        program ? locations[signal] : Location{}});
+                    tables.resize(tables.size() + (size_t{1} << widths[signal]), 0);
+                }
+                uint8_t *table = &tables[lanes[it->second].table];
+                for (uint64_t value = 0; value < (uint64_t{1} << widths[signal]); ++value) {
+                    if (condition.watch.evaluate(&value))
+                        table[value] |= static_cast<uint8_t>(bit << (LANE * side));
+                }
+            }
+        }
+    }
+
+    ages = 1;
+    for (Assertion const &assertion : assertions) {
+        ages = max(ages, assertion.max_delay + 1);
+    }
+    antecedents.assign(words, 0);
+    consequents.assign(words, 0);
+    windows.assign(ages * words, 0);
+    expiring.assign(ages * words, 0);
+    pending.assign(ages * words, 0);
+    for (size_t i = 0; i < assertions.size(); ++i) {
+        uint64_t const bit = uint64_t{1} << (i % 64);
+        for (unsigned age = assertions[i].min_delay; age <= assertions[i].max_delay; ++age) {
+            windows[age * words + i / 64] |= bit;
+        }
+        expiring[assertions[i].max_delay * words + i / 64] |= bit;
+    }
+    compiled = true;
+}
+
+// The low nibbles of 8 bytes, next to each other. A chunk holds a nibble of
+// antecedents and one of consequents.
+static_assert(AssertionSet::LANE == 4, "Chunks are unpacked as nibbles");
+static uint64_t low_nibbles(uint64_t bytes) {
+    bytes &= 0x0f0f0f0f0f0f0f0f;
+    bytes = (bytes | (bytes >> 4)) & 0x00ff00ff00ff00ff;
+    bytes = (bytes | (bytes >> 8)) & 0x0000ffff0000ffff;
+    return (bytes | (bytes >> 16)) & 0xffffffff;
+}
+
+// One tight loop per operator, over the compares with it
+template <typename Compare>
+static void evaluate_atoms(uint32_t const *left, uint32_t const *right, size_t count,
+        uint64_t const *values, uint8_t *results, Compare compare) {
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = compare(values[left[i]], values[right[i]]);
+    }
+}
+
+template <typename Read>
+void AssertionSet::step(uint64_t cycle, Read const &read) {
+    uint8_t *out = results.data();
+    auto evaluate = [&](Watch::Op op, auto compare) {
+        Atoms const &group = atoms[static_cast<size_t>(op)];
+        evaluate_atoms(group.left.data(), group.right.data(), group.left.size(), values.data(),
+            out + group.first, compare);
+    };
+    evaluate(Watch::Op::Equal, equal_to<uint64_t>{});
+    evaluate(Watch::Op::NotEqual, not_equal_to<uint64_t>{});
+    evaluate(Watch::Op::Less, less<uint64_t>{});
+    evaluate(Watch::Op::LessEqual, less_equal<uint64_t>{});
+    evaluate(Watch::Op::Greater, greater<uint64_t>{});
+    evaluate(Watch::Op::GreaterEqual, greater_equal<uint64_t>{});
+
+    // As Watch::evaluate(), with the compares already done
+    for (uint32_t c : combined) {
+        Condition const &condition = conditions[c];
+        uint64_t stack = 0;
+        for (Watch::Step const &step : condition.watch.steps) {
+            if (step.compare != NO_SLOT) {
+                stack = (stack << 1) | out[condition.atoms[step.compare]];
+            } else if (step.op == Watch::Op::Not) {
+                stack ^= 1;
+            } else {
+                uint64_t const b = stack & 1;
+                stack >>= 1;
+                uint64_t const a = stack & 1;
+                stack = (stack & ~uint64_t{1}) | ((step.op == Watch::Op::And) ? (a & b) : (a | b));
+            }
+        }
+        out[condition.result] = stack & 1;
+    }
+
+    copy(constant_chunks.begin(), constant_chunks.end(), chunks.begin());
+    for (Lane const &lane : lanes) {
+        chunks[lane.chunk] |= tables[lane.table + read(lane)];
+    }
+    for (size_t word = 0; word < words; ++word) {
+        uint64_t low, high;
+        memcpy(&low, &chunks[word * 64 / LANE], sizeof(low));
+        memcpy(&high, &chunks[word * 64 / LANE + 8], sizeof(high));
+        antecedents[word] = low_nibbles(low) | (low_nibbles(high) << 32);
+        consequents[word] = low_nibbles(low >> LANE) | (low_nibbles(high >> LANE) << 32);
+    }
+    for (Generic const &generic : generic_antecedents) {
+        antecedents[generic.assertion / 64] |= uint64_t{out[generic.result]} << (generic.assertion % 64);
+    }
+    for (Generic const &generic : generic_consequents) {
+        consequents[generic.assertion / 64] |= uint64_t{out[generic.result]} << (generic.assertion % 64);
+    }
+
+    // Age 0 is in slot head, age k in slot head - k
+    head = (head + 1 == ages) ? 0 : head + 1;
+    for (size_t word = 0; word < words; ++word) {
+        pending[head * words + word] = antecedents[word];
+    }
+    for (size_t word = 0; word < words; ++word) {
+        uint64_t const discharged = consequents[word];
+        unsigned slot = head;
+        for (unsigned age = 0; age < ages; ++age, slot = (slot == 0) ? ages - 1 : slot - 1) {
+            uint64_t &obligations = pending[slot * words + word];
+            if (obligations == 0)
+                continue;
+            obligations &= ~(discharged & windows[age * words + word]);
+            uint64_t expired = obligations & expiring[age * words + word];
+            obligations &= ~expired;
+            while (expired != 0) {
+                int const bit = __builtin_ctzll(expired);
+                failures.push_back({word * 64 + bit, cycle - age, cycle});
+                expired &= expired - 1;
+            }
+        }
+    }
+}
+
+void AssertionSet::sample(uint64_t cycle) {
+    if (program)
+        throw runtime_error("The assertions are of a Simulator");
+    if (!compiled)
+        compile();
+    for (size_t i = 0; i < signals.size(); ++i) {
+        values[i] = signals[i].net ? signals[i].net->get_raw() : signals[i].clockable->get_raw_state();
+    }
+    step(cycle, [this](Lane const &lane) { return values[lane.signal]; });
+}
+
+void AssertionSet::sample(Simulator const &simulator) {
+    if (simulator.get_shared_program() != program)
+        throw runtime_error("The assertions are not of this Simulator");
+    if (!compiled)
+        compile();
+    // The tables read their signals themselves
+    for (uint32_t i : generic_signals) {
+        values[i] = simulator.read(locations[i]);
+    }
+    step(simulator.get_cycle(), [&simulator](Lane const &lane) { return simulator.read(lane.location); });
+}
+
+size_t AssertionSet::get_pending() const {
+    size_t count = 0;
+    for (uint64_t obligations : pending) {
+        count += __builtin_popcountll(obligations);
+    }
+    return count;
+}
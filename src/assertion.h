@@ -0,0 +1,157 @@
+#ifndef ASSERTION_H_
+#define ASSERTION_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include "program.h"
+#include "simulator.h"
+#include "watch.h"
+
+/* Temporal assertions over nets and registers, checked every cycle.
+ *
+ * An assertion "antecedent |-> ##[min:max] consequent" says that whenever
+ * the antecedent holds, the consequent holds between min and max cycles
+ * later. Conditions are Watch expressions:
+ *
+ *   AssertionSet assertions{simulator, {{"req", &req}, {"ack", &ack}}};
+ *   assertions.add("ack", "req == 1", "ack == 1", 1, 4);
+ *   assertions.add_never("overflow", "count == 255");
+ *   for (...) {
+ *       simulator.clock();
+ *       assertions.sample(simulator);
+ *   }
+ *   for (AssertionFailure const &failure : assertions.get_failures()) ...
+ *
+ * Each assertion is a shift register of the obligations started in the last
+ * max + 1 cycles. The registers are kept transposed, one bit vector over all
+ * assertions for every age, so moving the obligations on, discharging those
+ * in their window and finding the expired ones takes a few word operations
+ * per age for all the assertions at once.
+ *
+ * The conditions are turned into those bit vectors without a compare per
+ * assertion where possible: a condition of one signal of at most TABLE_BITS
+ * bits is a table by the value of the signal, whose entry holds the bits of
+ * LANE assertions, so one lookup per signal and LANE assertions fills in their
+ * antecedents and consequents. Other conditions evaluate each distinct
+ * compare once, in one loop per operator.
+ */
+
+struct AssertionFailure {
+    size_t assertion;
+    uint64_t start;  // Cycle the antecedent held
+    uint64_t cycle;  // Cycle the window ended
+};
+
+class AssertionSet {
+public:
+    static unsigned const MAX_DELAY = 63;
+    static int const TABLE_BITS = 8;
+    // Assertions of a table entry, a byte keeps the tables in the L1 cache
+    static size_t const LANE = 4;
+
+    // Assertions of a design run by a Clock
+    AssertionSet(std::unordered_map<std::string, WatchSignal> const &names);
+    // Assertions of the values in a Simulator
+    AssertionSet(Simulator const &simulator, std::unordered_map<std::string, WatchSignal> const &names);
+    AssertionSet(AssertionSet const &) = delete;
+    AssertionSet &operator=(AssertionSet const &) = delete;
+
+    // Assertions are added before the first sample, returns the index
+    size_t add(std::string const &name, std::string const &antecedent, std::string const &consequent,
+        unsigned min_delay, unsigned max_delay);
+    size_t add_always(std::string const &name, std::string const &condition);
+    size_t add_never(std::string const &name, std::string const &condition);
+
+    // After Clock::clock()
+    void sample(uint64_t cycle);
+    // After Simulator::clock(), at its cycle
+    void sample(Simulator const &simulator);
+
+    std::string const &get_name(size_t assertion) const { return assertions.at(assertion).name; }
+    std::vector<AssertionFailure> const &get_failures() const { return failures; }
+    // Obligations whose window has not ended yet
+    size_t get_pending() const;
+
+private:
+    struct Assertion {
+        std::string name;
+        size_t antecedent;  // Index into conditions
+        size_t consequent;
+        unsigned min_delay;
+        unsigned max_delay;
+    };
+    // A compare of two operands, the values of signals or constants
+    struct Atoms {
+        std::vector<uint32_t> left{};
+        std::vector<uint32_t> right{};
+        uint32_t first{0};  // Index into results of the first compare
+    };
+    struct Condition {
+        Watch watch;
+        bool generic;                 // Not a table or a constant
+        std::vector<uint32_t> atoms;  // Of every compare of the watch
+        uint32_t result;              // Index into results
+    };
+    // The antecedents and consequents of LANE assertions which depend on one
+    // signal, by its value
+    struct Lane {
+        uint32_t table;     // Index into tables
+        uint32_t signal;    // Index into values
+        uint32_t chunk;     // Index into chunks, the assertions over LANE
+        Location location;  // Of the signal, in a Simulator
+    };
+    // An assertion whose condition is generic
+    struct Generic {
+        uint32_t assertion;
+        uint32_t result;  // Index into results
+    };
+
+    size_t add_condition(std::string const &expression);
+    void compile();
+    // read(lane) is the value of the signal of a lane
+    template <typename Read>
+    void step(uint64_t cycle, Read const &read);
+
+    std::unordered_map<std::string, WatchSignal> names;
+    std::shared_ptr<Program const> program{};  // Of a Simulator
+    std::vector<Assertion> assertions{};
+    std::vector<Condition> conditions{};
+    std::unordered_map<std::string, size_t> condition_indices{};
+    bool compiled{false};
+
+    // The signals of all conditions, read once per cycle, then the constants
+    std::vector<WatchSignal> signals{};
+    std::vector<Location> locations{};
+    std::vector<uint64_t> values{};
+    std::vector<uint32_t> generic_signals{};  // Read into values by a Simulator
+    // A condition of one signal of up to TABLE_BITS bits is looked up by value,
+    // for LANE assertions at once
+    std::vector<Lane> lanes{};
+    std::vector<uint8_t> tables{};  // Antecedents in the low LANE bits, consequents in the high
+    std::vector<uint8_t> constant_chunks{};
+    std::vector<uint8_t> chunks{};  // The entries of all lanes, 64 / LANE to a word
+    // Other conditions evaluate every distinct compare once, in a loop per
+    // operator
+    std::vector<Atoms> atoms{};
+    std::vector<uint8_t> results{};  // Of the compares, then of the conditions which combine them
+    std::vector<uint32_t> combined{};
+    std::vector<Generic> generic_antecedents{};
+    std::vector<Generic> generic_consequents{};
+
+    // Bit vectors over the assertions, words of each
+    size_t words{0};
+    unsigned ages{0};
+    std::vector<uint64_t> antecedents{};
+    std::vector<uint64_t> consequents{};
+    std::vector<uint64_t> windows{};   // By age, the assertions which may be discharged
+    std::vector<uint64_t> expiring{};  // By age, the assertions whose window ends
+    std::vector<uint64_t> pending{};   // By slot, a ring of ages
+    unsigned head{0};
+    std::vector<AssertionFailure> failures{};
+};
+
+#endif  // ASSERTION_H_
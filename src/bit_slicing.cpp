@@ -0,0 +1,248 @@
+#include <map>
+#include <algorithm>
+#include <unordered_map>
+
+#include "bit_slicing.h"
+
+using namespace std;
+
+namespace {
+
+// The result of a gate for a, b = 00, 01, 10 and 11
+uint64_t truth_table(Opcode opcode) {
+    switch (opcode) {
+    case Opcode::Not: return 0b0011;
+    case Opcode::And: return 0b1000;
+    case Opcode::Nand: return 0b0111;
+    case Opcode::Or: return 0b1110;
+    case Opcode::Xor: return 0b0110;
+    case Opcode::Nor: return 0b0001;
+    default: return 0;
+    }
+}
+
+class Slicer {
+public:
+    Slicer(Program &program, SliceOptions const &options, SliceStats &stats):
+        program{program}, options{options}, stats{stats} {}
+    void run();
+
+private:
+    Location locate(uint32_t slot) const;
+    uint32_t gather(vector<Location> const &bits);
+    void extract(uint32_t out, uint32_t word, int bit);
+    void pack_registers();
+    void slice_gates();
+
+    Program &program;
+    SliceOptions const &options;
+    SliceStats &stats;
+
+    vector<int> writer{};
+    vector<bool> removed{};
+    vector<Instruction> added{};
+    unordered_map<uint32_t, Location> bits{};                   // Bits moved into words
+    vector<pair<uint32_t, vector<uint32_t>>> registers{};       // Word and next bits
+};
+
+// Where the value of a 1 bit slot can be read
+Location Slicer::locate(uint32_t slot) const {
+    auto it = bits.find(slot);
+    if (it != bits.end())
+        return it->second;
+    int const index = writer[slot];
+    if (index >= 0 && program.code[index].opcode == Opcode::Extract)
+        return {program.code[index].a, static_cast<uint8_t>(program.code[index].b), 1};
+    return {slot, 0, 1};
+}
+
+// Bit i of the result is bits[i], one term per source and distance
+uint32_t Slicer::gather(vector<Location> const &sources) {
+    int const width = sources.size();
+    map<pair<uint32_t, int32_t>, uint64_t> masks{};
+    for (int i = 0; i < width; ++i) {
+        masks[make_pair(sources[i].slot, i - sources[i].shift)] |= uint64_t{1} << i;
+    }
+    if (masks.size() == 1 && masks.begin()->first.second == 0 && program.widths[masks.begin()->first.first] == width)
+        return masks.begin()->first.first;
+
+    uint32_t const first = program.terms.size();
+    for (auto const &mask : masks) {
+        program.terms.push_back({mask.first.first, mask.first.second, mask.second});
+    }
+    stats.terms += masks.size();
+    uint32_t const out = program.add_slot(width);
+    added.push_back({Opcode::Gather, static_cast<uint8_t>(width), out, NO_SLOT, first, static_cast<uint32_t>(masks.size()), first});
+    return out;
+}
+
+void Slicer::extract(uint32_t out, uint32_t word, int bit) {
+    added.push_back({Opcode::Extract, 1, out, NO_SLOT, word, static_cast<uint32_t>(bit), word});
+    bits[out] = {word, static_cast<uint8_t>(bit), 1};
+}
+
+// 1 bit registers are packed in the order they are latched. Their next values
+// are gathered once the gates have been packed.
+void Slicer::pack_registers() {
+    vector<Latch> kept{}, single{};
+    for (Latch const &latch : program.latches) {
+        if (program.widths[latch.state] == 1)
+            single.push_back(latch);
+        else
+            kept.push_back(latch);
+    }
+    if (static_cast<int>(single.size()) < options.min_bits)
+        return;
+
+    for (size_t first = 0; first < single.size(); first += 64) {
+        size_t const last = min(single.size(), first + 64);
+        uint64_t initial = 0;
+        for (size_t i = first; i < last; ++i) {
+            initial |= program.initial[single[i].state] << (i - first);
+        }
+        uint32_t const word = program.add_slot(last - first, initial);
+        vector<uint32_t> next{};
+        for (size_t i = first; i < last; ++i) {
+            extract(single[i].state, word, i - first);
+            next.push_back(single[i].next);
+        }
+        registers.push_back({word, next});
+        stats.registers += last - first;
+    }
+    program.latches = kept;
+}
+
+void Slicer::slice_gates() {
+    // Level of every slot, the code is in order
+    vector<int> level(program.initial.size(), 0);
+    map<int, vector<int>> groups{};
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        Instruction const &ins = program.code[i];
+        int l = 0;
+        for (uint32_t slot : reads(program, ins)) {
+            l = max(l, level[slot] + 1);
+        }
+        for (uint32_t slot : writes(program, ins)) {
+            level[slot] = l;
+        }
+        switch (ins.opcode) {
+        case Opcode::Not:
+        case Opcode::And:
+        case Opcode::Nand:
+        case Opcode::Or:
+        case Opcode::Xor:
+        case Opcode::Nor:
+            if (ins.width == 1)
+                groups[l].push_back(i);
+            break;
+        default:
+            break;
+        }
+    }
+
+    // Groups are in order of level, so the inputs of a group are placed
+    // before it is packed
+    for (auto &group : groups) {
+        vector<int> &members = group.second;
+        if (static_cast<int>(members.size()) < options.min_bits)
+            continue;
+        sort(members.begin(), members.end(), [this](int x, int y) {
+            Location const a = locate(program.code[x].a), b = locate(program.code[y].a);
+            return make_pair(a.slot, a.shift) < make_pair(b.slot, b.shift);
+        });
+
+        for (size_t first = 0; first < members.size(); first += 64) {
+            size_t const last = min(members.size(), first + 64);
+            vector<Location> a{}, b{};
+            for (size_t i = first; i < last; ++i) {
+                a.push_back(locate(program.code[members[i]].a));
+                b.push_back(locate(program.code[members[i]].b));
+            }
+            int const width = last - first;
+            // Gates of one kind are a plain operation, mixed ones a Lut
+            Opcode opcode = program.code[members[first]].opcode;
+            uint64_t masks[4] = {0, 0, 0, 0};
+            for (size_t i = first; i < last; ++i) {
+                Opcode const gate = program.code[members[i]].opcode;
+                for (int m = 0; m < 4; ++m) {
+                    masks[m] |= ((truth_table(gate) >> m) & 1) << (i - first);
+                }
+                if (gate != opcode)
+                    opcode = Opcode::Lut;
+            }
+            uint32_t const word_a = gather(a);
+            uint32_t const word_b = (opcode == Opcode::Not) ? word_a : gather(b);
+            uint32_t const word = program.add_slot(width);
+            uint32_t const index = program.masks.size();
+            if (opcode == Opcode::Lut)
+                program.masks.insert(program.masks.end(), masks, masks + 4);
+            added.push_back({opcode, static_cast<uint8_t>(width), word, NO_SLOT, word_a, word_b, index});
+            for (size_t i = first; i < last; ++i) {
+                removed[members[i]] = true;
+                extract(program.code[members[i]].out, word, i - first);
+            }
+            stats.gates += width;
+            stats.words += 1;
+        }
+    }
+}
+
+void Slicer::run() {
+    stats.instructions_before = program.code.size();
+    drop_register_net_copies(program);
+    sort_code(program);
+    writer.assign(program.initial.size(), -1);
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        for (uint32_t slot : writes(program, program.code[i])) {
+            writer[slot] = i;
+        }
+    }
+    removed.assign(program.code.size(), false);
+
+    pack_registers();
+    slice_gates();
+    for (auto const &reg : registers) {
+        vector<Location> next{};
+        for (uint32_t slot : reg.second) {
+            next.push_back(locate(slot));
+        }
+        program.latches.push_back({reg.first, gather(next)});
+    }
+
+    vector<Instruction> code{};
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        if (!removed[i])
+            code.push_back(program.code[i]);
+    }
+    code.insert(code.end(), added.begin(), added.end());
+    program.code = code;
+    sort_code(program);
+
+    // Read packed bits from their words, the extracts may then be unused
+    auto remap = [this](Location &location) {
+        auto it = bits.find(location.slot);
+        if (it != bits.end() && location.width == 1)
+            location = it->second;
+    };
+    for (auto &entry : program.net_slots) {
+        remap(entry.second);
+    }
+    for (auto &entry : program.state_slots) {
+        remap(entry.second);
+    }
+    for (auto &entry : program.sink_slots) {
+        remap(entry.second);
+    }
+    remove_dead_code(program);
+    copy_register_nets(program);
+    stats.instructions_after = program.code.size();
+}
+
+}  // namespace
+
+SliceStats slice_bits(Program &program, SliceOptions const &options) {
+    SliceStats stats{};
+    Slicer slicer{program, options, stats};
+    slicer.run();
+    return stats;
+}
@@ -0,0 +1,37 @@
+#ifndef BIT_SLICING_H_
+#define BIT_SLICING_H_
+
+#include "program.h"
+
+/* Bit sliced evaluation of 1 bit gates.
+ *
+ * Gates at the same logic level do not depend on each other. This pass packs
+ * the 1 bit operations of a compiled Program which are at the same level into
+ * words, so up to 64 gates are evaluated by one instruction. Different kinds
+ * of gates in one word are evaluated with a Lut, a truth table per bit. 1 bit
+ * registers are packed into words as well.
+ *
+ * The inputs of each word operation are collected with a Gather, a
+ * precomputed list of shift and mask terms. Members of a word are ordered by
+ * where their first input comes from, so bits which stay in order between
+ * levels are moved with a single term.
+ *
+ * Use it after lift_words(), for the gates which do not form buses.
+ */
+
+struct SliceOptions {
+    int min_bits = 8;    // Fewest gates worth packing into a word
+};
+
+struct SliceStats {
+    int gates = 0;       // 1 bit operations packed into words
+    int words = 0;       // Word operations they were packed into
+    int registers = 0;   // 1 bit registers packed into words
+    int terms = 0;       // Shift and mask terms of all gathers
+    int instructions_before = 0;
+    int instructions_after = 0;
+};
+
+SliceStats slice_bits(Program &program, SliceOptions const &options=SliceOptions{});
+
+#endif  // BIT_SLICING_H_
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <iomanip>
+#include <cstdint>
 
 template <int N>
 using T =
@@ -46,6 +47,11 @@ T<N> bitmask() {
     return (ones >> shift);
 }
 
+// The mask of a width of 1 to 64 bits known at run time
+inline uint64_t width_mask(int width) {
+    return ~uint64_t{0} >> (64 - width);
+}
+
 template <int N>
 class BitVector {
 public:
@@ -0,0 +1,201 @@
+#include <fstream>
+#include <memory>
+#include <random>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+
+using namespace std;
+
+namespace {
+
+char const MAGIC[8] = {'H', 'W', 'C', 'K', 'P', 'T', '\0', '\0'};
+uint32_t const VERSION = 2;
+
+// A checkpoint file mapped into memory
+class Mapping {
+public:
+    Mapping(string const &path) {
+        int const fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw runtime_error(path + ": can not be opened");
+        struct stat info{};
+        if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(CheckpointHeader)) {
+            close(fd);
+            throw runtime_error(path + " is not a checkpoint");
+        }
+        size = info.st_size;
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+            throw runtime_error(path + ": can not be mapped");
+        }
+    }
+    Mapping(Mapping const &) = delete;
+    Mapping &operator=(Mapping const &) = delete;
+    ~Mapping() {
+        if (data != nullptr)
+            munmap(data, size);
+    }
+
+    CheckpointHeader const &get_header() const { return *static_cast<CheckpointHeader const*>(data); }
+    uint64_t const *get_words() const {
+        return reinterpret_cast<uint64_t const*>(static_cast<char const*>(data) + sizeof(CheckpointHeader));
+    }
+    size_t get_word_count() const { return (size - sizeof(CheckpointHeader)) / sizeof(uint64_t); }
+
+private:
+    void *data{nullptr};
+    size_t size{0};
+};
+
+// Ids tell checkpoints of the same cycle from different runs apart
+uint64_t new_id() {
+    random_device device{};
+    return (uint64_t{device()} << 32) | device();
+}
+
+void write_words(ofstream &file, uint64_t const *words, size_t count) {
+    if (count > 0)
+        file.write(reinterpret_cast<char const*>(words), count * sizeof(uint64_t));
+}
+
+}  // namespace
+
+Checkpointer::Checkpointer(Simulator &simulator): simulator{simulator} {
+    if (!simulator.is_replayable())
+        throw runtime_error("A Simulator with an input read in order or a recording sink, such as a "
+            "StimulusFeed or a RecordingSink, can not be checkpointed");
+}
+
+void Checkpointer::set_base(uint64_t id) {
+    base = simulator.values;
+    base_cycle = simulator.cycle;
+    base_id = id;
+    has_base = true;
+}
+
+void Checkpointer::save(string const &path) {
+    CheckpointHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.slots = simulator.values.size();
+    header.latch_count = simulator.view.latch_count;
+    header.cycle = simulator.cycle;
+    header.id = new_id();
+
+    ofstream file{path, ios::binary | ios::trunc};
+    if (!file)
+        throw runtime_error(path + ": can not be written");
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    write_words(file, simulator.values.data(), simulator.values.size());
+    if (!file)
+        throw runtime_error(path + ": could not be written");
+    saved_bytes = sizeof(header) + simulator.values.size() * sizeof(uint64_t);
+    set_base(header.id);
+}
+
+void Checkpointer::save_delta(string const &path) {
+    if (!has_base)
+        throw runtime_error(path + ": a delta needs a checkpoint saved or restored before it");
+    vector<uint64_t> const &values = simulator.values;
+    size_t const slots = values.size();
+
+    // Blocks which differ from the last checkpoint, the last one is padded
+    vector<uint64_t> blocks{};
+    vector<uint64_t> data{};
+    for (size_t begin = 0; begin < slots; begin += BLOCK) {
+        size_t const count = min(BLOCK, slots - begin);
+        if (memcmp(&values[begin], &base[begin], count * sizeof(uint64_t)) == 0)
+            continue;
+        blocks.push_back(begin / BLOCK);
+        data.insert(data.end(), values.begin() + begin, values.begin() + begin + count);
+        data.resize(data.size() + BLOCK - count, 0);
+        memcpy(&base[begin], &values[begin], count * sizeof(uint64_t));
+    }
+
+    CheckpointHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.delta = 1;
+    header.slots = slots;
+    header.latch_count = simulator.view.latch_count;
+    header.cycle = simulator.cycle;
+    header.base_cycle = base_cycle;
+    header.block_count = blocks.size();
+    header.id = new_id();
+    header.base_id = base_id;
+
+    ofstream file{path, ios::binary | ios::trunc};
+    if (!file)
+        throw runtime_error(path + ": can not be written");
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    write_words(file, blocks.data(), blocks.size());
+    write_words(file, data.data(), data.size());
+    if (!file)
+        throw runtime_error(path + ": could not be written");
+    saved_bytes = sizeof(header) + (blocks.size() + data.size()) * sizeof(uint64_t);
+    base_cycle = simulator.cycle;
+    base_id = header.id;
+}
+
+void Checkpointer::restore(vector<string> const &paths) {
+    if (paths.empty())
+        throw runtime_error("There is no checkpoint to restore");
+    vector<uint64_t> &values = simulator.values;
+    size_t const slots = values.size();
+
+    // Check the whole chain before changing anything
+    vector<unique_ptr<Mapping const>> mappings{};
+    uint64_t cycle = 0;
+    uint64_t id = 0;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        string const &path = paths[i];
+        mappings.push_back(make_unique<Mapping const>(path));
+        Mapping const &mapping = *mappings.back();
+        CheckpointHeader const &header = mapping.get_header();
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+            throw runtime_error(path + " is not a checkpoint of this version");
+        if (header.slots != slots || header.latch_count != simulator.view.latch_count)
+            throw runtime_error(path + " is a checkpoint of another program");
+        if (i == 0 && header.delta != 0)
+            throw runtime_error(path + " is a delta, restore the checkpoint before it first");
+        if (i > 0 && (header.delta == 0 || header.base_cycle != cycle))
+            throw runtime_error(path + " is not a delta of cycle " + to_string(cycle));
+        if (i > 0 && header.base_id != id)
+            throw runtime_error(path + " is a delta of another checkpoint of cycle " + to_string(cycle));
+        uint64_t const words = (header.delta == 0) ? slots : header.block_count * (BLOCK + 1);
+        if (mapping.get_word_count() < words)
+            throw runtime_error(path + " is truncated");
+        for (uint64_t b = 0; header.delta != 0 && b < header.block_count; ++b) {
+            if (mapping.get_words()[b] * BLOCK >= slots)
+                throw runtime_error(path + " is a checkpoint of another program");
+        }
+        cycle = header.cycle;
+        id = header.id;
+    }
+
+    for (auto const &mapping : mappings) {
+        CheckpointHeader const &header = mapping->get_header();
+        uint64_t const *words = mapping->get_words();
+        if (header.delta == 0) {
+            memcpy(values.data(), words, slots * sizeof(uint64_t));
+            continue;
+        }
+        uint64_t const *data = words + header.block_count;
+        for (uint64_t b = 0; b < header.block_count; ++b) {
+            uint64_t const begin = words[b] * BLOCK;
+            memcpy(&values[begin], data + b * BLOCK, min<size_t>(BLOCK, slots - begin) * sizeof(uint64_t));
+        }
+    }
+    simulator.cycle = cycle;
+    simulator.inputs_read = 0;
+    set_base(id);
+}
@@ -0,0 +1,76 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "simulator.h"
+
+/* Checkpoints of a running Simulator.
+ *
+ * The whole state of a simulation is the slots of the Simulator and its cycle
+ * count. A checkpoint file holds the slots as they are laid out in memory, so
+ * restoring one maps the file and copies it. A delta holds only the blocks of
+ * slots which changed since the checkpoint before it, and is restored on top
+ * of that checkpoint:
+ *
+ *   Checkpointer checkpoints{simulator};
+ *   checkpoints.save("run.ckpt");
+ *   simulator.run(1000000);
+ *   checkpoints.save_delta("run.1.ckpt");
+ *
+ *   Checkpointer{other_simulator}.restore({"run.ckpt", "run.1.ckpt"});
+ *
+ * A checkpoint only fits the program it was saved from, the number of slots
+ * and registers is checked. Every file has a random id, and a delta holds the
+ * id of the file it was made against, so a delta of another run which has the
+ * same base cycle is not restored on top of the wrong state.
+ */
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t delta;        // 1 if only the changed blocks are stored
+    uint64_t slots;
+    uint64_t latch_count;
+    uint64_t cycle;
+    uint64_t base_cycle;   // Cycle of the checkpoint a delta is restored on
+    uint64_t block_count;  // Blocks stored in a delta
+    uint64_t id;
+    uint64_t base_id;      // Id of the checkpoint a delta is restored on
+};
+
+class Checkpointer {
+public:
+    // Slots per block of a delta
+    static constexpr size_t BLOCK = 64;
+
+    explicit Checkpointer(Simulator &simulator);
+    Checkpointer(Checkpointer const &) = delete;
+    Checkpointer &operator=(Checkpointer const &) = delete;
+
+    // Save every slot
+    void save(std::string const &path);
+    // Save the blocks which changed since the last checkpoint saved or
+    // restored
+    void save_delta(std::string const &path);
+    // Restore a full checkpoint and the deltas which follow it, in order
+    void restore(std::vector<std::string> const &paths);
+
+    // Size of the last file saved
+    uint64_t get_saved_bytes() const { return saved_bytes; }
+
+private:
+    void set_base(uint64_t id);
+
+    Simulator &simulator;
+    // The slots at the last checkpoint, deltas are made against it
+    std::vector<uint64_t> base{};
+    uint64_t base_cycle{0};
+    uint64_t base_id{0};
+    bool has_base{false};
+    uint64_t saved_bytes{0};
+};
+
+#endif  // CHECKPOINT_H_
@@ -43,6 +43,19 @@ Clock::Clock(unsigned max_threads, std::initializer_list<Clockable*> clockables)
     }
 }
 
+Clock::Clock(unsigned max_threads, std::vector<Clockable*> const &clockables):
+    clockables{clockables},
+    thread_count{(max_threads == 0) ? thread::hardware_concurrency() : min(max_threads, thread::hardware_concurrency())},
+    start_barrier{thread_count + 1},
+    set_chain_barrier{thread_count},
+    reset_chain_barrier{thread_count},
+    done_barrier{thread_count + 1} {
+
+    for (unsigned i=0; i<thread_count; ++i) {
+        threads.emplace_back(thread([this, i](){process(i);}));
+    }
+}
+
 Clock::~Clock() {
     running = false;
     start_barrier.arrive();
@@ -16,6 +16,7 @@ public:
     Clock(unsigned max_threads=0);
     Clock(std::initializer_list<Clockable*> clockables);
     Clock(unsigned max_threads, std::initializer_list<Clockable*> clockables);
+    Clock(unsigned max_threads, std::vector<Clockable*> const &clockables);
     ~Clock();
 
     void add_clockable(Clockable *clockable);
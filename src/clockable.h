@@ -1,6 +1,9 @@
 #ifndef CLOCKABLE_H_
 #define CLOCKABLE_H_
 
+#include <vector>
+#include <cstdint>
+
 /* The Clockable objects are the start and end of the set chain.
  * For the set chain to work properly it is important that:
  *   1. clock() is called for all clockable objects
@@ -10,6 +13,8 @@
  * depends on the last clock cycle.
  */
 
+class Net;
+
 class Clockable {
 public:
     Clockable() = default;
@@ -18,7 +23,26 @@ public:
     virtual void start_set_chain() = 0;
     virtual void start_reset_chain() = 0;
 
+    // Netlist introspection: the wires set by start_set_chain(), and the
+    // current state as a raw integer.
+    virtual std::vector<Net*> get_start_wires() { return {}; }
+    virtual bool is_constant() const { return false; }
+    virtual uint64_t get_raw_state() const { return 0; }
+    virtual void set_raw_state(uint64_t) {}
+
 };
 
-#endif  // CLOCKABLE_H_
+/* A Clockable which drives one wire with values from outside the design, such
+ * as an InputStream. A Simulator reads it itself before every cycle, see
+ * Program::inputs.
+ */
+class InputSource: public Clockable {
+public:
+    // The value of a cycle, asked for once per cycle and in order
+    virtual uint64_t read_input(uint64_t cycle) = 0;
+    // read_input() depends on the cycle only, so runs on several threads may
+    // call it at the same time
+    virtual bool is_stateless_input() const { return false; }
+};
 
+#endif  // CLOCKABLE_H_
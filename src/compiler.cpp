@@ -0,0 +1,267 @@
+#include <unordered_map>
+#include <unordered_set>
+#include <stdexcept>
+
+#include "compiler.h"
+#include "cone.h"
+#include "fused_register.h"
+#include "lookup_table.h"
+
+using namespace std;
+
+namespace {
+
+class Compiler {
+public:
+    Compiler(Netlist const &netlist, CompileStats &stats): netlist{netlist}, stats{stats} {}
+    Program run();
+
+private:
+    uint32_t new_slot(int width, uint64_t value=0, bool constant=false);
+    uint32_t get_slot(Port *port);
+    bool is_constant(uint32_t slot, uint64_t value) const;
+    void add_clockable(Clockable *clockable);
+    void add_component(Component *component);
+    void add_endpoint(Component *component);
+    Location whole(uint32_t slot) const { return {slot, 0, program.widths[slot]}; }
+
+    Netlist const &netlist;
+    CompileStats &stats;
+    Program program{};
+    vector<bool> constant{};
+    unordered_set<uint32_t> states{};
+    unordered_map<uint32_t, uint32_t> inverted{};
+    vector<pair<Component*, uint32_t>> registers{};
+};
+
+uint32_t Compiler::new_slot(int width, uint64_t value, bool is_const) {
+    constant.push_back(is_const);
+    return program.add_slot(width, value);
+}
+
+uint32_t Compiler::get_slot(Port *port) {
+    Net *net = netlist.get_net(port);
+    if (net == nullptr) {
+        // Nothing drives the port, it keeps its default value
+        return new_slot(port->get_width(), 0, true);
+    }
+    return program.net_slots.at(net).slot;
+}
+
+bool Compiler::is_constant(uint32_t slot, uint64_t value) const {
+    return constant[slot] && program.initial[slot] == value;
+}
+
+void Compiler::add_clockable(Clockable *clockable) {
+    vector<Net*> const wires = clockable->get_start_wires();
+    if (clockable->is_constant()) {
+        for (Net *wire : wires) {
+            program.net_slots[wire] = whole(new_slot(wire->get_width(), clockable->get_raw_state(), true));
+        }
+        return;
+    }
+
+    if (FusedRegister *fused = dynamic_cast<FusedRegister*>(clockable)) {
+        int const width = wires.at(0)->get_width();
+        uint32_t const state = new_slot(width, clockable->get_raw_state());
+        uint32_t const next = new_slot(width);
+        program.net_slots[wires[0]] = whole(state);
+        program.register_nets.insert(wires[0]);
+        if (wires.size() > 1)
+            program.net_slots[wires[1]] = whole(next);
+        program.state_slots[fused] = whole(state);
+        program.state_slots[fused->get_register()] = whole(state);
+        states.insert(state);
+
+        program.calls.push_back({[fused](uint64_t const *in, uint64_t *out) {
+            out[0] = fused->next_value(in[0]);
+        }, {state}, {next}, !fused->uses_cone()});
+        uint32_t const index = program.calls.size() - 1;
+        program.code.push_back({Opcode::Call, 0, NO_SLOT, NO_SLOT, index, index, index});
+        program.latches.push_back({state, next});
+        return;
+    }
+
+    InputSource *input = dynamic_cast<InputSource*>(clockable);
+    if (input != nullptr && wires.size() == 1) {
+        uint32_t const slot = new_slot(wires[0]->get_width(), clockable->get_raw_state());
+        program.net_slots[wires[0]] = whole(slot);
+        program.state_slots[clockable] = whole(slot);
+        program.inputs.push_back({[input](uint64_t cycle) {
+            return input->read_input(cycle);
+        }, slot, input->is_stateless_input()});
+        return;
+    }
+    Component *component = dynamic_cast<Component*>(clockable);
+    if (component == nullptr || component->get_inputs().size() != 1 || wires.size() > 1) {
+        throw runtime_error("Only Registers, Constants, FusedRegisters and inputs can be compiled");
+    }
+    uint32_t const state = new_slot(component->get_inputs()[0]->get_width(), clockable->get_raw_state());
+    if (!wires.empty()) {
+        program.net_slots[wires[0]] = whole(state);
+        program.register_nets.insert(wires[0]);
+    }
+    program.state_slots[clockable] = whole(state);
+    states.insert(state);
+    registers.push_back({component, state});
+}
+
+void Compiler::add_component(Component *component) {
+    vector<uint32_t> in{};
+    for (Port *port : component->get_inputs()) {
+        in.push_back(get_slot(port));
+    }
+    vector<Net*> const outwires = component->get_outwires();
+    stats.components += 1;
+    stats.ports += in.size();
+
+    if (ConeComponent *cone = dynamic_cast<ConeComponent*>(component)) {
+        vector<uint32_t> out{};
+        for (Net *outwire : outwires) {
+            out.push_back(new_slot(outwire->get_width()));
+            program.net_slots[outwire] = whole(out.back());
+        }
+        program.calls.push_back({[cone](uint64_t const *in, uint64_t *out) {
+            cone->calculate(in, out);
+        }, in, out, dynamic_cast<LookupTable*>(cone) != nullptr});
+        uint32_t const index = program.calls.size() - 1;
+        program.code.push_back({Opcode::Call, 0, NO_SLOT, NO_SLOT, index, index, index});
+        return;
+    }
+
+    Opcode opcode;
+    switch (component->get_operation()) {
+    case Operation::Not: opcode = Opcode::Not; break;
+    case Operation::And: opcode = Opcode::And; break;
+    case Operation::Nand: opcode = Opcode::Nand; break;
+    case Operation::Or: opcode = Opcode::Or; break;
+    case Operation::Xor: opcode = Opcode::Xor; break;
+    case Operation::Nor: opcode = Opcode::Nor; break;
+    case Operation::Add: opcode = Opcode::Add; break;
+    default:
+        throw runtime_error(component->get_name() + " can not be compiled");
+    }
+
+    int const width = outwires.at(0)->get_width();
+    uint64_t const mask = width_mask(width);
+    bool const has_carry = outwires.size() > 1;
+    uint32_t const a = in.at(0);
+    uint32_t const b = (in.size() > 1) ? in[1] : a;
+    uint32_t const c = (in.size() > 2) ? in[2] : a;
+
+    // Only constant inputs, calculate the result now
+    bool all_constant = true;
+    for (uint32_t slot : in) {
+        all_constant = all_constant && constant[slot];
+    }
+    if (all_constant) {
+        uint64_t values[5] = {program.initial[a], program.initial[b], program.initial[c], 0, 0};
+        execute({opcode, static_cast<uint8_t>(width), 3, 4, 0, 1, 2}, values, program.view());
+        program.net_slots[outwires[0]] = whole(new_slot(width, values[3], true));
+        if (has_carry)
+            program.net_slots[outwires[1]] = whole(new_slot(1, values[4], true));
+        stats.folded += 1;
+        return;
+    }
+
+    // Identities
+    uint32_t alias = NO_SLOT;
+    switch (opcode) {
+    case Opcode::Not:
+        if (inverted.count(a))
+            alias = inverted[a];
+        break;
+    case Opcode::And:
+        if (a == b || is_constant(b, mask))
+            alias = a;
+        else if (is_constant(a, mask))
+            alias = b;
+        break;
+    case Opcode::Or:
+    case Opcode::Xor:
+        if ((a == b && opcode == Opcode::Or) || is_constant(b, 0))
+            alias = a;
+        else if (is_constant(a, 0))
+            alias = b;
+        break;
+    case Opcode::Add:
+        if (is_constant(c, 0) && is_constant(b, 0))
+            alias = a;
+        else if (is_constant(c, 0) && is_constant(a, 0))
+            alias = b;
+        break;
+    default:
+        break;
+    }
+    if (alias != NO_SLOT) {
+        program.net_slots[outwires[0]] = whole(alias);
+        if (has_carry)
+            program.net_slots[outwires[1]] = whole(new_slot(1, 0, true));
+        stats.aliased += 1;
+        return;
+    }
+
+    Instruction ins{opcode, static_cast<uint8_t>(width), new_slot(width), NO_SLOT, a, b, c};
+    program.net_slots[outwires[0]] = whole(ins.out);
+    if (has_carry) {
+        ins.carry = new_slot(1);
+        program.net_slots[outwires[1]] = whole(ins.carry);
+    }
+    if (opcode == Opcode::Not)
+        inverted[ins.out] = a;
+    program.code.push_back(ins);
+}
+
+void Compiler::add_endpoint(Component *component) {
+    if (dynamic_cast<Clockable*>(component) != nullptr)
+        return;
+    vector<Port*> const inputs = component->get_inputs();
+    if (inputs.empty())
+        return;
+    uint32_t slot = get_slot(inputs[0]);
+    if (states.count(slot)) {
+        // The state changes at the end of the cycle, keep the value it had
+        uint32_t const copy = new_slot(program.widths[slot]);
+        program.code.push_back({Opcode::Copy, program.widths[slot], copy, NO_SLOT, slot, slot, slot});
+        slot = copy;
+    }
+    program.sink_slots[component] = whole(slot);
+    OutputSink *output = dynamic_cast<OutputSink*>(component);
+    if (output != nullptr) {
+        program.outputs.push_back({[output](uint64_t value) {
+            output->write_output(value);
+        }, component});
+    }
+}
+
+Program Compiler::run() {
+    for (Clockable *clockable : netlist.get_clockables()) {
+        add_clockable(clockable);
+    }
+    for (Component *component : netlist.get_components()) {
+        add_component(component);
+    }
+    for (auto const &reg : registers) {
+        Port *input = reg.first->get_inputs()[0];
+        uint32_t const next = (netlist.get_net(input) != nullptr) ? get_slot(input) : reg.second;
+        program.latches.push_back({reg.second, next});
+    }
+    for (Component *endpoint : netlist.get_endpoints()) {
+        stats.ports += endpoint->get_inputs().size();
+        add_endpoint(endpoint);
+    }
+    stats.removed += remove_dead_code(program);
+    copy_register_nets(program);
+
+    stats.wires = netlist.get_nets().size();
+    stats.instructions = program.code.size();
+    return std::move(program);
+}
+
+}  // namespace
+
+Program compile(Netlist const &netlist, CompileStats *stats) {
+    CompileStats local{};
+    Compiler compiler{netlist, (stats != nullptr) ? *stats : local};
+    return compiler.run();
+}
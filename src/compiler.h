@@ -0,0 +1,33 @@
+#ifndef COMPILER_H_
+#define COMPILER_H_
+
+#include "netlist.h"
+#include "program.h"
+
+/* Compile a design into a Program.
+ *
+ * This is the last elaboration pass. Wires and InputPorts are collapsed: every
+ * net becomes a slot which the consumers read directly. Operations which do
+ * not compute anything are removed as well:
+ *   - identities such as x & x, x | 0, x ^ 0, x + 0 and ~~x are replaced by
+ *     their input
+ *   - operations with only constant inputs are folded into constants
+ *   - operations whose outputs are never used are removed
+ *
+ * LookupTables, MemoizedCones and FusedRegisters are called through their
+ * objects. Other components must be built in ones.
+ */
+
+struct CompileStats {
+    int wires = 0;         // Wires collapsed into slots
+    int ports = 0;         // InputPorts replaced by direct references
+    int components = 0;
+    int aliased = 0;       // Identity operations removed
+    int folded = 0;        // Operations folded into constants
+    int removed = 0;       // Operations without any use removed
+    int instructions = 0;
+};
+
+Program compile(Netlist const &netlist, CompileStats *stats=nullptr);
+
+#endif  // COMPILER_H_
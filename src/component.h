@@ -2,14 +2,38 @@
 #define COMPONENT_H_
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
 #include "entity.h"
 
+class Port;
+class Net;
+
+// What a component calculates, so passes can reason about it
+enum class Operation { Other, Not, And, Nand, Or, Xor, Nor, Add };
+
 class Component : public Entity {
 public:
     Component(std::string const &name="Component"): Entity(name) {}
     virtual void set() = 0;
+
+    // Netlist introspection. A component with outwires is combinational,
+    // components without them (Registers, Sinks) end the set chain.
+    virtual std::vector<Port*> get_inputs() { return {}; }
+    virtual std::vector<Net*> get_outwires() { return {}; }
+    virtual Operation get_operation() const { return Operation::Other; }
 };
 
-#endif  // COMPONENT_H_
+/* A Component which ends the set chain and keeps the value of every cycle,
+ * such as a RecordingSink. A Simulator hands it the values itself after every
+ * cycle, see Program::outputs.
+ */
+class OutputSink: public Component {
+public:
+    OutputSink(std::string const &name="OutputSink"): Component(name) {}
+    // The value of a cycle, given once per cycle and in order
+    virtual void write_output(uint64_t value) = 0;
+};
 
+#endif  // COMPONENT_H_
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include "cone.h"
+
+using namespace std;
+
+Cone::Cone(Netlist const &netlist, Component *root, int max_input_bits):
+    components{root}, outputs{root->get_outwires()} {
+
+    valid = find_inputs(netlist, components, inputs);
+
+    // Absorb the drivers of the inputs as long as the cone stays small enough
+    bool changed = valid;
+    while (changed) {
+        changed = false;
+        unordered_set<Component*> members(components.begin(), components.end());
+        for (Input const &in : inputs) {
+            Component *driver = netlist.get_driver(in.net);
+            if (driver == nullptr || members.count(driver))
+                continue;
+
+            // All fanout of the driver must stay inside the cone
+            bool internal = true;
+            for (Net *outwire : driver->get_outwires()) {
+                for (Port *port : outwire->get_targets()) {
+                    internal = internal && members.count(port->get_parent());
+                }
+            }
+            if (!internal)
+                continue;
+
+            vector<Component*> grown{components};
+            grown.push_back(driver);
+            vector<Input> grown_inputs{};
+            if (!find_inputs(netlist, grown, grown_inputs))
+                continue;
+            int width = 0;
+            for (Input const &i : grown_inputs) {
+                if (!i.constant)
+                    width += i.net->get_width();
+            }
+            if (width <= max_input_bits) {
+                components = grown;
+                inputs = grown_inputs;
+                changed = true;
+                break;
+            }
+        }
+    }
+
+    stable_sort(components.begin(), components.end(), [&netlist](Component *a, Component *b) {
+        return netlist.get_level(a) < netlist.get_level(b);
+    });
+}
+
+bool Cone::find_inputs(Netlist const &netlist, vector<Component*> const &members, vector<Input> &found) const {
+    unordered_set<Component*> member_set(members.begin(), members.end());
+    for (Component *component : members) {
+        for (Port *port : component->get_inputs()) {
+            Net *net = netlist.get_net(port);
+            if (net == nullptr)
+                return false;
+            if (member_set.count(netlist.get_driver(net)))
+                continue;
+            auto it = find_if(found.begin(), found.end(), [net](Input const &i) { return i.net == net; });
+            if (it != found.end()) {
+                it->ports.push_back(port);
+            } else {
+                Clockable *source = netlist.get_source(net);
+                bool constant = (source != nullptr) && source->is_constant();
+                found.push_back({net, {port}, constant, constant ? source->get_raw_state() : 0});
+            }
+        }
+    }
+    return true;
+}
+
+int Cone::get_input_count() const {
+    return count_if(inputs.begin(), inputs.end(), [](Input const &i) { return !i.constant; });
+}
+
+int Cone::get_input_width() const {
+    int width = 0;
+    for (Input const &in : inputs) {
+        if (!in.constant)
+            width += in.net->get_width();
+    }
+    return width;
+}
+
+int Cone::get_output_width() const {
+    int width = 0;
+    for (Net *out : outputs) {
+        width += out->get_width();
+    }
+    return width;
+}
+
+void Cone::evaluate(uint64_t const *in, uint64_t *out) const {
+    size_t i = 0;
+    for (Input const &input : inputs) {
+        uint64_t value = input.constant ? input.value : in[i++];
+        for (Port *port : input.ports) {
+            port->set_raw(value);
+        }
+    }
+    for (size_t j = 0; j < outputs.size(); ++j) {
+        out[j] = outputs[j]->get_raw();
+    }
+    for (Input const &input : inputs) {
+        for (Port *port : input.ports) {
+            port->reset();
+        }
+    }
+}
+
+ConeComponent::ConeComponent(Netlist &netlist, Cone const &cone, string const &name):
+    Component(name), cone{cone} {
+
+    for (Cone::Input const &in : cone.get_inputs()) {
+        for (Port *port : in.ports) {
+            in.net->remove_target(port);
+        }
+        if (!in.constant) {
+            input.push_back(in.net->make_port(this, name + ".input[]"));
+            in.net->add_target(input.back().get());
+        }
+    }
+    for (Net *out : cone.get_outputs()) {
+        Net *outwire = netlist.adopt(out->make_wire(out->get_name()));
+        out->move_targets(outwire);
+        outwires.push_back(outwire);
+    }
+    in_values.resize(input.size());
+    out_values.resize(outwires.size());
+}
+
+void ConeComponent::set() {
+    int const set_count_copy = ++set_count;
+    int const inputs = static_cast<int>(input.size());
+    if (set_count_copy == inputs) {
+        for (size_t i = 0; i < input.size(); ++i) {
+            in_values[i] = input[i]->get_raw();
+        }
+        calculate_outvalues(in_values.data(), out_values.data());
+        for (size_t i = 0; i < outwires.size(); ++i) {
+            outwires[i]->set_raw(out_values[i]);
+        }
+    } else if (set_count_copy > inputs) {
+        throw runtime_error(name + " has already been set " + to_string(inputs) + " times");
+    }
+}
+
+void ConeComponent::reset() {
+    int const set_count_copy = set_count.exchange(0);
+    if (set_count_copy) {
+        for (Net *outwire : outwires) {
+            outwire->reset();
+        }
+    }
+}
+
+vector<Port*> ConeComponent::get_inputs() {
+    vector<Port*> ports{};
+    for (auto const &port : input) {
+        ports.push_back(port.get());
+    }
+    return ports;
+}
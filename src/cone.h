@@ -0,0 +1,93 @@
+#ifndef CONE_H_
+#define CONE_H_
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <string>
+
+#include "component.h"
+#include "input_port.h"
+#include "wire.h"
+#include "netlist.h"
+
+/* A Cone is a tree of combinational components with a single root. Every wire
+ * inside the cone only feeds components in the cone, so the cone as a whole is
+ * a function from its input nets to the outwires of the root.
+ *
+ * Inputs driven by Constants are folded into the cone and do not count towards
+ * its input width.
+ */
+
+class Cone {
+public:
+    struct Input {
+        Net *net;
+        std::vector<Port*> ports;  // The ports in the cone fed by net
+        bool constant;
+        uint64_t value;            // Only used for constant inputs
+    };
+
+    // Grow a cone backwards from root for as long as the width of the
+    // non-constant inputs stays within max_input_bits.
+    Cone(Netlist const &netlist, Component *root, int max_input_bits);
+
+    bool is_valid() const { return valid; }
+    std::vector<Component*> const &get_components() const { return components; }
+    std::vector<Input> const &get_inputs() const { return inputs; }
+    std::vector<Net*> const &get_outputs() const { return outputs; }
+    int get_input_count() const;
+    int get_input_width() const;
+    int get_output_width() const;
+
+    // Evaluate the cone through its components. Takes one value per
+    // non-constant input and gives one value per output. The outputs must not
+    // have any targets, see ConeComponent.
+    void evaluate(uint64_t const *in, uint64_t *out) const;
+
+private:
+    bool find_inputs(Netlist const &netlist, std::vector<Component*> const &members, std::vector<Input> &found) const;
+
+    bool valid{true};
+    std::vector<Component*> components{};
+    std::vector<Input> inputs{};
+    std::vector<Net*> outputs{};
+};
+
+/* ConeComponent is the base for components which replace a Cone in the
+ * running design. The constructor splices the component in: the cone is
+ * disconnected from its input nets and the targets of the cone outputs are
+ * moved to new wires driven by the ConeComponent. The cone itself is left
+ * intact, so it can still be evaluated with Cone::evaluate().
+ */
+class ConeComponent: public Component {
+public:
+    ConeComponent(Netlist &netlist, Cone const &cone, std::string const &name="ConeComponent");
+    ConeComponent(ConeComponent const &) = delete;
+    void operator=(ConeComponent const &) = delete;
+
+    void set() override;
+    void reset() override;
+
+    std::vector<Port*> get_inputs() override;
+    std::vector<Net*> get_outwires() override { return outwires; }
+
+    Cone const &get_cone() const { return cone; }
+
+    // Calculate the outputs from raw input values without the set chain
+    void calculate(uint64_t const *in, uint64_t *out) { calculate_outvalues(in, out); }
+
+protected:
+    virtual void calculate_outvalues(uint64_t const *in, uint64_t *out) = 0;
+
+    Cone const cone;
+
+private:
+    std::vector<std::unique_ptr<Port>> input{};
+    std::vector<Net*> outwires{};
+    std::vector<uint64_t> in_values{};
+    std::vector<uint64_t> out_values{};
+    std::atomic_int set_count{0};
+};
+
+#endif  // CONE_H_
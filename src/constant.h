@@ -26,6 +26,10 @@ public:
         outwire->reset();
     }
 
+    std::vector<Net*> get_start_wires() override { return {outwire}; }
+    bool is_constant() const override { return true; }
+    uint64_t get_raw_state() const override { return value.get_value(); }
+
 private:
     BitVector<N> const value;
     Wire<N> *outwire;
@@ -8,7 +8,7 @@ public:
     Entity(std::string const &name): name{name} {};
     virtual ~Entity() = default;
     virtual void reset() = 0;
-    std::string get_name() { return name; }
+    std::string get_name() const { return name; }
 
 protected:
     std::string name;
@@ -0,0 +1,114 @@
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "farm.h"
+#include "parallel.h"
+
+using namespace std;
+
+namespace {
+
+// The jobs left to a thread, others steal from the end
+struct alignas(64) Range {
+    mutex lock{};
+    size_t begin{0};
+    size_t end{0};
+};
+
+void pin_to_core(unsigned core) {
+#ifdef __linux__
+    cpu_set_t cores;
+    CPU_ZERO(&cores);
+    CPU_SET(core % max(1u, thread::hardware_concurrency()), &cores);
+    pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+#else
+    (void)core;
+#endif
+}
+
+}  // namespace
+
+Farm::Farm(Simulator const &start, FarmOptions const &options): start{start}, options{options} {}
+
+FarmStats Farm::run_jobs(size_t jobs, function<void(size_t index, Simulator &simulator)> const &job) {
+    unsigned threads = is_shareable(start.get_program()) ? resolve_threads(options.threads) : 1;
+    threads = static_cast<unsigned>(max<size_t>(1, min<size_t>(threads, jobs)));
+    vector<Range> ranges(threads);
+    for (unsigned t = 0; t < threads; ++t) {
+        ranges[t].begin = jobs * t / threads;
+        ranges[t].end = jobs * (t + 1) / threads;
+    }
+
+    atomic<uint64_t> cycles{0};
+    atomic<uint64_t> steals{0};
+    auto next_job = [&](unsigned thread, size_t &index) {
+        {
+            lock_guard<mutex> lock{ranges[thread].lock};
+            if (ranges[thread].begin < ranges[thread].end) {
+                index = ranges[thread].begin++;
+                return true;
+            }
+        }
+        // Steal half of the jobs of the thread with the most left
+        while (true) {
+            unsigned victim = thread;
+            size_t most = 0;
+            for (unsigned t = 0; t < threads; ++t) {
+                lock_guard<mutex> lock{ranges[t].lock};
+                if (ranges[t].end - ranges[t].begin > most) {
+                    most = ranges[t].end - ranges[t].begin;
+                    victim = t;
+                }
+            }
+            if (most == 0)
+                return false;
+            size_t begin, end;
+            {
+                lock_guard<mutex> lock{ranges[victim].lock};
+                size_t const left = ranges[victim].end - ranges[victim].begin;
+                if (left == 0)
+                    continue;
+                end = ranges[victim].end;
+                begin = end - (left + 1) / 2;
+                ranges[victim].end = begin;
+            }
+            steals += 1;
+            lock_guard<mutex> lock{ranges[thread].lock};
+            index = begin;
+            ranges[thread].begin = begin + 1;
+            ranges[thread].end = end;
+            return true;
+        }
+    };
+
+    auto const started = chrono::steady_clock::now();
+    parallel_tasks(threads, threads, [&](size_t task) {
+        unsigned const thread = static_cast<unsigned>(task);
+        if (options.pin && threads > 1)
+            pin_to_core(thread);
+        uint64_t thread_cycles = 0;
+        size_t index;
+        while (next_job(thread, index)) {
+            unique_ptr<Simulator> simulator = start.fork();
+            uint64_t const first = simulator->get_cycle();
+            job(index, *simulator);
+            thread_cycles += simulator->get_cycle() - first;
+        }
+        cycles += thread_cycles;
+    });
+
+    FarmStats stats{};
+    stats.jobs = jobs;
+    stats.cycles = cycles;
+    stats.steals = steals;
+    stats.threads = threads;
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    return stats;
+}
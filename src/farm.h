@@ -0,0 +1,74 @@
+#ifndef FARM_H_
+#define FARM_H_
+
+#include <functional>
+#include <mutex>
+#include <cstdint>
+
+#include "simulator.h"
+
+/* A regression farm runs many short, independent simulations of one design,
+ * one simulation per core. Threading inside one design does not pay off (see
+ * the Clock), threading across runs does: the runs share the program and
+ * nothing else.
+ *
+ * Every job starts on a fork of the start Simulator, so jobs may start from a
+ * warmed up or restored state. Each thread takes a contiguous range of the
+ * jobs and, once it is done, steals half of the jobs left to the busiest
+ * thread. The result of a job is reported as soon as it is done, one report
+ * at a time:
+ *
+ *   Farm farm{simulator};
+ *   farm.run(1000, [&](size_t job, Simulator &run) {
+ *       run.set_state(seed, job);
+ *       run.run(10000);
+ *       return run.get_state(result);
+ *   }, [&](size_t job, uint64_t value) {
+ *       cout << job << ": " << value << endl;
+ *   });
+ *
+ * Programs which are not shareable run on one thread, see is_shareable().
+ */
+
+struct FarmOptions {
+    unsigned threads = 0;  // 0 is one per core
+    bool pin = true;       // Pin thread i to core i
+};
+
+struct FarmStats {
+    uint64_t jobs = 0;
+    uint64_t cycles = 0;
+    uint64_t steals = 0;
+    unsigned threads = 0;
+    double seconds = 0;
+
+    double get_cycles_per_second() const { return (seconds > 0) ? cycles / seconds : 0; }
+};
+
+class Farm {
+public:
+    explicit Farm(Simulator const &start, FarmOptions const &options={});
+    Farm(Farm const &) = delete;
+    Farm &operator=(Farm const &) = delete;
+
+    // Run job(index, simulator) for every job and pass what it returns to
+    // report(index, result), in the order the jobs finish
+    template <typename Job, typename Report>
+    FarmStats run(size_t jobs, Job const &job, Report const &report) {
+        std::mutex report_mutex{};
+        return run_jobs(jobs, [&](size_t index, Simulator &simulator) {
+            auto result = job(index, simulator);
+            std::lock_guard<std::mutex> lock{report_mutex};
+            report(index, std::move(result));
+        });
+    }
+
+    // Run jobs which report by themselves
+    FarmStats run_jobs(size_t jobs, std::function<void(size_t index, Simulator &simulator)> const &job);
+
+private:
+    Simulator const &start;
+    FarmOptions options;
+};
+
+#endif  // FARM_H_
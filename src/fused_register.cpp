@@ -0,0 +1,200 @@
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+
+#include "fused_register.h"
+#include "bit_vector.h"
+
+using namespace std;
+
+FusedRegister::FusedRegister(Netlist &netlist, Clockable *reg, Cone const &cone, int max_table_bits):
+    Clockable(),
+    reg{reg},
+    regwire{reg->get_start_wires().at(0)},
+    cone{cone},
+    mask{width_mask(regwire->get_width())} {
+
+    // The register is no longer set by the cone, but other targets of the
+    // feedback wire are now set from here.
+    Net *feedback = cone.get_outputs().at(0);
+    feedback->remove_target(dynamic_cast<Component*>(reg)->get_inputs().at(0));
+    if (!feedback->get_targets().empty()) {
+        outwire = netlist.adopt(feedback->make_wire(feedback->get_name()));
+        feedback->move_targets(outwire);
+    }
+    for (Cone::Input const &in : cone.get_inputs()) {
+        for (Port *port : in.ports) {
+            in.net->remove_target(port);
+        }
+    }
+
+    int const width = regwire->get_width();
+    Component *root = cone.get_components().back();
+    if (cone.get_components().size() == 1 && root->get_operation() == Operation::Add) {
+        // value + constant + constant carry in, unless the register feeds both
+        // adder inputs
+        counter = true;
+        for (Cone::Input const &in : cone.get_inputs()) {
+            if (in.constant)
+                increment += in.value * in.ports.size();
+            else
+                counter = (in.ports.size() == 1);
+        }
+        increment &= mask;
+    } else if (width <= max_table_bits) {
+        table.resize(size_t{1} << width);
+        for (uint64_t value = 0; value < table.size(); ++value) {
+            cone.evaluate(&value, &table[value]);
+        }
+        // Any cone can turn out to be a counter
+        counter = true;
+        increment = table[0];
+        for (uint64_t value = 0; value < table.size() && counter; ++value) {
+            counter = (table[value] == ((value + increment) & mask));
+        }
+    }
+}
+
+uint64_t FusedRegister::next_value(uint64_t value) const {
+    if (counter)
+        return (value + increment) & mask;
+    if (!table.empty())
+        return table[value];
+    uint64_t result;
+    cone.evaluate(&value, &result);
+    return result;
+}
+
+void FusedRegister::clock() {
+    reg->set_raw_state(next);
+}
+
+void FusedRegister::start_set_chain() {
+    reg->start_set_chain();
+    next = next_value(reg->get_raw_state());
+    if (outwire != nullptr)
+        outwire->set_raw(next);
+}
+
+void FusedRegister::start_reset_chain() {
+    reg->start_reset_chain();
+    if (outwire != nullptr)
+        outwire->reset();
+}
+
+vector<Net*> FusedRegister::get_start_wires() {
+    if (outwire != nullptr)
+        return {regwire, outwire};
+    return {regwire};
+}
+
+void FusedRegister::fast_forward(uint64_t cycles) {
+    if (counter) {
+        reg->set_raw_state((reg->get_raw_state() + cycles * increment) & mask);
+    } else {
+        uint64_t value = reg->get_raw_state();
+        for (uint64_t i = 0; i < cycles; ++i) {
+            value = next_value(value);
+        }
+        reg->set_raw_state(value);
+    }
+}
+
+FusionStats fuse_feedback_registers(Netlist &netlist, int max_table_bits) {
+    FusionStats stats{};
+    vector<Clockable*> const clockables{netlist.get_clockables()};
+    for (Clockable *clockable : clockables) {
+        Component *component = dynamic_cast<Component*>(clockable);
+        if (component == nullptr || clockable->is_constant())
+            continue;
+        vector<Port*> const inputs = component->get_inputs();
+        vector<Net*> const regwires = clockable->get_start_wires();
+        if (inputs.size() != 1 || regwires.size() != 1)
+            continue;
+        Component *driver = netlist.get_driver(netlist.get_net(inputs[0]));
+        if (driver == nullptr)
+            continue;
+
+        Cone cone{netlist, driver, 64};
+        if (!cone.is_valid() || cone.get_outputs().size() != 1 || cone.get_input_count() != 1)
+            continue;
+        bool feedback = false;
+        for (Cone::Input const &in : cone.get_inputs()) {
+            feedback = feedback || (!in.constant && in.net == regwires[0]);
+        }
+        if (!feedback)
+            continue;
+
+        FusedRegister *fused = netlist.adopt(make_unique<FusedRegister>(netlist, clockable, cone, max_table_bits));
+        netlist.replace_clockable(clockable, fused);
+        stats.fused += 1;
+        stats.counters += fused->is_counter();
+    }
+    netlist.update();
+    return stats;
+}
+
+// The clockables driving the input of component, through combinational logic
+static void find_sources(Netlist const &netlist, Component *component,
+                         unordered_set<Component*> &visited, vector<Clockable*> &sources) {
+    for (Port *port : component->get_inputs()) {
+        Net *net = netlist.get_net(port);
+        if (net == nullptr)
+            continue;
+        if (Clockable *source = netlist.get_source(net)) {
+            sources.push_back(source);
+        } else if (Component *driver = netlist.get_driver(net)) {
+            if (visited.insert(driver).second)
+                find_sources(netlist, driver, visited, sources);
+        }
+    }
+}
+
+uint64_t fast_forward(Netlist const &netlist, Clock &clock, uint64_t cycles) {
+    // Register pipeline depth after the fused registers. Registers in a
+    // feedback loop, or unknown clockables, makes skipping unsafe.
+    bool safe = true;
+    unordered_map<Clockable*, int> depths{};
+    function<int(Clockable*)> depth = [&](Clockable *clockable) -> int {
+        auto it = depths.find(clockable);
+        if (it != depths.end()) {
+            safe = safe && (it->second >= 0);
+            return it->second;
+        }
+        if (clockable->is_constant() || dynamic_cast<FusedRegister*>(clockable))
+            return depths[clockable] = 0;
+        Component *component = dynamic_cast<Component*>(clockable);
+        if (component == nullptr) {
+            safe = false;
+            return 0;
+        }
+        depths[clockable] = -1;
+        unordered_set<Component*> visited{};
+        vector<Clockable*> sources{};
+        find_sources(netlist, component, visited, sources);
+        int d = 0;
+        for (Clockable *source : sources) {
+            d = max(d, depth(source));
+        }
+        return depths[clockable] = d + 1;
+    };
+
+    // One more cycle for the Sinks after the deepest register
+    uint64_t pipeline = 0;
+    for (Clockable *clockable : netlist.get_clockables()) {
+        pipeline = max(pipeline, static_cast<uint64_t>(depth(clockable)));
+    }
+    pipeline += 1;
+
+    uint64_t const skipped = (safe && cycles > pipeline) ? cycles - pipeline : 0;
+    if (skipped > 0) {
+        for (Clockable *clockable : netlist.get_clockables()) {
+            if (FusedRegister *fused = dynamic_cast<FusedRegister*>(clockable))
+                fused->fast_forward(skipped);
+        }
+    }
+    for (uint64_t i = skipped; i < cycles; ++i) {
+        clock.clock();
+    }
+    return skipped;
+}
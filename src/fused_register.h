@@ -0,0 +1,79 @@
+#ifndef FUSED_REGISTER_H_
+#define FUSED_REGISTER_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "clockable.h"
+#include "clock.h"
+#include "cone.h"
+#include "netlist.h"
+
+/* A FusedRegister replaces a Register whose next value only depends on its
+ * own value and Constants, such as a counter or an accumulator of a constant.
+ * The register and its feedback cone are updated in one step each cycle
+ * instead of through the set chain. The register is kept as the storage, so
+ * get_value() still works.
+ *
+ * The next value is calculated in the cheapest way available:
+ *   - Counters, next = value + increment, are calculated directly and can be
+ *     fast forwarded any number of cycles.
+ *   - Narrow registers use a table of next values.
+ *   - Otherwise the feedback cone is evaluated through its components.
+ */
+
+class FusedRegister: public Clockable {
+public:
+    FusedRegister(Netlist &netlist, Clockable *reg, Cone const &cone, int max_table_bits=16);
+    FusedRegister(FusedRegister const &) = delete;
+    void operator=(FusedRegister const &) = delete;
+
+    void clock() override;
+    void start_set_chain() override;
+    void start_reset_chain() override;
+
+    std::vector<Net*> get_start_wires() override;
+    uint64_t get_raw_state() const override { return reg->get_raw_state(); }
+    void set_raw_state(uint64_t state) override { reg->set_raw_state(state); }
+
+    Clockable *get_register() const { return reg; }
+    bool is_counter() const { return counter; }
+    uint64_t get_increment() const { return increment; }
+
+    // Advance a counter without evaluating the cycles in between
+    void fast_forward(uint64_t cycles);
+
+    uint64_t next_value(uint64_t value) const;
+    // next_value() sets the ports of the cone, it is neither a counter nor
+    // a table
+    bool uses_cone() const { return !counter && table.empty(); }
+
+private:
+    Clockable *reg;
+    Net *regwire;
+    Net *outwire{nullptr};
+    Cone const cone;
+    uint64_t const mask;
+    bool counter{false};
+    uint64_t increment{0};
+    std::vector<uint64_t> table{};
+    uint64_t next{0};
+};
+
+struct FusionStats {
+    int fused = 0;
+    int counters = 0;
+};
+
+// Replace every Register with a feedback cone only depending on itself and
+// Constants by a FusedRegister. Build the Clock from
+// netlist.get_clockables() after this pass.
+FusionStats fuse_feedback_registers(Netlist &netlist, int max_table_bits=16);
+
+// Run the design for a number of cycles, skipping as many as is safe with
+// FusedRegister::fast_forward(). That is possible when all other registers are
+// in feed forward logic, then only the last cycles, one more than the deepest
+// register pipeline, has to be clocked. Returns the number of skipped cycles.
+uint64_t fast_forward(Netlist const &netlist, Clock &clock, uint64_t cycles);
+
+#endif  // FUSED_REGISTER_H_
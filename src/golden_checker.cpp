@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstring>
+
+#include "golden_checker.h"
+
+using namespace std;
+
+namespace {
+
+uint64_t read_value(void const *data, size_t value_size) {
+    uint64_t value = 0;
+    memcpy(&value, data, value_size);
+    return value;
+}
+
+}  // namespace
+
+size_t first_difference(uint8_t const *a, uint8_t const *b, size_t size) {
+    size_t const PAGE = 4096;
+    size_t const BLOCK = 64;
+    size_t i = 0;
+    // memcmp() uses the widest vector instructions of the machine
+    while (i + PAGE <= size && memcmp(a + i, b + i, PAGE) == 0) {
+        i += PAGE;
+    }
+    // Without a branch inside a block, so the compiler vectorizes it
+    for (; i + BLOCK <= size; i += BLOCK) {
+        uint64_t difference = 0;
+        for (size_t k = 0; k < BLOCK; k += sizeof(uint64_t)) {
+            uint64_t x, y;
+            memcpy(&x, a + i + k, sizeof(x));
+            memcpy(&y, b + i + k, sizeof(y));
+            difference |= x ^ y;
+        }
+        if (difference != 0)
+            break;
+    }
+    for (; i < size; ++i) {
+        if (a[i] != b[i])
+            return i;
+    }
+    return size;
+}
+
+size_t GoldenChecker::add_signal(string const &name, size_t value_size, shared_ptr<MappedStimulus> mapped,
+        void const *expected, uint64_t expected_count, Source const &source) {
+    signals.push_back({name, value_size, std::move(mapped), static_cast<uint8_t const*>(expected),
+        expected_count, source, source.get_first()});
+    return signals.size() - 1;
+}
+
+Mismatch GoldenChecker::check() {
+    Mismatch first{};
+    for (size_t index = 0; index < signals.size(); ++index) {
+        Signal &signal = signals[index];
+        if (signal.checked < signal.source.get_first())
+            throw runtime_error(signal.name + ": values from " + to_string(signal.checked) +
+                " were overwritten before they were checked");
+        uint64_t const end = min(signal.source.get_count(), signal.expected_count);
+        uint64_t cycle = signal.checked;
+        // Cycles after a mismatch already found need no checking
+        while (cycle < end && (!first.found || cycle < first.cycle)) {
+            Span const span = signal.source.get_span(cycle, end - cycle);
+            uint8_t const *actual = static_cast<uint8_t const*>(span.data);
+            uint8_t const *expected = signal.expected + cycle * signal.value_size;
+            size_t const bytes = span.size * signal.value_size;
+            size_t const difference = first_difference(actual, expected, bytes);
+            if (difference == bytes) {
+                cycle += span.size;
+                continue;
+            }
+            size_t const value = difference / signal.value_size;
+            uint64_t const at = cycle + value;
+            if (!first.found || at < first.cycle) {
+                first.found = true;
+                first.cycle = at;
+                first.signal = index;
+                first.expected = read_value(expected + value * signal.value_size, signal.value_size);
+                first.actual = read_value(actual + value * signal.value_size, signal.value_size);
+            }
+            // A mismatch which is not the first is found again by the next check
+            cycle = at;
+            break;
+        }
+        signal.checked = cycle;
+    }
+    // The next check goes on after the mismatch returned
+    if (first.found)
+        signals[first.signal].checked = first.cycle + 1;
+    return first;
+}
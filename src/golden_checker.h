@@ -0,0 +1,117 @@
+#ifndef GOLDEN_CHECKER_H_
+#define GOLDEN_CHECKER_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
+
+#include "recording_sink.h"
+#include "input_stream.h"
+
+/* Compares recorded outputs with golden ones, many cycles at a time.
+ *
+ * Every signal has a stream of expected values, a file in the format of an
+ * InputStream or a buffer, and recorded values, from a RecordingSink or a
+ * buffer. check() compares the values recorded since the last check and
+ * returns the first cycle which differs, and in which signal:
+ *
+ *   GoldenChecker checker{};
+ *   checker.add("Sum", sum_sink, "sum.golden");
+ *   for (...) {
+ *       clock.clock();
+ *       if (cycle % 4096 == 0 && checker.check().found) break;
+ *   }
+ *
+ * Values are compared a page at a time with memcmp(), which uses the widest
+ * vector instructions of the machine. A page which differs is narrowed down
+ * to 64 bytes by or-ing the xor of words, which the compiler vectorizes, and
+ * only then searched value by value.
+ */
+
+struct Mismatch {
+    bool found = false;
+    uint64_t cycle = 0;
+    size_t signal = 0;
+    uint64_t expected = 0;
+    uint64_t actual = 0;
+};
+
+// The index of the first byte which differs, or size
+size_t first_difference(uint8_t const *a, uint8_t const *b, size_t size);
+
+class GoldenChecker {
+public:
+    GoldenChecker() = default;
+    GoldenChecker(GoldenChecker const &) = delete;
+    GoldenChecker &operator=(GoldenChecker const &) = delete;
+
+    // Recorded by a sink, expected in a stimulus file or a buffer of count
+    // values, which must outlive the checker. Returns the index of the signal.
+    template <int N>
+    size_t add(std::string const &name, RecordingSink<N> const &sink, std::string const &path) {
+        auto mapped = std::make_shared<MappedStimulus>(path);
+        if (mapped->get_size() % sizeof(T<N>) != 0)
+            throw std::runtime_error(path + " is not a whole number of " + std::to_string(N) + " bit values");
+        return add_signal(name, sizeof(T<N>), mapped, mapped->get_data(), mapped->get_size() / sizeof(T<N>),
+            make_source(sink));
+    }
+    template <int N>
+    size_t add(std::string const &name, RecordingSink<N> const &sink, T<N> const *expected, size_t count) {
+        return add_signal(name, sizeof(T<N>), nullptr, expected, count, make_source(sink));
+    }
+    // Recorded in a vector, which may grow between checks
+    template <typename Value>
+    size_t add(std::string const &name, std::vector<Value> const &actual, Value const *expected, size_t count) {
+        Source source{[&actual](uint64_t first, size_t size) -> Span { return {actual.data() + first, size}; },
+            [&actual]() { return uint64_t{actual.size()}; }, []() { return uint64_t{0}; }};
+        return add_signal(name, sizeof(Value), nullptr, expected, count, source);
+    }
+
+    // Compare the values recorded since the last check, up to the end of the
+    // expected values. Throws if a sink overwrote values before they were
+    // checked.
+    Mismatch check();
+
+    std::string const &get_name(size_t signal) const { return signals.at(signal).name; }
+    // The cycles checked of a signal
+    uint64_t get_checked(size_t signal) const { return signals.at(signal).checked; }
+
+private:
+    struct Span {
+        void const *data;
+        size_t size;
+    };
+    // Where the recorded values of a signal are
+    struct Source {
+        std::function<Span(uint64_t first, size_t size)> get_span;
+        std::function<uint64_t()> get_count;
+        std::function<uint64_t()> get_first;
+    };
+    struct Signal {
+        std::string name;
+        size_t value_size;
+        std::shared_ptr<MappedStimulus> mapped;
+        uint8_t const *expected;
+        uint64_t expected_count;
+        Source source;
+        uint64_t checked;
+    };
+
+    template <int N>
+    static Source make_source(RecordingSink<N> const &sink) {
+        return {[&sink](uint64_t first, size_t size) -> Span {
+                auto span = sink.get_span(first, size);
+                return {span.data, span.size};
+            }, [&sink]() { return sink.get_count(); }, [&sink]() { return sink.get_first(); }};
+    }
+
+    size_t add_signal(std::string const &name, size_t value_size, std::shared_ptr<MappedStimulus> mapped,
+        void const *expected, uint64_t expected_count, Source const &source);
+
+    std::vector<Signal> signals{};
+};
+
+#endif  // GOLDEN_CHECKER_H_
@@ -0,0 +1,797 @@
+#include <unordered_set>
+#include <sstream>
+#include <stdexcept>
+#include <cctype>
+
+#include "importer.h"
+#include "wire.h"
+#include "adder.h"
+#include "register.h"
+#include "constant.h"
+#include "simple_components.h"
+#include "sink.h"
+
+using namespace std;
+
+// A signal bit, bits below CONSTANT_0 are made by the importer
+using Bit = int64_t;
+Bit const CONSTANT_0 = -1;
+Bit const CONSTANT_1 = -2;
+
+/* Builds an ImportedDesign bit by bit. Wires are made when a bit is first
+ * seen, as a driver or as a target, so cells can come in any order.
+ */
+class DesignBuilder {
+public:
+    explicit DesignBuilder(ImportedDesign &design): design{design} {}
+    DesignBuilder(DesignBuilder const &) = delete;
+    DesignBuilder &operator=(DesignBuilder const &) = delete;
+
+    Bit new_bit() { return next_bit--; }
+    Bit get_bit(string const &name);
+
+    void add_input(string const &port, size_t index, Bit bit);
+    void add_output(string const &port, size_t index, Bit bit);
+    void add_constant(bool value, Bit y);
+    void add_gate(Operation operation, Bit a, Bit b, Bit y, string const &name);
+    // The last gate of the tree drives y
+    void add_tree(Operation operation, vector<Bit> const &terms, Bit y, string const &name);
+    void add_adder(vector<Bit> const &a, vector<Bit> const &b, vector<Bit> const &y, string const &name);
+    void add_register(Bit d, Bit q, bool initial, string const &name, size_t index);
+    void finish();
+
+    ImportStats &get_stats() { return design.stats; }
+
+private:
+    template <typename U>
+    U *own(unique_ptr<U> object) {
+        U *ptr = object.get();
+        design.owned.emplace_back(shared_ptr<U>(std::move(object)));
+        return ptr;
+    }
+
+    template <typename P>
+    static void place(vector<P*> &bits, size_t index, P *bit) {
+        if (bits.size() <= index)
+            bits.resize(index + 1, nullptr);
+        bits[index] = bit;
+    }
+
+    Wire<1> *get_wire(Bit bit, string const &name="");
+    Wire<1> *drive(Bit bit, string const &name);
+
+    ImportedDesign &design;
+    unordered_map<Bit, Wire<1>*> wires{};
+    unordered_map<string, Bit> names{};
+    unordered_set<Bit> driven{};
+    Bit next_bit{CONSTANT_1 - 1};
+};
+
+Bit DesignBuilder::get_bit(string const &name) {
+    auto it = names.find(name);
+    if (it != names.end())
+        return it->second;
+    Bit const bit = new_bit();
+    names[name] = bit;
+    get_wire(bit, name);
+    return bit;
+}
+
+Wire<1> *DesignBuilder::get_wire(Bit bit, string const &name) {
+    auto it = wires.find(bit);
+    if (it != wires.end())
+        return it->second;
+
+    Wire<1> *wire = own(make_unique<Wire<1>>(name.empty() ? "n" + to_string(bit) : name));
+    wires[bit] = wire;
+    if (bit == CONSTANT_0 || bit == CONSTANT_1) {
+        design.clockables.push_back(own(make_unique<Constant<1>>(BitVector<1>{bit == CONSTANT_1}, wire)));
+        driven.insert(bit);
+    }
+    return wire;
+}
+
+Wire<1> *DesignBuilder::drive(Bit bit, string const &name) {
+    if (bit == CONSTANT_0 || bit == CONSTANT_1)
+        throw runtime_error(name + " drives a constant");
+    if (!driven.insert(bit).second)
+        throw runtime_error(name + " drives a bit which is already driven");
+    return get_wire(bit);
+}
+
+void DesignBuilder::add_input(string const &port, size_t index, Bit bit) {
+    string const name = port + "[" + to_string(index) + "]";
+    Wire<1> *wire = drive(bit, name);
+    // Feeds itself, so it keeps the value it is set to
+    Register<1> *input = own(make_unique<Register<1>>(wire, name));
+    wire->add_targets(&input->input);
+    design.clockables.push_back(input);
+    place(design.inputs[port], index, static_cast<Clockable*>(input));
+    design.stats.inputs += 1;
+}
+
+void DesignBuilder::add_output(string const &port, size_t index, Bit bit) {
+    Sink<1> *output = own(make_unique<Sink<1>>(port + "[" + to_string(index) + "]"));
+    get_wire(bit)->add_targets(&output->input);
+    place(design.outputs[port], index, static_cast<Component*>(output));
+    design.stats.outputs += 1;
+}
+
+void DesignBuilder::add_constant(bool value, Bit y) {
+    design.clockables.push_back(own(make_unique<Constant<1>>(BitVector<1>{value}, drive(y, "Constant"))));
+}
+
+void DesignBuilder::add_gate(Operation operation, Bit a, Bit b, Bit y, string const &name) {
+    Wire<1> *out = drive(y, name);
+    design.stats.gates += 1;
+    if (operation == Operation::Not) {
+        Inverter<1> *gate = own(make_unique<Inverter<1>>(out, name));
+        get_wire(a)->add_targets(&gate->input);
+        return;
+    }
+
+    SimpleComponent<1, 2> *gate = nullptr;
+    switch (operation) {
+    case Operation::And: gate = own(make_unique<ANDGate<1>>(out, name)); break;
+    case Operation::Nand: gate = own(make_unique<NANDGate<1>>(out, name)); break;
+    case Operation::Or: gate = own(make_unique<ORGate<1>>(out, name)); break;
+    case Operation::Xor: gate = own(make_unique<XORGate<1>>(out, name)); break;
+    case Operation::Nor: gate = own(make_unique<NORGate<1>>(out, name)); break;
+    default:
+        throw runtime_error(name + " is not a gate");
+    }
+    get_wire(a)->add_targets(&gate->input[0]);
+    get_wire(b)->add_targets(&gate->input[1]);
+}
+
+void DesignBuilder::add_tree(Operation operation, vector<Bit> const &terms, Bit y, string const &name) {
+    if (terms.size() == 1) {
+        // A buffer, which the compiler turns into an alias
+        add_gate(Operation::And, terms[0], terms[0], y, name);
+        return;
+    }
+    Bit acc = terms.at(0);
+    for (size_t i = 1; i < terms.size(); ++i) {
+        Bit const out = (i + 1 == terms.size()) ? y : new_bit();
+        add_gate(operation, acc, terms[i], out, name);
+        acc = out;
+    }
+}
+
+void DesignBuilder::add_adder(vector<Bit> const &a, vector<Bit> const &b, vector<Bit> const &y, string const &name) {
+    Bit carry = CONSTANT_0;
+    for (size_t i = 0; i < y.size(); ++i) {
+        string const cell = name + "[" + to_string(i) + "]";
+        Wire<1> *sum = drive(y[i], cell);
+        Adder<1> *adder = nullptr;
+        Bit cout = CONSTANT_0;
+        if (i + 1 < y.size()) {
+            cout = new_bit();
+            adder = own(make_unique<Adder<1>>(drive(cout, cell), sum, cell));
+        } else {
+            adder = own(make_unique<Adder<1>>(sum, cell));
+        }
+        get_wire(a.at(i))->add_targets(&adder->A);
+        get_wire(b.at(i))->add_targets(&adder->B);
+        get_wire(carry)->add_targets(&adder->Cin);
+        carry = cout;
+        design.stats.adders += 1;
+    }
+}
+
+void DesignBuilder::add_register(Bit d, Bit q, bool initial, string const &name, size_t index) {
+    string const cell = name + "[" + to_string(index) + "]";
+    Register<1> *reg = own(make_unique<Register<1>>(BitVector<1>{initial}, drive(q, cell), cell));
+    get_wire(d)->add_targets(&reg->input);
+    design.clockables.push_back(reg);
+    place(design.registers[name], index, static_cast<Clockable*>(reg));
+    design.stats.registers += 1;
+}
+
+void DesignBuilder::finish() {
+    for (auto const &entry : wires) {
+        if (!driven.count(entry.first) && !entry.second->get_targets().empty()) {
+            design.clockables.push_back(own(make_unique<Constant<1>>(BitVector<1>{0}, entry.second)));
+            design.stats.undriven += 1;
+        }
+    }
+    design.stats.wires = wires.size();
+
+    auto check = [](auto const &ports, string const &kind) {
+        for (auto const &port : ports) {
+            for (auto const *bit : port.second) {
+                if (bit == nullptr)
+                    throw runtime_error(port.first + " is missing bits of the " + kind);
+            }
+        }
+    };
+    check(design.inputs, "input");
+    check(design.outputs, "output");
+    check(design.registers, "register");
+}
+
+vector<Clockable*> const &ImportedDesign::get_input(string const &port) const {
+    auto it = inputs.find(port);
+    if (it == inputs.end())
+        throw runtime_error(port + " is not an input of the design");
+    return it->second;
+}
+
+vector<Component*> const &ImportedDesign::get_output(string const &port) const {
+    auto it = outputs.find(port);
+    if (it == outputs.end())
+        throw runtime_error(port + " is not an output of the design");
+    return it->second;
+}
+
+vector<Clockable*> const &ImportedDesign::get_register(string const &name) const {
+    auto it = registers.find(name);
+    if (it == registers.end())
+        throw runtime_error(name + " is not a register of the design");
+    return it->second;
+}
+
+namespace {
+
+/* A pull parser for JSON, which reads one token at a time from a stream.
+ * Values which are not needed are skipped without being stored.
+ */
+class JsonReader {
+public:
+    explicit JsonReader(istream &in): buffer{in.rdbuf()} {}
+    JsonReader(JsonReader const &) = delete;
+    JsonReader &operator=(JsonReader const &) = delete;
+
+    // The next character which is not white space, 0 at the end
+    char peek();
+    void expect(char c);
+    // Read the key of the next member of an object, after the '{'. False at
+    // the end of the object.
+    bool next_member(string &key);
+    // Move to the next element of an array, after the '['
+    bool next_element();
+    string read_string();
+    int64_t read_integer();
+    void skip();
+
+    [[noreturn]] void error(string const &what) const {
+        throw runtime_error("JSON line " + to_string(line) + ": " + what);
+    }
+
+private:
+    streambuf *buffer;
+    int line{1};
+};
+
+char JsonReader::peek() {
+    while (true) {
+        int const c = buffer->sgetc();
+        if (c == EOF)
+            return 0;
+        if (!isspace(c))
+            return static_cast<char>(c);
+        if (c == '\n')
+            line += 1;
+        buffer->sbumpc();
+    }
+}
+
+void JsonReader::expect(char c) {
+    if (peek() != c)
+        error(string("expected '") + c + "'");
+    buffer->sbumpc();
+}
+
+bool JsonReader::next_member(string &key) {
+    char c = peek();
+    if (c == ',') {
+        buffer->sbumpc();
+        c = peek();
+    }
+    if (c == '}') {
+        buffer->sbumpc();
+        return false;
+    }
+    key = read_string();
+    expect(':');
+    return true;
+}
+
+bool JsonReader::next_element() {
+    char c = peek();
+    if (c == ',') {
+        buffer->sbumpc();
+        c = peek();
+    }
+    if (c == ']') {
+        buffer->sbumpc();
+        return false;
+    }
+    return true;
+}
+
+string JsonReader::read_string() {
+    expect('"');
+    string value{};
+    while (true) {
+        int c = buffer->sbumpc();
+        if (c == EOF)
+            error("unterminated string");
+        if (c == '"')
+            return value;
+        if (c == '\\') {
+            c = buffer->sbumpc();
+            switch (c) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'u': {
+                int code = 0;
+                for (int i = 0; i < 4; ++i) {
+                    int const digit = buffer->sbumpc();
+                    if (!isxdigit(digit))
+                        error("bad escape in string");
+                    code = code * 16 + (isdigit(digit) ? digit - '0' : tolower(digit) - 'a' + 10);
+                }
+                c = (code < 128) ? code : '?';
+                break;
+            }
+            case EOF:
+                error("unterminated string");
+            default:
+                break;
+            }
+        }
+        value.push_back(static_cast<char>(c));
+    }
+}
+
+int64_t JsonReader::read_integer() {
+    bool const negative = peek() == '-';
+    if (negative)
+        buffer->sbumpc();
+    if (!isdigit(buffer->sgetc()))
+        error("expected a number");
+    int64_t value = 0;
+    while (isdigit(buffer->sgetc())) {
+        value = value * 10 + (buffer->sbumpc() - '0');
+    }
+    return negative ? -value : value;
+}
+
+void JsonReader::skip() {
+    char const c = peek();
+    string key{};
+    if (c == '{') {
+        buffer->sbumpc();
+        while (next_member(key)) {
+            skip();
+        }
+    } else if (c == '[') {
+        buffer->sbumpc();
+        while (next_element()) {
+            skip();
+        }
+    } else if (c == '"') {
+        read_string();
+    } else {
+        // Numbers, true, false and null
+        bool any = false;
+        while (isalnum(buffer->sgetc()) || buffer->sgetc() == '-' || buffer->sgetc() == '+' || buffer->sgetc() == '.') {
+            buffer->sbumpc();
+            any = true;
+        }
+        if (!any)
+            error("unexpected character");
+    }
+}
+
+// Bits of a connection or port, "0", "1", "x" and "z" are constants
+vector<Bit> read_bits(JsonReader &json) {
+    vector<Bit> bits{};
+    json.expect('[');
+    while (json.next_element()) {
+        if (json.peek() == '"')
+            bits.push_back(json.read_string() == "1" ? CONSTANT_1 : CONSTANT_0);
+        else
+            bits.push_back(json.read_integer());
+    }
+    return bits;
+}
+
+// Parameters are integers or strings of binary digits
+int64_t read_parameter(JsonReader &json) {
+    if (json.peek() != '"')
+        return json.read_integer();
+    int64_t value = 0;
+    for (char c : json.read_string()) {
+        if (c != '0' && c != '1' && c != 'x' && c != 'z')
+            return 0;
+        value = value * 2 + (c == '1');
+    }
+    return value;
+}
+
+struct Cell {
+    string name{};
+    string type{};
+    unordered_map<string, int64_t> parameters{};
+    unordered_map<string, vector<Bit>> connections{};
+
+    int64_t get_parameter(string const &parameter) const {
+        auto it = parameters.find(parameter);
+        return (it != parameters.end()) ? it->second : 0;
+    }
+
+    vector<Bit> const &get_port(string const &port) const {
+        auto it = connections.find(port);
+        if (it == connections.end())
+            throw runtime_error(name + " has no port " + port);
+        return it->second;
+    }
+
+    // A port extended or truncated to width, like Yosys does
+    vector<Bit> get_port(string const &port, size_t width) const {
+        vector<Bit> bits = get_port(port);
+        bool const is_signed = get_parameter(port + "_SIGNED") != 0 && !bits.empty();
+        bits.resize(width, is_signed ? bits.back() : CONSTANT_0);
+        return bits;
+    }
+};
+
+void add_cell(DesignBuilder &builder, Cell const &cell) {
+    static unordered_map<string, Operation> const word_gates{
+        {"$and", Operation::And}, {"$or", Operation::Or}, {"$xor", Operation::Xor}, {"$not", Operation::Not}};
+    static unordered_map<string, Operation> const bit_gates{
+        {"$_AND_", Operation::And}, {"$_NAND_", Operation::Nand}, {"$_OR_", Operation::Or},
+        {"$_XOR_", Operation::Xor}, {"$_NOR_", Operation::Nor}, {"$_NOT_", Operation::Not}};
+    builder.get_stats().cells += 1;
+
+    auto word = word_gates.find(cell.type);
+    if (word != word_gates.end()) {
+        vector<Bit> const &y = cell.get_port("Y");
+        vector<Bit> const a = cell.get_port("A", y.size());
+        vector<Bit> const b = (word->second == Operation::Not) ? a : cell.get_port("B", y.size());
+        for (size_t i = 0; i < y.size(); ++i) {
+            builder.add_gate(word->second, a[i], b[i], y[i], cell.name + "[" + to_string(i) + "]");
+        }
+        return;
+    }
+
+    auto bit = bit_gates.find(cell.type);
+    if (bit != bit_gates.end()) {
+        Bit const a = cell.get_port("A").at(0);
+        Bit const b = (bit->second == Operation::Not) ? a : cell.get_port("B").at(0);
+        builder.add_gate(bit->second, a, b, cell.get_port("Y").at(0), cell.name);
+        return;
+    }
+
+    if (cell.type == "$add") {
+        vector<Bit> const &y = cell.get_port("Y");
+        builder.add_adder(cell.get_port("A", y.size()), cell.get_port("B", y.size()), y, cell.name);
+    } else if (cell.type == "$dff" || cell.type == "$_DFF_P_") {
+        vector<Bit> const &d = cell.get_port("D");
+        vector<Bit> const &q = cell.get_port("Q");
+        for (size_t i = 0; i < q.size(); ++i) {
+            builder.add_register(d.at(i), q[i], false, cell.name, i);
+        }
+    } else {
+        throw runtime_error(cell.name + " is a " + cell.type + " cell, which can not be imported");
+    }
+}
+
+void read_ports(JsonReader &json, DesignBuilder &builder) {
+    string name{};
+    string key{};
+    json.expect('{');
+    while (json.next_member(name)) {
+        string direction{};
+        vector<Bit> bits{};
+        json.expect('{');
+        while (json.next_member(key)) {
+            if (key == "direction")
+                direction = json.read_string();
+            else if (key == "bits")
+                bits = read_bits(json);
+            else
+                json.skip();
+        }
+
+        for (size_t i = 0; i < bits.size(); ++i) {
+            if (direction == "input")
+                builder.add_input(name, i, bits[i]);
+            else if (direction == "output")
+                builder.add_output(name, i, bits[i]);
+            else
+                throw runtime_error(name + " is an " + direction + " port, which can not be imported");
+        }
+    }
+}
+
+void read_cells(JsonReader &json, DesignBuilder &builder) {
+    string key{};
+    string member{};
+    json.expect('{');
+    Cell cell{};
+    while (json.next_member(cell.name)) {
+        json.expect('{');
+        while (json.next_member(key)) {
+            if (key == "type") {
+                cell.type = json.read_string();
+            } else if (key == "parameters") {
+                json.expect('{');
+                while (json.next_member(member)) {
+                    cell.parameters[member] = read_parameter(json);
+                }
+            } else if (key == "connections") {
+                json.expect('{');
+                while (json.next_member(member)) {
+                    cell.connections[member] = read_bits(json);
+                }
+            } else {
+                json.skip();
+            }
+        }
+        add_cell(builder, cell);
+        cell.parameters.clear();
+        cell.connections.clear();
+    }
+}
+
+void read_module(JsonReader &json, DesignBuilder &builder) {
+    string key{};
+    json.expect('{');
+    while (json.next_member(key)) {
+        if (key == "ports")
+            read_ports(json, builder);
+        else if (key == "cells")
+            read_cells(json, builder);
+        else
+            json.skip();
+    }
+}
+
+// Bits of a BLIF port, the ports are vectors indexed by bit
+size_t const MAX_PORT_BITS = size_t{1} << 20;
+
+// The port and index of a BLIF signal, "name[3]" is bit 3 of name
+pair<string, size_t> split_bit(string const &signal) {
+    size_t const open = signal.rfind('[');
+    if (signal.empty() || signal.back() != ']' || open == string::npos || open + 2 >= signal.size())
+        return {signal, 0};
+    string const index = signal.substr(open + 1, signal.size() - open - 2);
+    for (char c : index) {
+        if (!isdigit(static_cast<unsigned char>(c)))
+            return {signal, 0};
+    }
+    // 19 digits fit in 64 bits, stoul() throws on more
+    if (index.size() > 19 || stoul(index) >= MAX_PORT_BITS)
+        throw runtime_error(signal + ": a port has at most " + to_string(MAX_PORT_BITS) + " bits");
+    return {signal.substr(0, open), stoul(index)};
+}
+
+// A .names cover, the output is value for the input cubes listed
+struct Cover {
+    vector<Bit> inputs{};
+    Bit output{0};
+    string name{};
+    vector<string> cubes{};
+    char value{'1'};
+
+    bool evaluate(size_t combination) const {
+        for (string const &cube : cubes) {
+            bool match = true;
+            for (size_t i = 0; i < inputs.size() && match; ++i) {
+                bool const bit = (combination >> i) & 1;
+                match = cube[i] == '-' || (cube[i] == '1') == bit;
+            }
+            if (match)
+                return value == '1';
+        }
+        return value != '1';
+    }
+};
+
+void add_cover(DesignBuilder &builder, Cover const &cover) {
+    builder.get_stats().cells += 1;
+    for (string const &cube : cover.cubes) {
+        if (cube.size() != cover.inputs.size())
+            throw runtime_error(cover.name + " has a cube of the wrong width");
+    }
+
+    // Functions of up to two inputs are single gates
+    if (cover.inputs.size() <= 2) {
+        unsigned table = 0;
+        for (size_t i = 0; i < (1u << cover.inputs.size()); ++i) {
+            table |= cover.evaluate(i) << i;
+        }
+        unsigned const all = (1u << (1u << cover.inputs.size())) - 1;
+        if (table == 0 || table == all) {
+            builder.add_constant(table != 0, cover.output);
+            return;
+        }
+        Bit const a = cover.inputs[0];
+        Bit const b = cover.inputs.back();
+        if (cover.inputs.size() == 1) {
+            Operation const operation = (table == 0b10) ? Operation::And : Operation::Not;
+            builder.add_gate(operation, a, a, cover.output, cover.name);
+            return;
+        }
+        static unordered_map<unsigned, Operation> const gates{
+            {0b1000, Operation::And}, {0b0111, Operation::Nand}, {0b1110, Operation::Or},
+            {0b0110, Operation::Xor}, {0b0001, Operation::Nor}};
+        auto gate = gates.find(table);
+        if (gate != gates.end()) {
+            builder.add_gate(gate->second, a, b, cover.output, cover.name);
+            return;
+        }
+    }
+
+    // Sum of products
+    vector<Bit> inverted(cover.inputs.size(), CONSTANT_0);
+    vector<Bit> products{};
+    for (string const &cube : cover.cubes) {
+        vector<Bit> literals{};
+        for (size_t i = 0; i < cube.size(); ++i) {
+            if (cube[i] == '1') {
+                literals.push_back(cover.inputs[i]);
+            } else if (cube[i] == '0') {
+                if (inverted[i] == CONSTANT_0) {
+                    inverted[i] = builder.new_bit();
+                    builder.add_gate(Operation::Not, cover.inputs[i], cover.inputs[i], inverted[i], cover.name);
+                }
+                literals.push_back(inverted[i]);
+            }
+        }
+        if (literals.empty()) {
+            builder.add_constant(cover.value == '1', cover.output);
+            return;
+        }
+        products.push_back(builder.new_bit());
+        builder.add_tree(Operation::And, literals, products.back(), cover.name);
+    }
+    if (products.empty()) {
+        builder.add_constant(cover.value != '1', cover.output);
+    } else if (cover.value == '1') {
+        builder.add_tree(Operation::Or, products, cover.output, cover.name);
+    } else {
+        Bit const sum = builder.new_bit();
+        builder.add_tree(Operation::Or, products, sum, cover.name);
+        builder.add_gate(Operation::Not, sum, sum, cover.output, cover.name);
+    }
+}
+
+}  // namespace
+
+ImportedDesign import_yosys_json(istream &in, string const &top) {
+    ImportedDesign design{};
+    DesignBuilder builder{design};
+    JsonReader json{in};
+    bool found = false;
+    string key{};
+    string module{};
+
+    json.expect('{');
+    while (json.next_member(key)) {
+        if (key != "modules") {
+            json.skip();
+            continue;
+        }
+        json.expect('{');
+        while (json.next_member(module)) {
+            if (!top.empty() && module != top) {
+                json.skip();
+                continue;
+            }
+            if (found)
+                throw runtime_error("The design has more than one module, name the top module");
+            found = true;
+            read_module(json, builder);
+        }
+    }
+    if (!found)
+        throw runtime_error(top.empty() ? string("The design has no modules") : top + " is not a module of the design");
+
+    builder.finish();
+    return design;
+}
+
+ImportedDesign import_blif(istream &in, string const &model) {
+    ImportedDesign design{};
+    DesignBuilder builder{design};
+    bool found = false;
+    bool active = false;
+    Cover cover{};
+    bool in_cover = false;
+    string line{};
+    string part{};
+    int number = 0;
+
+    auto flush = [&]() {
+        if (in_cover)
+            add_cover(builder, cover);
+        in_cover = false;
+    };
+
+    while (getline(in, line)) {
+        number += 1;
+        // Continued lines
+        while (!line.empty() && line.back() == '\\' && getline(in, part)) {
+            line.pop_back();
+            line += part;
+            number += 1;
+        }
+        size_t const comment = line.find('#');
+        if (comment != string::npos)
+            line.erase(comment);
+
+        istringstream tokens{line};
+        vector<string> words{};
+        for (string word; tokens >> word;) {
+            words.push_back(word);
+        }
+        if (words.empty())
+            continue;
+
+        string const &directive = words[0];
+        if (directive[0] != '.') {
+            if (!active)
+                continue;
+            if (!in_cover)
+                throw runtime_error("BLIF line " + to_string(number) + ": a cube outside of .names");
+            // Covers without inputs only have the output column
+            bool const constant = cover.inputs.empty();
+            cover.cubes.push_back(constant ? "" : directive);
+            cover.value = constant ? directive[0] : words.at(1)[0];
+            continue;
+        }
+        flush();
+
+        if (directive == ".model") {
+            string const name = (words.size() > 1) ? words[1] : "";
+            active = !found && (model.empty() || model == name);
+            found = found || active;
+        } else if (directive == ".end") {
+            active = false;
+        } else if (!active) {
+            continue;
+        } else if (directive == ".inputs" || directive == ".outputs") {
+            for (size_t i = 1; i < words.size(); ++i) {
+                auto const port = split_bit(words[i]);
+                if (directive == ".inputs")
+                    builder.add_input(port.first, port.second, builder.get_bit(words[i]));
+                else
+                    builder.add_output(port.first, port.second, builder.get_bit(words[i]));
+            }
+        } else if (directive == ".names") {
+            if (words.size() < 2)
+                throw runtime_error("BLIF line " + to_string(number) + ": .names without an output");
+            cover.inputs.clear();
+            for (size_t i = 1; i + 1 < words.size(); ++i) {
+                cover.inputs.push_back(builder.get_bit(words[i]));
+            }
+            cover.output = builder.get_bit(words.back());
+            cover.name = words.back();
+            cover.cubes.clear();
+            cover.value = '1';
+            in_cover = true;
+        } else if (directive == ".latch") {
+            if (words.size() < 3)
+                throw runtime_error("BLIF line " + to_string(number) + ": .latch needs an input and an output");
+            bool const initial = (words.size() == 4 || words.size() == 6) && words.back() == "1";
+            auto const reg = split_bit(words[2]);
+            builder.get_stats().cells += 1;
+            builder.add_register(builder.get_bit(words[1]), builder.get_bit(words[2]), initial, reg.first, reg.second);
+        } else {
+            throw runtime_error("BLIF line " + to_string(number) + ": " + directive + " can not be imported");
+        }
+    }
+    flush();
+    if (!found)
+        throw runtime_error(model.empty() ? string("The design has no models") : model + " is not a model of the design");
+
+    builder.finish();
+    return design;
+}
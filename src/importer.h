@@ -0,0 +1,82 @@
+#ifndef IMPORTER_H_
+#define IMPORTER_H_
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <istream>
+#include <unordered_map>
+
+#include "clockable.h"
+#include "component.h"
+
+/* Importers for synthesized netlists, Yosys JSON (write_json) and BLIF
+ * (write_blif).
+ *
+ * The file is read in one pass without building a document: a cell is
+ * created as soon as it has been read, so only the design itself is kept in
+ * memory. Designs are imported at bit level, every signal bit becomes a
+ * Wire<1>:
+ *   $and, $or, $xor, $not    ANDGate, ORGate, XORGate, Inverter per bit
+ *   $_AND_, $_NAND_, $_OR_,  the 1 bit gates
+ *   $_XOR_, $_NOR_, $_NOT_
+ *   $add                     a ripple carry chain of Adder<1>
+ *   $dff, $_DFF_P_           Register<1> per bit
+ *   BLIF .names              the matching gate, or Inverters, ANDGates and
+ *                            ORGates for the sum of products
+ *   BLIF .latch              Register<1>
+ * Use lift_words() on the compiled program to get the words back.
+ *
+ * There is one clock, the clock inputs of registers are not connected. Input
+ * ports become Registers which keep their value, set them with
+ * set_raw_state() or Simulator::set_state(). Output ports become Sinks.
+ * Bits of port "name" are named "name[i]" in BLIF, a port has at most 2^20
+ * bits.
+ */
+
+struct ImportStats {
+    int cells = 0;        // Cells in the file
+    int gates = 0;        // Gates, including those of .names covers
+    int adders = 0;       // Adder<1> cells
+    int registers = 0;    // Register<1> cells, without the inputs
+    int inputs = 0;       // Input bits
+    int outputs = 0;      // Output bits
+    int wires = 0;
+    int undriven = 0;     // Bits which are read but not driven, set to 0
+};
+
+class ImportedDesign {
+public:
+    ImportedDesign() = default;
+    ImportedDesign(ImportedDesign const &) = delete;
+    ImportedDesign &operator=(ImportedDesign const &) = delete;
+    ImportedDesign(ImportedDesign &&) = default;
+    ImportedDesign &operator=(ImportedDesign &&) = default;
+
+    // All registers, inputs and constants, to make a Netlist or a Clock
+    std::vector<Clockable*> const &get_clockables() const { return clockables; }
+
+    // Bits of a port or register, the least significant first
+    std::vector<Clockable*> const &get_input(std::string const &port) const;
+    std::vector<Component*> const &get_output(std::string const &port) const;
+    std::vector<Clockable*> const &get_register(std::string const &name) const;
+
+    ImportStats const &get_stats() const { return stats; }
+
+private:
+    friend class DesignBuilder;
+
+    std::vector<Clockable*> clockables{};
+    std::unordered_map<std::string, std::vector<Clockable*>> inputs{};
+    std::unordered_map<std::string, std::vector<Component*>> outputs{};
+    std::unordered_map<std::string, std::vector<Clockable*>> registers{};
+    std::vector<std::shared_ptr<void>> owned{};
+    ImportStats stats{};
+};
+
+// Import module top, or the only module if top is empty
+ImportedDesign import_yosys_json(std::istream &in, std::string const &top="");
+// Import model, or the first model if model is empty
+ImportedDesign import_blif(std::istream &in, std::string const &model="");
+
+#endif  // IMPORTER_H_
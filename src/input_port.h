@@ -2,14 +2,28 @@
 #define INPUT_PORT_H_
 
 #include <iostream>
+#include <cstdint>
 
 #include "component.h"
 #include "bit_vector.h"
 
+/* Port is the width independent view of an InputPort. It is used by the
+ * elaboration passes (see netlist.h) which walk and rewire the design without
+ * knowing the widths at compile time.
+ */
+class Port: public Entity {
+public:
+    Port(std::string const &name="Port"): Entity(name) {}
+    virtual int get_width() const = 0;
+    virtual Component *get_parent() const = 0;
+    virtual uint64_t get_raw() = 0;
+    virtual void set_raw(uint64_t val) = 0;
+};
+
 template<int N>
-class InputPort: public Entity {
+class InputPort: public Port {
 public:
-    InputPort(Component *parent=nullptr, std::string const &name="InputPort"): Entity(name), parent{parent} {};
+    InputPort(Component *parent=nullptr, std::string const &name="InputPort"): Port(name), parent{parent} {};
     InputPort(InputPort const& other) = delete;
     InputPort &operator=(InputPort const& other) {
         parent = other.parent;
@@ -34,6 +48,11 @@ public:
     }
     BitVector<N> get_value() { return value; }
 
+    int get_width() const override { return N; }
+    Component *get_parent() const override { return parent; }
+    uint64_t get_raw() override { return value.get_value(); }
+    void set_raw(uint64_t val) override { set(BitVector<N>{static_cast<T<N>>(val)}); }
+
 private:
     BitVector<N> value{};
     bool is_set{false};
@@ -41,4 +60,3 @@ private:
 };
 
 #endif  // INPUT_PORT_H_
-
@@ -0,0 +1,44 @@
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input_stream.h"
+
+using namespace std;
+
+MappedStimulus::MappedStimulus(string const &path) {
+    int const fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error(path + ": can not be opened");
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw runtime_error(path + " has no values");
+    }
+    size = info.st_size;
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw runtime_error(path + ": can not be mapped");
+    }
+    madvise(data, size, MADV_SEQUENTIAL);
+}
+
+MappedStimulus::~MappedStimulus() {
+    if (data != nullptr)
+        munmap(data, size);
+}
+
+void MappedStimulus::prefetch(size_t offset) const {
+    if (offset >= size)
+        return;
+    // madvise() wants the start of a page
+    size_t const page = sysconf(_SC_PAGESIZE);
+    size_t const start = offset / page * page;
+    size_t const end = min(size, offset + WINDOW);
+    madvise(static_cast<char*>(data) + start, end - start, MADV_WILLNEED);
+}
@@ -0,0 +1,111 @@
+#ifndef INPUT_STREAM_H_
+#define INPUT_STREAM_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <cstdint>
+
+#include "clockable.h"
+#include "wire.h"
+#include "bit_vector.h"
+
+/* Primary inputs which take a new value in every cycle, from a file of
+ * stimulus or from a buffer.
+ *
+ * A stimulus file is an array of T<N>, the value of cycle t at index t, in
+ * the byte order of the machine. It is mapped rather than read, the kernel
+ * is asked to read ahead of the stream a window at a time, so there is no
+ * system call in most cycles. After the last value the stream keeps it.
+ *
+ *   InputStream<8> a{"a.stim", &a_wire};
+ *   Clock clock{{&a, ...}};
+ *
+ * In a Simulator an InputStream is an input slot, which the Simulator writes
+ * with get(cycle) before every cycle, so run() goes through the stimulus. It
+ * does not move the stream.
+ */
+
+// A read only mapping of a stimulus file
+class MappedStimulus {
+public:
+    // Bytes asked for ahead of the stream
+    static size_t const WINDOW = 1 << 20;
+
+    MappedStimulus(std::string const &path);
+    MappedStimulus(MappedStimulus const &) = delete;
+    MappedStimulus &operator=(MappedStimulus const &) = delete;
+    ~MappedStimulus();
+
+    void const *get_data() const { return data; }
+    size_t get_size() const { return size; }
+    // Ask for the window after offset to be read
+    void prefetch(size_t offset) const;
+
+private:
+    void *data{nullptr};
+    size_t size{0};
+};
+
+template <int N>
+class InputStream: public InputSource {
+public:
+    using Value = T<N>;
+
+    InputStream(std::string const &path, Wire<N> *outwire):
+            InputSource(), mapped{std::make_unique<MappedStimulus>(path)}, outwire{outwire} {
+        if (mapped->get_size() % sizeof(Value) != 0)
+            throw std::runtime_error(path + " is not a whole number of " + std::to_string(N) + " bit values");
+        values = static_cast<Value const*>(mapped->get_data());
+        count = mapped->get_size() / sizeof(Value);
+        mapped->prefetch(0);
+        next_prefetch = WINDOW_VALUES;
+    }
+    // The buffer must outlive the stream
+    InputStream(Value const *values, size_t count, Wire<N> *outwire):
+            InputSource(), values{values}, count{count}, outwire{outwire} {
+        if (count == 0)
+            throw std::runtime_error("An InputStream needs at least one value");
+    }
+    InputStream(InputStream<N> const &) = delete;
+    void operator=(InputStream<N> const &) = delete;
+
+    void clock() override {
+        if (position + 1 < count)
+            ++position;
+        if (position == next_prefetch) {
+            mapped->prefetch(position * sizeof(Value));
+            next_prefetch += WINDOW_VALUES;
+        }
+    }
+    void start_set_chain() override {
+        outwire->set(values[position]);
+    }
+    void start_reset_chain() override {
+        outwire->reset();
+    }
+
+    std::vector<Net*> get_start_wires() override { return {outwire}; }
+    uint64_t get_raw_state() const override { return values[position]; }
+    uint64_t read_input(uint64_t cycle) override { return get(cycle); }
+    bool is_stateless_input() const override { return true; }
+
+    // The value of a cycle, without moving the stream
+    Value get(uint64_t cycle) const { return values[(cycle < count) ? cycle : count - 1]; }
+    uint64_t get_position() const { return position; }
+    size_t get_count() const { return count; }
+    bool is_done() const { return position + 1 >= count; }
+
+private:
+    static size_t const WINDOW_VALUES = MappedStimulus::WINDOW / sizeof(Value);
+
+    std::unique_ptr<MappedStimulus> mapped{};
+    Value const *values{nullptr};
+    size_t count{0};
+    uint64_t position{0};
+    uint64_t next_prefetch{UINT64_MAX};
+    Wire<N> *outwire;
+};
+
+#endif  // INPUT_STREAM_H_
@@ -0,0 +1,128 @@
+#include <cstring>
+#include <unordered_set>
+
+#include "lookup_table.h"
+#include "bit_vector.h"
+
+using namespace std;
+
+static int entry_size(int output_width) {
+    if (output_width <= 8)
+        return 1;
+    else if (output_width <= 16)
+        return 2;
+    else if (output_width <= 32)
+        return 4;
+    return 8;
+}
+
+size_t LookupTable::table_bytes(Cone const &cone) {
+    return (size_t{1} << cone.get_input_width()) * entry_size(cone.get_output_width());
+}
+
+LookupTable::LookupTable(Netlist &netlist, Cone const &cone, string const &name):
+    ConeComponent(netlist, cone, name), entry_bytes{entry_size(cone.get_output_width())} {
+
+    if (cone.get_output_width() > 64) {
+        throw runtime_error(name + ": cone outputs are wider than 64 bits");
+    }
+
+    int shift = 0;
+    for (Cone::Input const &in : cone.get_inputs()) {
+        if (!in.constant) {
+            input_shift.push_back(shift);
+            shift += in.net->get_width();
+        }
+    }
+    shift = 0;
+    for (Net *out : cone.get_outputs()) {
+        output_shift.push_back(shift);
+        output_mask.push_back(width_mask(out->get_width()));
+        shift += out->get_width();
+    }
+
+    // Evaluate the cone for every input combination
+    uint64_t const entries = uint64_t{1} << cone.get_input_width();
+    table.resize(entries * entry_bytes);
+    vector<uint64_t> in(input_shift.size());
+    vector<uint64_t> out(output_shift.size());
+    for (uint64_t index = 0; index < entries; ++index) {
+        for (size_t i = 0; i < in.size(); ++i) {
+            int width = (i + 1 < in.size() ? input_shift[i + 1] : cone.get_input_width()) - input_shift[i];
+            in[i] = (index >> input_shift[i]) & width_mask(width);
+        }
+        cone.evaluate(in.data(), out.data());
+        uint64_t entry = 0;
+        for (size_t j = 0; j < out.size(); ++j) {
+            entry |= out[j] << output_shift[j];
+        }
+        memcpy(&table[index * entry_bytes], &entry, entry_bytes);
+    }
+}
+
+uint64_t LookupTable::lookup(uint64_t index) const {
+    uint8_t const *entry = &table[index * entry_bytes];
+    switch (entry_bytes) {
+    case 1:
+        return *entry;
+    case 2: {
+        uint16_t value;
+        memcpy(&value, entry, sizeof(value));
+        return value;
+    }
+    case 4: {
+        uint32_t value;
+        memcpy(&value, entry, sizeof(value));
+        return value;
+    }
+    default: {
+        uint64_t value;
+        memcpy(&value, entry, sizeof(value));
+        return value;
+    }
+    }
+}
+
+void LookupTable::calculate_outvalues(uint64_t const *in, uint64_t *out) {
+    uint64_t index = 0;
+    for (size_t i = 0; i < input_shift.size(); ++i) {
+        index |= in[i] << input_shift[i];
+    }
+    uint64_t entry = lookup(index);
+    for (size_t j = 0; j < output_shift.size(); ++j) {
+        out[j] = (entry >> output_shift[j]) & output_mask[j];
+    }
+}
+
+LookupTableStats collapse_small_cones(Netlist &netlist, LookupTableOptions const &options) {
+    LookupTableStats stats{};
+    unordered_set<Component*> claimed{};
+
+    // Start from the end of the set chain. A cone only reads nets from earlier
+    // levels, so the netlist does not have to be updated between cones.
+    auto const &components = netlist.get_components();
+    for (auto it = components.rbegin(); it != components.rend(); ++it) {
+        if (claimed.count(*it))
+            continue;
+        Cone cone{netlist, *it, options.max_input_bits};
+        if (!cone.is_valid())
+            continue;
+        claimed.insert(cone.get_components().begin(), cone.get_components().end());
+
+        if (cone.get_components().size() < options.min_components ||
+                cone.get_input_width() == 0 ||
+                cone.get_input_width() > options.max_input_bits ||
+                cone.get_output_width() > 64 ||
+                stats.table_bytes + LookupTable::table_bytes(cone) > options.max_table_bytes)
+            continue;
+
+        auto lut = make_unique<LookupTable>(netlist, cone, "LookupTable(" + (*it)->get_name() + ")");
+        stats.cones += 1;
+        stats.components_replaced += cone.get_components().size();
+        stats.table_bytes += lut->get_table_bytes();
+        netlist.adopt(move(lut));
+    }
+
+    netlist.update();
+    return stats;
+}
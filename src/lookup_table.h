@@ -0,0 +1,55 @@
+#ifndef LOOKUP_TABLE_H_
+#define LOOKUP_TABLE_H_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "cone.h"
+#include "netlist.h"
+
+/* A LookupTable replaces a small Cone with a precomputed table.
+ *
+ * The table is built by evaluating the cone for every combination of its
+ * non-constant inputs, so the cone components are used as they are. The inputs
+ * are concatenated to form the table index, input 0 in the least significant
+ * bits. The outputs are stored the same way, in entries of 1, 2, 4 or 8 bytes.
+ */
+
+class LookupTable: public ConeComponent {
+public:
+    LookupTable(Netlist &netlist, Cone const &cone, std::string const &name="LookupTable");
+
+    size_t get_table_bytes() const { return table.size(); }
+
+    // Size of the table which would replace cone
+    static size_t table_bytes(Cone const &cone);
+
+private:
+    void calculate_outvalues(uint64_t const *in, uint64_t *out) override;
+    uint64_t lookup(uint64_t index) const;
+
+    int const entry_bytes;
+    std::vector<int> input_shift{};
+    std::vector<int> output_shift{};
+    std::vector<uint64_t> output_mask{};
+    std::vector<uint8_t> table{};
+};
+
+struct LookupTableOptions {
+    int max_input_bits = 16;
+    size_t max_table_bytes = 1 << 20;  // For all tables together
+    size_t min_components = 2;
+};
+
+struct LookupTableStats {
+    int cones = 0;
+    int components_replaced = 0;
+    size_t table_bytes = 0;
+};
+
+// Replace every combinational cone with a small enough input width by a
+// LookupTable. Call before the design is clocked.
+LookupTableStats collapse_small_cones(Netlist &netlist, LookupTableOptions const &options = {});
+
+#endif  // LOOKUP_TABLE_H_
@@ -0,0 +1,126 @@
+#include <unordered_set>
+#include <stdexcept>
+
+#include "memoized_cone.h"
+
+using namespace std;
+
+// Checked before the cone is taken out of the netlist
+static Cone const &check_cache(Cone const &cone, size_t sets, size_t ways, string const &name) {
+    if (ways == 0)
+        throw invalid_argument(name + ": a cache needs at least one way");
+    if (sets == 0 || (sets & (sets - 1)) != 0)
+        throw invalid_argument(name + ": the sets of a cache are a power of two, not " + to_string(sets));
+    return cone;
+}
+
+MemoizedCone::MemoizedCone(Netlist &netlist, Cone const &cone, size_t sets, size_t ways, string const &name):
+    ConeComponent(netlist, check_cache(cone, sets, ways, name), name),
+    set_mask{sets - 1},
+    ways{ways},
+    inputs{static_cast<size_t>(cone.get_input_count())},
+    outputs{cone.get_outputs().size()},
+    keys((set_mask + 1) * ways * inputs),
+    values((set_mask + 1) * ways * outputs),
+    valid((set_mask + 1) * ways),
+    victim(set_mask + 1) {}
+
+double MemoizedCone::get_hit_rate() const {
+    uint64_t const total = hits + misses;
+    return (total == 0) ? 0.0 : static_cast<double>(hits) / total;
+}
+
+uint64_t MemoizedCone::hash(uint64_t const *in) const {
+    uint64_t h = 0x9e3779b97f4a7c15;
+    for (size_t i = 0; i < inputs; ++i) {
+        h ^= in[i] + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    return h;
+}
+
+void MemoizedCone::calculate_outvalues(uint64_t const *in, uint64_t *out) {
+    if (mode == Mode::Disabled) {
+        cone.evaluate(in, out);
+        return;
+    }
+
+    size_t const set = hash(in) & set_mask;
+    for (size_t way = 0; way < ways; ++way) {
+        size_t const entry = set * ways + way;
+        if (!valid[entry])
+            continue;
+        bool match = true;
+        for (size_t i = 0; i < inputs && match; ++i) {
+            match = (keys[entry * inputs + i] == in[i]);
+        }
+        if (match) {
+            ++hits;
+            if (mode == Mode::Profiling) {
+                cone.evaluate(in, out);
+            } else {
+                for (size_t j = 0; j < outputs; ++j) {
+                    out[j] = values[entry * outputs + j];
+                }
+            }
+            return;
+        }
+    }
+
+    ++misses;
+    cone.evaluate(in, out);
+    size_t const entry = set * ways + victim[set];
+    victim[set] = (victim[set] + 1) % ways;
+    valid[entry] = 1;
+    for (size_t i = 0; i < inputs; ++i) {
+        keys[entry * inputs + i] = in[i];
+    }
+    for (size_t j = 0; j < outputs; ++j) {
+        values[entry * outputs + j] = out[j];
+    }
+}
+
+vector<MemoizedCone*> memoize_cones(Netlist &netlist, MemoOptions const &options) {
+    vector<MemoizedCone*> memoized{};
+    unordered_set<Component*> claimed{};
+
+    // Same order as collapse_small_cones(), see lookup_table.cpp
+    auto const &components = netlist.get_components();
+    for (auto it = components.rbegin(); it != components.rend(); ++it) {
+        if (claimed.count(*it))
+            continue;
+        Cone cone{netlist, *it, options.max_input_bits};
+        if (!cone.is_valid())
+            continue;
+        claimed.insert(cone.get_components().begin(), cone.get_components().end());
+
+        if (cone.get_components().size() < options.min_components ||
+                cone.get_input_width() == 0 ||
+                cone.get_input_width() > options.max_input_bits)
+            continue;
+
+        memoized.push_back(netlist.adopt(make_unique<MemoizedCone>(
+                        netlist, cone, options.sets, options.ways,
+                        "MemoizedCone(" + (*it)->get_name() + ")")));
+    }
+
+    netlist.update();
+    return memoized;
+}
+
+MemoStats apply_memo_profile(vector<MemoizedCone*> const &cones, double min_hit_rate) {
+    MemoStats stats{};
+    for (MemoizedCone *cone : cones) {
+        if (cone->get_hit_rate() >= min_hit_rate) {
+            cone->set_mode(MemoizedCone::Mode::Enabled);
+            stats.enabled += 1;
+        } else {
+            cone->set_mode(MemoizedCone::Mode::Disabled);
+            stats.disabled += 1;
+        }
+        cone->clear_counters();
+    }
+    return stats;
+}
@@ -0,0 +1,76 @@
+#ifndef MEMOIZED_CONE_H_
+#define MEMOIZED_CONE_H_
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "cone.h"
+#include "netlist.h"
+
+/* A MemoizedCone replaces a Cone with a cache of recently seen inputs and the
+ * outputs they gave. On a miss the cone is evaluated through its components.
+ *
+ * The cache is set associative, of a power of two sets of one or more ways.
+ * The set is picked by a hash of the input values and the ways of a set are
+ * replaced in FIFO order.
+ *
+ * A cache only pays off if the same inputs come back, so a MemoizedCone starts
+ * out Profiling: it always evaluates the cone but counts the hits it would
+ * have had. After running the design for a while apply_memo_profile() enables
+ * the cones which hit often enough and disables the rest.
+ */
+
+class MemoizedCone: public ConeComponent {
+public:
+    enum class Mode { Profiling, Enabled, Disabled };
+
+    MemoizedCone(Netlist &netlist, Cone const &cone, size_t sets, size_t ways,
+                 std::string const &name="MemoizedCone");
+
+    Mode get_mode() const { return mode; }
+    void set_mode(Mode new_mode) { mode = new_mode; }
+
+    uint64_t get_hits() const { return hits; }
+    uint64_t get_misses() const { return misses; }
+    double get_hit_rate() const;
+    void clear_counters() { hits = 0; misses = 0; }
+
+private:
+    void calculate_outvalues(uint64_t const *in, uint64_t *out) override;
+    uint64_t hash(uint64_t const *in) const;
+
+    Mode mode{Mode::Profiling};
+    size_t const set_mask;
+    size_t const ways;
+    size_t const inputs;
+    size_t const outputs;
+    std::vector<uint64_t> keys;
+    std::vector<uint64_t> values;
+    std::vector<uint8_t> valid;
+    std::vector<size_t> victim;
+    uint64_t hits{0};
+    uint64_t misses{0};
+};
+
+struct MemoOptions {
+    int max_input_bits = 256;
+    size_t min_components = 2;
+    size_t sets = 64;  // A power of two
+    size_t ways = 4;
+};
+
+struct MemoStats {
+    int enabled = 0;
+    int disabled = 0;
+};
+
+// Wrap every cone in a profiling MemoizedCone. Call before the design is
+// clocked.
+std::vector<MemoizedCone*> memoize_cones(Netlist &netlist, MemoOptions const &options = {});
+
+// Enable the cones which have had at least min_hit_rate hits during profiling
+// and disable the rest.
+MemoStats apply_memo_profile(std::vector<MemoizedCone*> const &cones, double min_hit_rate = 0.5);
+
+#endif  // MEMOIZED_CONE_H_
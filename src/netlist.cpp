@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <stdexcept>
+
+#include "netlist.h"
+
+using namespace std;
+
+namespace {
+
+// Components are ordered by the key of the first net feeding them, and the
+// position of their port among the targets of that net
+using OrderKey = pair<uint64_t, uint64_t>;
+
+// Keys of nets driven by components, after those of the start wires
+uint64_t const DRIVEN = uint64_t{1} << 63;
+
+// Ids handed out by the walk are the part and the position in the part
+int const PART_SHIFT = 40;
+
+template <typename T>
+vector<T> concatenate(vector<vector<T>> const &parts) {
+    vector<T> all{};
+    for (vector<T> const &part : parts) {
+        all.insert(all.end(), part.begin(), part.end());
+    }
+    return all;
+}
+
+// Lists of edges grouped by one end, as offsets into a list of edge indices
+struct Groups {
+    vector<uint64_t> begin{};
+    vector<uint64_t> edges{};
+};
+
+}  // namespace
+
+// A port the walk went through: the net feeding it is a start wire or an
+// outwire of a found component
+struct Netlist::Edge {
+    uint64_t parent;   // found component the port belongs to
+    uint64_t source;   // found component driving the net, or the start key
+    uint64_t target;   // position of the port among the targets of the net
+    uint32_t outwire;
+    bool driven;
+};
+
+struct Netlist::Walk {
+    vector<Component*> found{};
+    vector<char> is_endpoint{};
+    vector<Edge> edges{};
+};
+
+Netlist::Netlist(vector<Clockable*> const &clockables, unsigned threads):
+        clockables{clockables}, threads{resolve_threads(threads)} {
+    update();
+}
+
+Netlist::Netlist(initializer_list<Clockable*> clockables): clockables{clockables}, threads{1} {
+    update();
+}
+
+void Netlist::update() {
+    nets.clear();
+    components.clear();
+    endpoints.clear();
+    drivers.clear();
+    sources.clear();
+    port_nets.clear();
+    levels.clear();
+
+    // The sharded maps and the edges cost more than they save on one thread
+    if (threads == 1) {
+        walk();
+        return;
+    }
+
+    // The start wires of every clockable, with their order key
+    size_t const parts = parallel_parts(clockables.size(), threads);
+    vector<vector<pair<Net*, uint64_t>>> start_wires(parts);
+    vector<ShardedMap<Net*, Clockable*>::Buckets> source_buckets(parts);
+    parallel_for(clockables.size(), threads, [&](unsigned part, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            vector<Net*> const wires = clockables[i]->get_start_wires();
+            for (size_t j = 0; j < wires.size(); ++j) {
+                start_wires[part].emplace_back(wires[j], (i << 16) | j);
+                sources.add(source_buckets[part], wires[j], clockables[i]);
+            }
+        }
+    });
+    sources.fill(source_buckets, threads);
+    for (auto const &part : start_wires) {
+        for (auto const &wire : part) {
+            nets.push_back(wire.first);
+        }
+    }
+
+    levelize(discover(start_wires));
+}
+
+void Netlist::walk() {
+    // Follow the set chain from every clockable. Nets are walked in the
+    // order they are found.
+    unordered_map<Net*, uint32_t> net_ids{};
+    unordered_map<Component*, uint32_t> component_ids{};
+    vector<Net*> walked{};
+    vector<char> driven{};
+    vector<uint32_t> start_nets{};
+    for (Clockable *clockable : clockables) {
+        for (Net *net : clockable->get_start_wires()) {
+            nets.push_back(net);
+            sources.insert(net, clockable);
+            if (net_ids.emplace(net, walked.size()).second) {
+                start_nets.push_back(walked.size());
+                walked.push_back(net);
+                driven.push_back(false);
+            }
+        }
+    }
+    // The components fed by every walked net, and the nets every component
+    // was the first to drive
+    vector<uint64_t> target_begin{0};
+    vector<uint32_t> targets{};
+    vector<Component*> found{};
+    vector<char> is_endpoint{};
+    vector<uint32_t> pending{};
+    vector<uint64_t> outwire_begin{0};
+    vector<uint32_t> outwires{};
+    for (size_t n = 0; n < walked.size(); ++n) {
+        vector<Port*> const ports = walked[n]->get_targets();
+        for (size_t k = 0; k < ports.size(); ++k) {
+            port_nets.insert(ports[k], walked[n]);
+            Component *parent = ports[k]->get_parent();
+            auto const inserted = component_ids.emplace(parent, found.size());
+            uint32_t const id = inserted.first->second;
+            targets.push_back(id);
+            if (!inserted.second) {
+                pending[id] += driven[n];
+                continue;
+            }
+            vector<Net*> const wires = parent->get_outwires();
+            found.push_back(parent);
+            is_endpoint.push_back(wires.empty());
+            pending.push_back(driven[n]);
+            for (Net *wire : wires) {
+                if (net_ids.emplace(wire, walked.size()).second) {
+                    outwires.push_back(walked.size());
+                    walked.push_back(wire);
+                    driven.push_back(true);
+                }
+            }
+            outwire_begin.push_back(outwires.size());
+        }
+        target_begin.push_back(targets.size());
+    }
+
+    // Components are ordered by the first edge into them, which is the order
+    // of the keys of levelize(): the start wires, then the outwires of the
+    // components in the order they are levelized
+    uint64_t const UNSEEN = UINT64_MAX;
+    vector<uint64_t> order(found.size(), UNSEEN);
+    uint64_t next_order = 0;
+    for (uint32_t net : start_nets) {
+        for (uint64_t e = target_begin[net]; e < target_begin[net + 1]; ++e) {
+            if (order[targets[e]] == UNSEEN)
+                order[targets[e]] = next_order++;
+        }
+    }
+    auto by_order = [&](uint32_t a, uint32_t b) {
+        return order[a] < order[b];
+    };
+
+    // Levelize, one level at a time
+    vector<uint32_t> frontier{};
+    for (uint32_t i = 0; i < found.size(); ++i) {
+        if (!is_endpoint[i] && pending[i] == 0)
+            frontier.push_back(i);
+    }
+    vector<uint32_t> next{};
+    for (int level = 1; !frontier.empty(); ++level) {
+        sort(frontier.begin(), frontier.end(), by_order);
+        next.clear();
+        for (uint32_t source : frontier) {
+            components.push_back(found[source]);
+            levels.insert(found[source], level);
+            for (uint64_t o = outwire_begin[source]; o < outwire_begin[source + 1]; ++o) {
+                uint32_t const net = outwires[o];
+                for (uint64_t e = target_begin[net]; e < target_begin[net + 1]; ++e) {
+                    uint32_t const target = targets[e];
+                    if (order[target] == UNSEEN)
+                        order[target] = next_order++;
+                    if (!is_endpoint[target] && --pending[target] == 0)
+                        next.push_back(target);
+                }
+            }
+        }
+        frontier.swap(next);
+    }
+    for (size_t i = 0; i < found.size(); ++i) {
+        if (!is_endpoint[i] && pending[i] > 0)
+            throw runtime_error(found[i]->get_name() + " is part of a combinational loop");
+    }
+
+    for (Component *component : components) {
+        for (Net *wire : component->get_outwires()) {
+            drivers.insert(wire, component);
+            nets.push_back(wire);
+        }
+    }
+    vector<uint32_t> endpoint_order{};
+    for (uint32_t i = 0; i < found.size(); ++i) {
+        if (is_endpoint[i])
+            endpoint_order.push_back(i);
+    }
+    sort(endpoint_order.begin(), endpoint_order.end(), by_order);
+    for (uint32_t i : endpoint_order) {
+        endpoints.push_back(found[i]);
+    }
+}
+
+Netlist::Walk Netlist::discover(vector<vector<pair<Net*, uint64_t>>> const &start_wires) {
+    // Follow the set chain from every clockable, every thread from its own
+    // clockables. A component or net belongs to the thread which sees it
+    // first, which gives it its id.
+    struct Work {
+        Net *net;
+        uint64_t source;
+        uint32_t outwire;
+        bool driven;
+    };
+    size_t const parts = start_wires.size();
+    ShardedSet<Net*> known_nets{};
+    ShardedClaims<Component*> known_components{};
+    vector<Walk> walks(parts);
+    vector<ShardedMap<Port*, Net*>::Buckets> port_buckets(parts);
+
+    parallel_tasks(parts, threads, [&](size_t part) {
+        Walk &walk = walks[part];
+        vector<Work> work{};
+        for (auto const &wire : start_wires[part]) {
+            if (known_nets.insert(wire.first))
+                work.push_back(Work{wire.first, wire.second, 0, false});
+        }
+        while (!work.empty()) {
+            Work const item = work.back();
+            work.pop_back();
+            vector<Port*> const targets = item.net->get_targets();
+            for (size_t k = 0; k < targets.size(); ++k) {
+                port_nets.add(port_buckets[part], targets[k], item.net);
+                Component *parent = targets[k]->get_parent();
+                uint64_t const id = (uint64_t{part} << PART_SHIFT) | walk.found.size();
+                uint64_t const parent_id = known_components.claim(parent, id);
+                walk.edges.push_back(Edge{parent_id, item.source, k, item.outwire, item.driven});
+                if (parent_id != id)
+                    continue;
+                vector<Net*> const outwires = parent->get_outwires();
+                walk.found.push_back(parent);
+                walk.is_endpoint.push_back(outwires.empty());
+                for (size_t j = 0; j < outwires.size(); ++j) {
+                    if (known_nets.insert(outwires[j]))
+                        work.push_back(Work{outwires[j], id, static_cast<uint32_t>(j), true});
+                }
+            }
+        }
+    });
+    port_nets.fill(port_buckets, threads);
+
+    // Ids become positions in all found components
+    vector<uint64_t> offsets{0};
+    for (Walk const &walk : walks) {
+        offsets.push_back(offsets.back() + walk.found.size());
+    }
+    auto position = [&](uint64_t id) {
+        return offsets[id >> PART_SHIFT] + (id & ((uint64_t{1} << PART_SHIFT) - 1));
+    };
+    parallel_tasks(parts, threads, [&](size_t part) {
+        for (Edge &edge : walks[part].edges) {
+            edge.parent = position(edge.parent);
+            if (edge.driven)
+                edge.source = position(edge.source);
+        }
+    });
+
+    Walk all{};
+    for (Walk const &walk : walks) {
+        all.found.insert(all.found.end(), walk.found.begin(), walk.found.end());
+        all.is_endpoint.insert(all.is_endpoint.end(), walk.is_endpoint.begin(), walk.is_endpoint.end());
+        all.edges.insert(all.edges.end(), walk.edges.begin(), walk.edges.end());
+    }
+    return all;
+}
+
+void Netlist::levelize(Walk const &walk) {
+    vector<Component*> const &found = walk.found;
+    vector<Edge> const &edges = walk.edges;
+
+    // Edges into every component and out of every component. A component
+    // is ready when every component driving it has a level.
+    vector<atomic<uint64_t>> in_count(found.size() + 1);
+    vector<atomic<uint64_t>> out_count(found.size() + 1);
+    vector<atomic_int> pending(found.size());
+    parallel_for(edges.size(), threads, [&](unsigned, size_t begin, size_t end) {
+        for (size_t e = begin; e < end; ++e) {
+            in_count[edges[e].parent + 1] += 1;
+            if (edges[e].driven) {
+                out_count[edges[e].source + 1] += 1;
+                pending[edges[e].parent] += 1;
+            }
+        }
+    });
+    Groups inputs{}, outputs{};
+    auto group = [&](Groups &groups, vector<atomic<uint64_t>> &count, bool driven_only, uint64_t Edge::*end) {
+        groups.begin.resize(count.size());
+        for (size_t i = 1; i < count.size(); ++i) {
+            groups.begin[i] = groups.begin[i - 1] + count[i];
+            count[i] = groups.begin[i];
+        }
+        count[0] = 0;
+        groups.edges.resize(groups.begin.back());
+        parallel_for(edges.size(), threads, [&](unsigned, size_t begin, size_t stop) {
+            for (size_t e = begin; e < stop; ++e) {
+                if (!driven_only || edges[e].driven)
+                    groups.edges[count[edges[e].*end]++] = e;
+            }
+        });
+    };
+    group(inputs, in_count, false, &Edge::parent);
+    group(outputs, out_count, true, &Edge::source);
+
+    vector<uint64_t> position(found.size());
+    auto sort_by_key = [&](vector<uint64_t> &list) {
+        vector<pair<OrderKey, uint64_t>> keyed(list.size());
+        parallel_for(list.size(), threads, [&](unsigned, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                OrderKey key{UINT64_MAX, UINT64_MAX};
+                for (uint64_t e = inputs.begin[list[i]]; e < inputs.begin[list[i] + 1]; ++e) {
+                    Edge const &edge = edges[inputs.edges[e]];
+                    uint64_t const net_key = edge.driven ?
+                        (DRIVEN | (position[edge.source] << 16) | edge.outwire) : edge.source;
+                    key = min(key, OrderKey{net_key, edge.target});
+                }
+                keyed[i] = {key, list[i]};
+            }
+        });
+        parallel_sort(keyed.begin(), keyed.end(), threads, [](auto const &a, auto const &b) {
+            return a.first < b.first;
+        });
+        for (size_t i = 0; i < list.size(); ++i) {
+            list[i] = keyed[i].second;
+        }
+    };
+
+    // Levelize, one level at a time
+    size_t const found_parts = parallel_parts(found.size(), threads);
+    vector<vector<uint64_t>> ready(found_parts), endpoint_parts(found_parts);
+    parallel_for(found.size(), threads, [&](unsigned part, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            if (walk.is_endpoint[i])
+                endpoint_parts[part].push_back(i);
+            else if (pending[i] == 0)
+                ready[part].push_back(i);
+        }
+    });
+    vector<int> component_levels{};
+    vector<uint64_t> frontier = concatenate(ready);
+    for (int level = 1; !frontier.empty(); ++level) {
+        sort_by_key(frontier);
+        size_t const first = components.size();
+        for (uint64_t i : frontier) {
+            components.push_back(found[i]);
+        }
+        component_levels.insert(component_levels.end(), frontier.size(), level);
+
+        vector<vector<uint64_t>> next(parallel_parts(frontier.size(), threads));
+        parallel_for(frontier.size(), threads, [&](unsigned part, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                uint64_t const source = frontier[i];
+                position[source] = first + i;
+                for (uint64_t e = outputs.begin[source]; e < outputs.begin[source + 1]; ++e) {
+                    uint64_t const target = edges[outputs.edges[e]].parent;
+                    if (!walk.is_endpoint[target] && --pending[target] == 0)
+                        next[part].push_back(target);
+                }
+            }
+        });
+        frontier = concatenate(next);
+    }
+    for (size_t i = 0; i < found.size(); ++i) {
+        if (!walk.is_endpoint[i] && pending[i] > 0)
+            throw runtime_error(found[i]->get_name() + " is part of a combinational loop");
+    }
+
+    // Levels, and the nets driven by components
+    size_t const parts = parallel_parts(components.size(), threads);
+    vector<ShardedMap<Component*, int>::Buckets> level_buckets(parts);
+    vector<ShardedMap<Net*, Component*>::Buckets> driver_buckets(parts);
+    vector<vector<Net*>> outwires(parts);
+    parallel_for(components.size(), threads, [&](unsigned part, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            levels.add(level_buckets[part], components[i], component_levels[i]);
+            for (Net *wire : components[i]->get_outwires()) {
+                drivers.add(driver_buckets[part], wire, components[i]);
+                outwires[part].push_back(wire);
+            }
+        }
+    });
+    levels.fill(level_buckets, threads);
+    drivers.fill(driver_buckets, threads);
+    for (vector<Net*> const &part : outwires) {
+        nets.insert(nets.end(), part.begin(), part.end());
+    }
+
+    vector<uint64_t> endpoint_order = concatenate(endpoint_parts);
+    sort_by_key(endpoint_order);
+    for (uint64_t i : endpoint_order) {
+        endpoints.push_back(found[i]);
+    }
+}
+
+void Netlist::replace_clockable(Clockable *old_clockable, Clockable *new_clockable) {
+    replace(clockables.begin(), clockables.end(), old_clockable, new_clockable);
+}
+
+Component *Netlist::get_driver(Net *net) const {
+    Component * const *driver = drivers.find(net);
+    return (driver == nullptr) ? nullptr : *driver;
+}
+
+Clockable *Netlist::get_source(Net *net) const {
+    Clockable * const *source = sources.find(net);
+    return (source == nullptr) ? nullptr : *source;
+}
+
+Net *Netlist::get_net(Port *port) const {
+    Net * const *net = port_nets.find(port);
+    return (net == nullptr) ? nullptr : *net;
+}
+
+int Netlist::get_level(Component *component) const {
+    int const *level = levels.find(component);
+    return (level == nullptr) ? 0 : *level;
+}
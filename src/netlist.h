@@ -0,0 +1,95 @@
+#ifndef NETLIST_H_
+#define NETLIST_H_
+
+#include <vector>
+#include <memory>
+#include <initializer_list>
+#include <utility>
+
+#include "clockable.h"
+#include "component.h"
+#include "input_port.h"
+#include "wire.h"
+#include "parallel.h"
+
+/* A Netlist is a view of the design reachable from a set of Clockables.
+ *
+ * It is used at elaboration, before the design is handed to a Clock, by passes
+ * which analyse and rewrite the design. Passes rewire the existing objects and
+ * may create new ones, which are then owned by the Netlist. The Netlist must
+ * therefore outlive the simulation.
+ *
+ * After a pass has rewired the design, call update() to rediscover it.
+ *
+ * Discovery and levelization run on the given number of threads, 0 is one per
+ * core. The order of the nets, components and endpoints only depends on the
+ * design, not on the threads: start wires in the order of the clockables, then
+ * level by level, components ordered by the first net and target feeding
+ * them. Endpoints are ordered the same way. On one thread the walk is a plain
+ * serial one, which finds the same order.
+ */
+
+class Netlist {
+public:
+    Netlist(std::vector<Clockable*> const &clockables, unsigned threads=1);
+    Netlist(std::initializer_list<Clockable*> clockables);
+    Netlist(Netlist const &) = delete;
+    Netlist &operator=(Netlist const &) = delete;
+
+    void update();
+
+    std::vector<Clockable*> const &get_clockables() const { return clockables; }
+    std::vector<Net*> const &get_nets() const { return nets; }
+
+    // Combinational components in topological order
+    std::vector<Component*> const &get_components() const { return components; }
+    // Registers, Sinks and other components ending the set chain
+    std::vector<Component*> const &get_endpoints() const { return endpoints; }
+
+    // The component driving a net, nullptr if it is driven by a Clockable
+    Component *get_driver(Net *net) const;
+    // The Clockable driving a net, nullptr if it is driven by a component
+    Clockable *get_source(Net *net) const;
+    // The net driving a port, nullptr if nothing drives it
+    Net *get_net(Port *port) const;
+    // Number of combinational components between the clockables and c
+    int get_level(Component *component) const;
+
+    static bool is_combinational(Component *component) {
+        return !component->get_outwires().empty();
+    }
+
+    // Replace a clockable, for passes which replace the state of the design
+    void replace_clockable(Clockable *old_clockable, Clockable *new_clockable);
+
+    // Take ownership of an object made by a pass
+    template <typename U>
+    U *adopt(std::unique_ptr<U> object) {
+        U *ptr = object.get();
+        owned.emplace_back(std::shared_ptr<U>(std::move(object)));
+        return ptr;
+    }
+
+private:
+    // What discover() finds, see netlist.cpp
+    struct Edge;
+    struct Walk;
+
+    // The same as discover() and levelize(), on one thread
+    void walk();
+    Walk discover(std::vector<std::vector<std::pair<Net*, uint64_t>>> const &start_wires);
+    void levelize(Walk const &walk);
+
+    std::vector<Clockable*> clockables;
+    unsigned threads;
+    std::vector<Net*> nets{};
+    std::vector<Component*> components{};
+    std::vector<Component*> endpoints{};
+    ShardedMap<Net*, Component*> drivers{};
+    ShardedMap<Net*, Clockable*> sources{};
+    ShardedMap<Port*, Net*> port_nets{};
+    ShardedMap<Component*, int> levels{};
+    std::vector<std::shared_ptr<void>> owned{};
+};
+
+#endif  // NETLIST_H_
@@ -0,0 +1,203 @@
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <array>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+/* Helpers for elaboration passes which run on several threads. */
+
+// 0 threads is one per core
+inline unsigned resolve_threads(unsigned threads) {
+    return (threads == 0) ? std::max(1u, std::thread::hardware_concurrency()) : threads;
+}
+
+// Number of parts parallel_for splits count into, small counts are one part
+inline size_t parallel_parts(size_t count, unsigned threads) {
+    size_t const MIN_PART = 4096;
+    return std::max<size_t>(1, std::min<size_t>(threads, count / MIN_PART));
+}
+
+// Run function(task) for every task in [0, tasks) on up to threads threads.
+// Exceptions are passed on to the caller.
+template <typename F>
+void parallel_tasks(size_t tasks, unsigned threads, F const &function) {
+    size_t const workers_count = std::min<size_t>(threads, tasks);
+    if (workers_count <= 1) {
+        for (size_t task = 0; task < tasks; ++task) {
+            function(task);
+        }
+        return;
+    }
+
+    std::vector<std::thread> workers{};
+    std::vector<std::exception_ptr> errors(workers_count);
+    for (size_t worker = 0; worker < workers_count; ++worker) {
+        workers.emplace_back([&, worker]() {
+            try {
+                for (size_t task = worker; task < tasks; task += workers_count) {
+                    function(task);
+                }
+            } catch (...) {
+                errors[worker] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    for (std::exception_ptr const &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+// Run function(part, begin, end) on contiguous parts of [0, count), see
+// parallel_parts(). Small counts run on the calling thread as part 0.
+template <typename F>
+void parallel_for(size_t count, unsigned threads, F const &function) {
+    size_t const parts = parallel_parts(count, threads);
+    parallel_tasks(parts, threads, [&](size_t part) {
+        function(static_cast<unsigned>(part), count * part / parts, count * (part + 1) / parts);
+    });
+}
+
+// Sort the parts of parallel_for, then merge them pairwise
+template <typename It, typename Less>
+void parallel_sort(It first, It last, unsigned threads, Less less) {
+    size_t const count = last - first;
+    size_t const parts = parallel_parts(count, threads);
+    std::vector<size_t> bounds{};
+    for (size_t part = 0; part <= parts; ++part) {
+        bounds.push_back(count * part / parts);
+    }
+    parallel_for(count, threads, [&](unsigned, size_t begin, size_t end) {
+        std::sort(first + begin, first + end, less);
+    });
+    while (bounds.size() > 2) {
+        std::vector<size_t> merged{};
+        for (size_t i = 0; i < bounds.size(); i += 2) {
+            merged.push_back(bounds[i]);
+        }
+        if (merged.back() != bounds.back())
+            merged.push_back(bounds.back());
+        parallel_tasks(bounds.size() / 2, threads, [&](size_t task) {
+            size_t const i = 2 * task;
+            if (i + 2 < bounds.size())
+                std::inplace_merge(first + bounds[i], first + bounds[i + 1], first + bounds[i + 2], less);
+        });
+        bounds = merged;
+    }
+}
+
+inline size_t shard_of(void const *pointer, size_t shards) {
+    uint64_t const hash = reinterpret_cast<uintptr_t>(pointer) * 0x9e3779b97f4a7c15;
+    return (hash >> 32) % shards;
+}
+
+/* A hash map of pointers split into shards. Threads collect entries in
+ * Buckets, one per thread, and fill() inserts every shard on its own thread.
+ * Lookups may come from any number of threads once it is filled.
+ *
+ * A map filled on one thread through insert() keeps a single shard, many
+ * small maps cost more cache misses than they save.
+ */
+template <typename K, typename V>
+class ShardedMap {
+public:
+    static constexpr size_t SHARDS = 64;
+    using Buckets = std::array<std::vector<std::pair<K, V>>, SHARDS>;
+
+    static void add(Buckets &buckets, K key, V const &value) {
+        buckets[shard_of(key, SHARDS)].emplace_back(key, value);
+    }
+
+    // Into an empty map, later buckets replace the entries of earlier ones
+    void fill(std::vector<Buckets> const &buckets, unsigned threads) {
+        count = SHARDS;
+        parallel_tasks(SHARDS, threads, [&](size_t shard) {
+            size_t size = shards[shard].size();
+            for (Buckets const &bucket : buckets) {
+                size += bucket[shard].size();
+            }
+            shards[shard].reserve(size);
+            for (Buckets const &bucket : buckets) {
+                for (auto const &entry : bucket[shard]) {
+                    shards[shard][entry.first] = entry.second;
+                }
+            }
+        });
+    }
+
+    // On one thread, into a map which is not filled by fill()
+    void insert(K key, V const &value) {
+        shards[shard_of(key, count)][key] = value;
+    }
+
+    V const *find(K key) const {
+        auto const &shard = shards[shard_of(key, count)];
+        auto it = shard.find(key);
+        return (it == shard.end()) ? nullptr : &it->second;
+    }
+
+    void clear() {
+        for (auto &shard : shards) {
+            shard.clear();
+        }
+        count = 1;
+    }
+
+private:
+    std::array<std::unordered_map<K, V>, SHARDS> shards{};
+    size_t count{1};
+};
+
+// A set of pointers which threads insert into at the same time
+template <typename K>
+class ShardedSet {
+public:
+    static constexpr size_t SHARDS = 64;
+
+    // False if the key was already in the set
+    bool insert(K key) {
+        Shard &shard = shards[shard_of(key, SHARDS)];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        return shard.keys.insert(key).second;
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex{};
+        std::unordered_set<K> keys{};
+    };
+    std::array<Shard, SHARDS> shards{};
+};
+
+// A map of pointers to ids, which threads claim at the same time
+template <typename K>
+class ShardedClaims {
+public:
+    static constexpr size_t SHARDS = 64;
+
+    // The id of key, which is id if this is the first claim
+    uint64_t claim(K key, uint64_t id) {
+        Shard &shard = shards[shard_of(key, SHARDS)];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        return shard.ids.emplace(key, id).first->second;
+    }
+
+private:
+    struct Shard {
+        std::mutex mutex{};
+        std::unordered_map<K, uint64_t> ids{};
+    };
+    std::array<Shard, SHARDS> shards{};
+};
+
+#endif  // PARALLEL_H_
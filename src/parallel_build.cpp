@@ -0,0 +1,26 @@
+#include <algorithm>
+
+#include "parallel_build.h"
+#include "parallel.h"
+
+using namespace std;
+
+ParallelBuild::ParallelBuild(unsigned threads): threads{resolve_threads(threads)} {}
+
+void ParallelBuild::build(size_t copies, function<void(size_t copy, BuildBatch &batch)> const &build) {
+    size_t const parts = max<size_t>(1, min<size_t>(threads, copies));
+    vector<BuildBatch> batches(parts);
+    parallel_tasks(parts, threads, [&](size_t part) {
+        for (size_t copy = copies * part / parts; copy < copies * (part + 1) / parts; ++copy) {
+            build(copy, batches[part]);
+        }
+    });
+
+    for (BuildBatch &batch : batches) {
+        for (auto const &connection : batch.connections) {
+            connection.first->add_target(connection.second);
+        }
+        clockables.insert(clockables.end(), batch.clockables.begin(), batch.clockables.end());
+        owned.insert(owned.end(), make_move_iterator(batch.owned.begin()), make_move_iterator(batch.owned.end()));
+    }
+}
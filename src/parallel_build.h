@@ -0,0 +1,87 @@
+#ifndef PARALLEL_BUILD_H_
+#define PARALLEL_BUILD_H_
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <utility>
+
+#include "clockable.h"
+#include "input_port.h"
+#include "wire.h"
+
+/* Building a large design on several threads.
+ *
+ * A design made of many copies of a block can be built one copy per call,
+ * and copies do not share anything while they are being built, so the calls
+ * run at the same time. Objects made through the BuildBatch are owned by the
+ * ParallelBuild. Wires shared between copies, such as a common enable, must
+ * not be connected from several threads: BuildBatch::connect() records the
+ * connection, and the connections are made after every copy is built, in the
+ * order of the copies. The design is the same for any number of threads.
+ *
+ *   ParallelBuild build{};
+ *   build.build(1000000, [&](size_t copy, BuildBatch &batch) {
+ *       auto *q = batch.make<Wire<8>>("Q");
+ *       auto *reg = batch.make_clockable<Register<8>>(q, "Reg");
+ *       batch.connect(&enable, &reg->input);
+ *   });
+ *   Netlist netlist{build.get_clockables(), 0};
+ */
+
+class BuildBatch {
+public:
+    BuildBatch() = default;
+    BuildBatch(BuildBatch const &) = delete;
+    BuildBatch &operator=(BuildBatch const &) = delete;
+
+    template <typename U, typename... Args>
+    U *make(Args &&... args) {
+        auto object = std::make_shared<U>(std::forward<Args>(args)...);
+        owned.push_back(object);
+        return object.get();
+    }
+
+    // Make an object which is one of the clockables of the design
+    template <typename U, typename... Args>
+    U *make_clockable(Args &&... args) {
+        U *object = make<U>(std::forward<Args>(args)...);
+        clockables.push_back(object);
+        return object;
+    }
+
+    // Connect a wire shared between copies once every copy is built
+    template <int N>
+    void connect(Wire<N> *wire, InputPort<N> *port) {
+        connections.emplace_back(wire, port);
+    }
+
+private:
+    friend class ParallelBuild;
+
+    std::vector<std::shared_ptr<void>> owned{};
+    std::vector<Clockable*> clockables{};
+    std::vector<std::pair<Net*, Port*>> connections{};
+};
+
+class ParallelBuild {
+public:
+    // 0 threads is one per core
+    explicit ParallelBuild(unsigned threads=0);
+    ParallelBuild(ParallelBuild const &) = delete;
+    ParallelBuild &operator=(ParallelBuild const &) = delete;
+
+    // Call build(copy, batch) for every copy, the copies are split into
+    // contiguous runs, one per thread
+    void build(size_t copies, std::function<void(size_t copy, BuildBatch &batch)> const &build);
+
+    std::vector<Clockable*> const &get_clockables() const { return clockables; }
+    size_t get_object_count() const { return owned.size(); }
+
+private:
+    unsigned threads;
+    std::vector<std::shared_ptr<void>> owned{};
+    std::vector<Clockable*> clockables{};
+};
+
+#endif  // PARALLEL_BUILD_H_
@@ -0,0 +1,159 @@
+#include <stdexcept>
+
+#include "probe.h"
+
+using namespace std;
+
+namespace {
+
+bool same_options(ProbeOptions const &a, ProbeOptions const &b) {
+    return a.period == b.period && a.phase % a.period == b.phase % b.period && a.trigger == b.trigger &&
+        (a.trigger == nullptr || (a.trigger_value == b.trigger_value && a.hold == b.hold));
+}
+
+}  // namespace
+
+ProbeSet::ProbeSet(Simulator const &simulator): program{simulator.get_shared_program()} {}
+
+Location ProbeSet::find(Net const *net) const {
+    auto it = program->net_slots.find(net);
+    if (it == program->net_slots.end())
+        throw runtime_error(net->get_name() + " is not in the program");
+    return it->second;
+}
+
+size_t ProbeSet::add_probe(Probe probe, ProbeOptions const &options) {
+    if (options.period == 0)
+        throw runtime_error("A probe has a period of at least 1 cycle");
+    size_t group = 0;
+    while (group < groups.size() && !same_options(groups[group].options, options)) {
+        ++group;
+    }
+    if (group == groups.size()) {
+        Location const trigger = (program && options.trigger) ? find(options.trigger) : Location{};
+        groups.push_back({options, trigger, false, 0, {}, {}, {}, {}});
+    }
+    probe.group = group;
+    probe.enabled = true;
+    probes.push_back(std::move(probe));
+    compiled = false;
+    return probes.size() - 1;
+}
+
+size_t ProbeSet::add(Net const *net, ProbeOptions const &options) {
+    if (program)
+        return add_probe({nullptr, nullptr, nullptr, find(net), 0, true, {}}, options);
+    return add_probe({net, nullptr, nullptr, Location{}, 0, true, {}}, options);
+}
+
+size_t ProbeSet::add_register(Clockable const *clockable, ProbeOptions const &options) {
+    if (!program)
+        return add_probe({nullptr, clockable, nullptr, Location{}, 0, true, {}}, options);
+    auto it = program->state_slots.find(clockable);
+    if (it == program->state_slots.end())
+        throw runtime_error("The register is not in the program");
+    return add_probe({nullptr, nullptr, nullptr, it->second, 0, true, {}}, options);
+}
+
+size_t ProbeSet::add_sink(Component *sink, ProbeOptions const &options) {
+    if (!program) {
+        vector<Port*> const inputs = sink->get_inputs();
+        if (inputs.size() != 1)
+            throw runtime_error(sink->get_name() + " is not a sink");
+        return add_probe({nullptr, nullptr, inputs[0], Location{}, 0, true, {}}, options);
+    }
+    auto it = program->sink_slots.find(sink);
+    if (it == program->sink_slots.end())
+        throw runtime_error(sink->get_name() + " is not in the program");
+    return add_probe({nullptr, nullptr, nullptr, it->second, 0, true, {}}, options);
+}
+
+void ProbeSet::set_enabled(size_t probe, bool enabled) {
+    if (probes.at(probe).enabled == enabled)
+        return;
+    probes[probe].enabled = enabled;
+    compiled = false;
+}
+
+void ProbeSet::compile() {
+    for (Group &group : groups) {
+        group.nets.clear();
+        group.clockables.clear();
+        group.ports.clear();
+        group.locations.clear();
+    }
+    for (size_t i = 0; i < probes.size(); ++i) {
+        Probe const &probe = probes[i];
+        if (!probe.enabled)
+            continue;
+        Group &group = groups[probe.group];
+        if (program)
+            group.locations.emplace_back(probe.location, i);
+        else if (probe.net)
+            group.nets.emplace_back(probe.net, i);
+        else if (probe.clockable)
+            group.clockables.emplace_back(probe.clockable, i);
+        else
+            group.ports.emplace_back(probe.port, i);
+    }
+    live.clear();
+    for (size_t group = 0; group < groups.size(); ++group) {
+        Group const &g = groups[group];
+        if (!g.nets.empty() || !g.clockables.empty() || !g.ports.empty() || !g.locations.empty())
+            live.push_back(group);
+    }
+    compiled = true;
+}
+
+template <typename ReadTrigger>
+bool ProbeSet::is_open(Group &group, uint64_t cycle, ReadTrigger const &read_trigger) {
+    ProbeOptions const &options = group.options;
+    if (options.trigger != nullptr && read_trigger(group) == options.trigger_value) {
+        group.triggered = true;
+        group.open_until = cycle + options.hold;
+    }
+    if (cycle % options.period != options.phase % options.period)
+        return false;
+    return options.trigger == nullptr || (group.triggered && cycle <= group.open_until);
+}
+
+void ProbeSet::sample(uint64_t cycle) {
+    if (program)
+        throw runtime_error("The probes are of a Simulator");
+    if (!compiled)
+        compile();
+    for (size_t index : live) {
+        Group &group = groups[index];
+        if (!is_open(group, cycle, [](Group const &g) { return g.options.trigger->get_raw(); }))
+            continue;
+        stats.groups += 1;
+        for (auto const &probe : group.nets) {
+            probes[probe.second].samples.push_back({cycle, probe.first->get_raw()});
+        }
+        for (auto const &probe : group.clockables) {
+            probes[probe.second].samples.push_back({cycle, probe.first->get_raw_state()});
+        }
+        for (auto const &probe : group.ports) {
+            probes[probe.second].samples.push_back({cycle, probe.first->get_raw()});
+        }
+        stats.samples += group.nets.size() + group.clockables.size() + group.ports.size();
+    }
+}
+
+void ProbeSet::sample(Simulator const &simulator) {
+    if (simulator.get_shared_program() != program)
+        throw runtime_error("The probes are not of this Simulator");
+    if (!compiled)
+        compile();
+    uint64_t const cycle = simulator.get_cycle();
+    for (size_t index : live) {
+        Group &group = groups[index];
+        if (!is_open(group, cycle, [&](Group const &g) { return simulator.read(g.trigger); }))
+            continue;
+        stats.groups += 1;
+        for (auto const &probe : group.locations) {
+            probes[probe.second].samples.push_back({cycle, simulator.read(probe.first)});
+        }
+        stats.samples += group.locations.size();
+    }
+}
@@ -0,0 +1,120 @@
+#ifndef PROBE_H_
+#define PROBE_H_
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+
+#include "wire.h"
+#include "component.h"
+#include "clockable.h"
+#include "program.h"
+#include "simulator.h"
+
+/* Probes record the values of a few nets, registers or sinks, every period
+ * cycles and only while a trigger holds, for long runs where a Trace of every
+ * cycle is too much.
+ *
+ * Nothing is added to the evaluation of the design. sample() is called after
+ * every Clock::clock() or Simulator::clock(), like Trace::sample(). Probes
+ * with the same options form a group, which is checked once per cycle, and
+ * a group only reads its enabled probes, so a disabled probe or a group off
+ * its period costs nothing:
+ *
+ *   ProbeSet probes{simulator};
+ *   size_t q = probes.add(&q_wire, {1000});
+ *   ProbeOptions const on_error{1, 0, &error_wire, 1, 10};
+ *   size_t state = probes.add_register(&state_register, on_error);
+ *   for (...) {
+ *       simulator.clock();
+ *       probes.sample(simulator);
+ *   }
+ *   for (ProbeSample const &sample : probes.get_samples(q)) ...
+ *
+ * A ProbeSet of a Simulator reads its slots, one of a design run by a Clock
+ * reads the objects.
+ */
+
+struct ProbeOptions {
+    uint64_t period = 1;
+    uint64_t phase = 0;              // Sampled when cycle % period == phase
+    Net const *trigger = nullptr;    // If set, sampled while it has trigger_value
+    uint64_t trigger_value = 1;
+    uint64_t hold = 0;               // And for hold cycles after
+};
+
+struct ProbeSample {
+    uint64_t cycle;
+    uint64_t value;
+};
+
+struct ProbeStats {
+    uint64_t samples = 0;   // Values recorded
+    uint64_t groups = 0;    // Groups due and triggered, summed over the cycles
+};
+
+class ProbeSet {
+public:
+    // Probes of a design run by a Clock
+    ProbeSet() = default;
+    // Probes of the values in a Simulator
+    ProbeSet(Simulator const &simulator);
+    ProbeSet(ProbeSet const &) = delete;
+    ProbeSet &operator=(ProbeSet const &) = delete;
+
+    // Returns the index of the probe
+    size_t add(Net const *net, ProbeOptions const &options={});
+    size_t add_register(Clockable const *clockable, ProbeOptions const &options={});
+    size_t add_sink(Component *sink, ProbeOptions const &options={});
+
+    void set_enabled(size_t probe, bool enabled);
+    bool is_enabled(size_t probe) const { return probes.at(probe).enabled; }
+
+    // After Clock::clock()
+    void sample(uint64_t cycle);
+    // After Simulator::clock(), at its cycle
+    void sample(Simulator const &simulator);
+
+    std::vector<ProbeSample> const &get_samples(size_t probe) const { return probes.at(probe).samples; }
+    ProbeStats const &get_stats() const { return stats; }
+
+private:
+    // One of the ways a probe is read
+    struct Probe {
+        Net const *net;
+        Clockable const *clockable;
+        Port *port;
+        Location location;
+        size_t group;
+        bool enabled;
+        std::vector<ProbeSample> samples;
+    };
+    // The enabled probes with the same options, by how they are read
+    struct Group {
+        ProbeOptions options;
+        Location trigger;
+        bool triggered;
+        uint64_t open_until;
+        std::vector<std::pair<Net const*, size_t>> nets;
+        std::vector<std::pair<Clockable const*, size_t>> clockables;
+        std::vector<std::pair<Port*, size_t>> ports;
+        std::vector<std::pair<Location, size_t>> locations;
+    };
+
+    size_t add_probe(Probe probe, ProbeOptions const &options);
+    Location find(Net const *net) const;
+    // Rebuild the lists of enabled probes
+    void compile();
+    template <typename ReadTrigger>
+    bool is_open(Group &group, uint64_t cycle, ReadTrigger const &read_trigger);
+
+    std::shared_ptr<Program const> program{};  // Of a Simulator
+    std::vector<Probe> probes{};
+    std::vector<Group> groups{};
+    std::vector<size_t> live{};  // Groups with enabled probes
+    bool compiled{false};
+    ProbeStats stats{};
+};
+
+#endif  // PROBE_H_
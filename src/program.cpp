@@ -0,0 +1,180 @@
+#include <stdexcept>
+#include <utility>
+
+#include "program.h"
+
+using namespace std;
+
+uint32_t Program::add_slot(int width, uint64_t value) {
+    initial.push_back(value);
+    widths.push_back(width);
+    return initial.size() - 1;
+}
+
+ProgramView Program::view() const {
+    return {initial.data(), widths.data(), initial.size(), code.data(), code.size(),
+            latches.data(), latches.size(), operands.data(), terms.data(), masks.data(),
+            calls.data(), calls.size(), inputs.data(), inputs.size()};
+}
+
+bool is_shareable(Program const &program) {
+    for (Call const &call : program.calls) {
+        if (!call.stateless)
+            return false;
+    }
+    for (InputSlot const &input : program.inputs) {
+        if (!input.stateless)
+            return false;
+    }
+    return program.outputs.empty();
+}
+
+vector<uint32_t> reads(Program const &program, Instruction const &ins) {
+    switch (ins.opcode) {
+    case Opcode::Call:
+        return program.calls[ins.a].in;
+    case Opcode::Pack:
+        return vector<uint32_t>(program.operands.begin() + ins.a, program.operands.begin() + ins.a + ins.b);
+    case Opcode::Gather: {
+        vector<uint32_t> slots{};
+        for (uint32_t i = 0; i < ins.b; ++i) {
+            slots.push_back(program.terms[ins.a + i].slot);
+        }
+        return slots;
+    }
+    case Opcode::Add:
+        return {ins.a, ins.b, ins.c};
+    case Opcode::And:
+    case Opcode::Nand:
+    case Opcode::Or:
+    case Opcode::Xor:
+    case Opcode::Nor:
+    case Opcode::Lut:
+        return {ins.a, ins.b};
+    default:
+        return {ins.a};
+    }
+}
+
+vector<uint32_t> writes(Program const &program, Instruction const &ins) {
+    if (ins.opcode == Opcode::Call)
+        return program.calls[ins.a].out;
+    if (ins.carry != NO_SLOT)
+        return {ins.out, ins.carry};
+    return {ins.out};
+}
+
+int remove_dead_code(Program &program) {
+    vector<bool> live(program.initial.size(), false);
+    for (Latch const &latch : program.latches) {
+        live[latch.next] = true;
+    }
+    for (auto const &sink : program.sink_slots) {
+        live[sink.second.slot] = true;
+    }
+    for (Net const *net : program.register_nets) {
+        auto it = program.net_slots.find(net);
+        if (it != program.net_slots.end())
+            live[it->second.slot] = true;
+    }
+
+    int removed = 0;
+    vector<Instruction> kept{};
+    for (auto it = program.code.rbegin(); it != program.code.rend(); ++it) {
+        Instruction ins = *it;
+        if (ins.opcode != Opcode::Call && !live[ins.out] && (ins.carry == NO_SLOT || !live[ins.carry])) {
+            removed += 1;
+            continue;
+        }
+        if (ins.carry != NO_SLOT && !live[ins.carry])
+            ins.carry = NO_SLOT;
+        for (uint32_t slot : reads(program, ins)) {
+            live[slot] = true;
+        }
+        kept.push_back(ins);
+    }
+    program.code.assign(kept.rbegin(), kept.rend());
+    return removed;
+}
+
+void copy_register_nets(Program &program) {
+    unordered_set<uint32_t> states{};
+    for (Latch const &latch : program.latches) {
+        states.insert(latch.state);
+    }
+    unordered_map<uint32_t, uint32_t> copies{};
+    for (Net const *net : program.register_nets) {
+        auto it = program.net_slots.find(net);
+        if (it == program.net_slots.end() || !states.count(it->second.slot))
+            continue;
+        uint32_t const state = it->second.slot;
+        auto copy = copies.find(state);
+        if (copy == copies.end()) {
+            uint32_t const slot = program.add_slot(program.widths[state], program.initial[state]);
+            program.code.push_back({Opcode::Copy, program.widths[state], slot, NO_SLOT, state, state, state});
+            copy = copies.emplace(state, slot).first;
+        }
+        it->second.slot = copy->second;
+    }
+}
+
+void drop_register_net_copies(Program &program) {
+    vector<bool> copy(program.initial.size(), false);
+    for (Net const *net : program.register_nets) {
+        auto it = program.net_slots.find(net);
+        if (it != program.net_slots.end())
+            copy[it->second.slot] = true;
+    }
+    vector<uint32_t> source(program.initial.size(), NO_SLOT);
+    vector<Instruction> kept{};
+    for (Instruction const &ins : program.code) {
+        if (ins.opcode == Opcode::Copy && copy[ins.out])
+            source[ins.out] = ins.a;
+        else
+            kept.push_back(ins);
+    }
+    program.code = kept;
+    for (Net const *net : program.register_nets) {
+        auto it = program.net_slots.find(net);
+        if (it != program.net_slots.end() && source[it->second.slot] != NO_SLOT)
+            it->second.slot = source[it->second.slot];
+    }
+}
+
+void sort_code(Program &program) {
+    vector<int> writer(program.initial.size(), -1);
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        for (uint32_t slot : writes(program, program.code[i])) {
+            writer[slot] = i;
+        }
+    }
+
+    // Depth first, keeping the original order where possible
+    vector<int> state(program.code.size(), 0);
+    vector<Instruction> sorted{};
+    vector<pair<size_t, vector<uint32_t>>> stack{};
+    for (size_t root = 0; root < program.code.size(); ++root) {
+        if (state[root] != 0)
+            continue;
+        state[root] = 1;
+        stack.push_back({root, reads(program, program.code[root])});
+        while (!stack.empty()) {
+            vector<uint32_t> &pending = stack.back().second;
+            if (pending.empty()) {
+                state[stack.back().first] = 2;
+                sorted.push_back(program.code[stack.back().first]);
+                stack.pop_back();
+                continue;
+            }
+            int const next = writer[pending.back()];
+            pending.pop_back();
+            if (next < 0 || state[next] == 2)
+                continue;
+            if (state[next] == 1)
+                throw runtime_error("Combinational loop in program");
+            state[next] = 1;
+            stack.push_back({static_cast<size_t>(next), reads(program, program.code[next])});
+        }
+    }
+    program.code = sorted;
+}
@@ -0,0 +1,238 @@
+#ifndef PROGRAM_H_
+#define PROGRAM_H_
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+#include "clockable.h"
+#include "component.h"
+#include "wire.h"
+#include "bit_vector.h"
+
+/* A Program is a compiled design, see compiler.h.
+ *
+ * Every value in the design lives in a slot, a 64 bit word. Wires and
+ * InputPorts do not exist in a program, an instruction reads the slots of the
+ * values it depends on directly. A cycle is:
+ *   1. Execute the code in order
+ *   2. Latch, copy the next value of every register into its state slot
+ *
+ * The net driven by a register has a slot of its own, which the code copies
+ * the state into, so after a cycle it has the value of that cycle like every
+ * other net. The instructions reading the register read its state slot.
+ */
+
+enum class Opcode : uint8_t {
+    Copy, Not, And, Nand, Or, Xor, Nor, Add, Call,
+    Pack,       // Concatenate 1 bit slots, the first in the least significant bit
+    Extract,    // Bit b of a
+    ReduceAnd,  // All bits of a set
+    ReduceOr,   // Any bit of a set
+    Gather,     // Bits moved from other slots, see Term
+    Lut         // A different function of a and b for every bit
+};
+
+uint32_t const NO_SLOT = UINT32_MAX;
+
+struct Instruction {
+    Opcode opcode;
+    uint8_t width;     // Width of the result, of a for reductions
+    uint32_t out;
+    uint32_t carry;    // Carry out of Add, NO_SLOT if not used
+    uint32_t a;        // Call: index into Program::calls
+                       // Pack: index into Program::operands
+                       // Gather: index into Program::terms
+    uint32_t b;        // Extract: the bit, not a slot
+                       // Pack, Gather: number of operands or terms
+    uint32_t c;        // Carry in of Add
+                       // Lut: index into Program::masks
+};
+
+struct Latch {
+    uint32_t state;
+    uint32_t next;
+};
+
+// A component which is evaluated through its object
+struct Call {
+    std::function<void(uint64_t const *in, uint64_t *out)> calculate;
+    std::vector<uint32_t> in;
+    std::vector<uint32_t> out;
+    // The object keeps nothing between calls, so runs on several threads may
+    // call it at the same time
+    bool stateless;
+};
+
+// A primary input, its slot is written with read(cycle) before every cycle
+struct InputSlot {
+    std::function<uint64_t(uint64_t cycle)> read;
+    uint32_t slot;
+    // See Call::stateless
+    bool stateless;
+};
+
+// A sink which records its values, write() is called with the value of the
+// sink after every cycle. The Simulator finds it in sink_slots.
+struct OutputSlot {
+    std::function<void(uint64_t value)> write;
+    Component const *sink;
+};
+
+// Part of a Gather, the bits in mask after shifting a slot left by shift
+struct Term {
+    uint32_t slot;
+    int32_t shift;
+    uint64_t mask;
+};
+
+// Where a value of the design can be found, width bits from shift in a slot
+struct Location {
+    uint32_t slot;
+    uint8_t shift;
+    uint8_t width;
+};
+
+// Pointers to the arrays of a program, which may be owned by a Program or be
+// mapped from a file, see program_file.h
+struct ProgramView {
+    uint64_t const *initial;
+    uint8_t const *widths;
+    size_t slots;
+    Instruction const *code;
+    size_t code_size;
+    Latch const *latches;
+    size_t latch_count;
+    uint32_t const *operands;
+    Term const *terms;
+    uint64_t const *masks;
+    Call const *calls;
+    size_t call_count;
+    InputSlot const *inputs;
+    size_t input_count;
+};
+
+struct Program {
+    std::vector<uint64_t> initial{};  // Initial value of every slot
+    std::vector<uint8_t> widths{};    // Width of every slot
+    std::vector<Instruction> code{};
+    std::vector<Latch> latches{};
+    std::vector<Call> calls{};
+    std::vector<InputSlot> inputs{};
+    std::vector<OutputSlot> outputs{};
+    std::vector<uint32_t> operands{};
+    std::vector<Term> terms{};
+    // Four masks per Lut, the bits which are 1 for a, b = 00, 01, 10 and 11
+    std::vector<uint64_t> masks{};
+
+    // Where the objects of the design ended up
+    std::unordered_map<Net const*, Location> net_slots{};
+    std::unordered_map<Clockable const*, Location> state_slots{};
+    std::unordered_map<Component const*, Location> sink_slots{};
+    // Nets driven by registers, see copy_register_nets()
+    std::unordered_set<Net const*> register_nets{};
+
+    uint32_t add_slot(int width, uint64_t value=0);
+    ProgramView view() const;
+};
+
+// Execute any instruction but Call
+inline void execute(Instruction const &ins, uint64_t *values, ProgramView const &program) {
+    uint64_t const mask = width_mask(ins.width);
+    // Pack, Gather and Call have no slot in a
+    uint64_t const a = (ins.opcode == Opcode::Pack || ins.opcode == Opcode::Gather ||
+        ins.opcode == Opcode::Call) ? 0 : values[ins.a];
+    switch (ins.opcode) {
+    case Opcode::Copy:
+        values[ins.out] = a;
+        break;
+    case Opcode::Not:
+        values[ins.out] = ~a & mask;
+        break;
+    case Opcode::And:
+        values[ins.out] = a & values[ins.b];
+        break;
+    case Opcode::Nand:
+        values[ins.out] = ~(a & values[ins.b]) & mask;
+        break;
+    case Opcode::Or:
+        values[ins.out] = a | values[ins.b];
+        break;
+    case Opcode::Xor:
+        values[ins.out] = a ^ values[ins.b];
+        break;
+    case Opcode::Nor:
+        values[ins.out] = ~(a | values[ins.b]) & mask;
+        break;
+    case Opcode::Add: {
+        uint64_t const partial = a + values[ins.b];
+        uint64_t const sum = partial + values[ins.c];
+        values[ins.out] = sum & mask;
+        if (ins.carry != NO_SLOT) {
+            values[ins.carry] = (ins.width == 64) ?
+                ((partial < a) | (sum < partial)) : (sum >> ins.width) & 1;
+        }
+        break;
+    }
+    case Opcode::Pack: {
+        uint64_t packed = 0;
+        for (uint32_t i = 0; i < ins.b; ++i) {
+            packed |= values[program.operands[ins.a + i]] << i;
+        }
+        values[ins.out] = packed;
+        break;
+    }
+    case Opcode::Extract:
+        values[ins.out] = (a >> ins.b) & 1;
+        break;
+    case Opcode::ReduceAnd:
+        values[ins.out] = (a == mask);
+        break;
+    case Opcode::ReduceOr:
+        values[ins.out] = (a != 0);
+        break;
+    case Opcode::Gather: {
+        uint64_t gathered = 0;
+        for (uint32_t i = 0; i < ins.b; ++i) {
+            Term const &term = program.terms[ins.a + i];
+            uint64_t const value = values[term.slot];
+            gathered |= ((term.shift >= 0) ? value << term.shift : value >> -term.shift) & term.mask;
+        }
+        values[ins.out] = gathered;
+        break;
+    }
+    case Opcode::Lut: {
+        uint64_t const b = values[ins.b];
+        uint64_t const *m = &program.masks[ins.c];
+        values[ins.out] = (~a & ~b & m[0]) | (~a & b & m[1]) | (a & ~b & m[2]) | (a & b & m[3]);
+        break;
+    }
+    case Opcode::Call:
+        break;
+    }
+}
+
+// True if runs of the program on several threads share nothing but the
+// program, see Call::stateless, InputSlot::stateless and OutputSlot
+bool is_shareable(Program const &program);
+
+// The slots read and written by an instruction
+std::vector<uint32_t> reads(Program const &program, Instruction const &ins);
+std::vector<uint32_t> writes(Program const &program, Instruction const &ins);
+
+// Remove instructions whose results are never used, returns how many
+int remove_dead_code(Program &program);
+
+// Point the register_nets at copies of the state slots they are in, made at
+// the end of the code. Passes which rewrite the registers drop the copies
+// first and make them again when they are done.
+void copy_register_nets(Program &program);
+void drop_register_net_copies(Program &program);
+
+// Order the code so every slot is written before it is read
+void sort_code(Program &program);
+
+#endif  // PROGRAM_H_
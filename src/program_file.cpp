@@ -0,0 +1,270 @@
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "program_file.h"
+
+using namespace std;
+
+namespace {
+
+char const MAGIC[8] = {'H', 'W', 'P', 'R', 'O', 'G', '\0', '\0'};
+uint32_t const VERSION = 1;
+
+// Every array starts at a multiple of 8 bytes
+size_t padded(size_t bytes) {
+    return (bytes + 7) & ~size_t{7};
+}
+
+template <typename U>
+void write_array(ofstream &file, U const *items, size_t count) {
+    size_t const bytes = count * sizeof(U);
+    if (bytes > 0)
+        file.write(reinterpret_cast<char const*>(items), bytes);
+    char const zeros[8] = {};
+    file.write(zeros, padded(bytes) - bytes);
+}
+
+// Throws if the count items do not fit before end, the count is not trusted
+template <typename U>
+U const *read_array(char const *&cursor, char const *end, uint64_t count, string const &path) {
+    size_t const left = end - cursor;
+    if (count > left / sizeof(U) || padded(count * sizeof(U)) > left)
+        throw runtime_error(path + " is truncated");
+    U const *items = reinterpret_cast<U const*>(cursor);
+    cursor += padded(count * sizeof(U));
+    return items;
+}
+
+// True if [first, first + count) is in [0, size)
+bool in_range(uint64_t first, uint64_t count, uint64_t size) {
+    return first <= size && count <= size - first;
+}
+
+bool is_location(Location const &location, uint64_t slots) {
+    return location.slot < slots && location.width >= 1 && location.width <= 64 &&
+        location.shift < 64;
+}
+
+bool is_instruction(Instruction const &ins, ProgramFileHeader const &header) {
+    uint64_t const slots = header.slots;
+    if (ins.width < 1 || ins.width > 64 || ins.out >= slots)
+        return false;
+    switch (ins.opcode) {
+    case Opcode::Copy:
+    case Opcode::Not:
+    case Opcode::ReduceAnd:
+    case Opcode::ReduceOr:
+        return ins.a < slots;
+    case Opcode::Extract:
+        return ins.a < slots && ins.b < 64;
+    case Opcode::And:
+    case Opcode::Nand:
+    case Opcode::Or:
+    case Opcode::Xor:
+    case Opcode::Nor:
+        return ins.a < slots && ins.b < slots;
+    case Opcode::Add:
+        return ins.a < slots && ins.b < slots && ins.c < slots &&
+            (ins.carry == NO_SLOT || ins.carry < slots);
+    case Opcode::Pack:
+        return ins.b <= 64 && in_range(ins.a, ins.b, header.operand_count);
+    case Opcode::Gather:
+        return in_range(ins.a, ins.b, header.term_count);
+    case Opcode::Lut:
+        return ins.a < slots && ins.b < slots && in_range(ins.c, 4, header.mask_count);
+    case Opcode::Call:
+        // A mapped program has no calls
+        return false;
+    }
+    return false;
+}
+
+template <typename Key>
+void add_names(vector<NamedLocation> &names, string &strings, unordered_map<Key const*, Location> const &slots, NamedLocation::Kind kind) {
+    for (auto const &entry : slots) {
+        Entity const *entity = dynamic_cast<Entity const*>(entry.first);
+        string const name = (entity != nullptr) ? entity->get_name() : "";
+        names.push_back({kind, entry.second, strings.size(), name.size()});
+        strings += name;
+    }
+}
+
+}  // namespace
+
+void save_program(Program const &program, string const &path, uint64_t key) {
+    if (!program.calls.empty())
+        throw runtime_error(path + ": programs which call objects of the design can not be saved");
+    if (!program.inputs.empty())
+        throw runtime_error(path + ": programs which read inputs of the design can not be saved");
+    if (!program.outputs.empty())
+        throw runtime_error(path + ": programs which record outputs of the design can not be saved");
+
+    // Fan-out in compressed sparse row form
+    vector<uint64_t> offsets(program.initial.size() + 1, 0);
+    for (Instruction const &ins : program.code) {
+        for (uint32_t slot : reads(program, ins)) {
+            offsets[slot + 1] += 1;
+        }
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    vector<uint32_t> fanout(offsets.back());
+    vector<uint64_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        for (uint32_t slot : reads(program, program.code[i])) {
+            fanout[next[slot]++] = i;
+        }
+    }
+
+    vector<NamedLocation> names{};
+    string strings{};
+    add_names(names, strings, program.net_slots, NamedLocation::Net);
+    add_names(names, strings, program.state_slots, NamedLocation::State);
+    add_names(names, strings, program.sink_slots, NamedLocation::Sink);
+
+    ProgramFileHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.instruction_size = sizeof(Instruction);
+    header.slots = program.initial.size();
+    header.code_size = program.code.size();
+    header.latch_count = program.latches.size();
+    header.operand_count = program.operands.size();
+    header.term_count = program.terms.size();
+    header.mask_count = program.masks.size();
+    header.fanout_count = fanout.size();
+    header.name_count = names.size();
+    header.string_size = strings.size();
+    header.key = key;
+
+    ofstream file{path, ios::binary | ios::trunc};
+    if (!file)
+        throw runtime_error(path + ": can not be written");
+    write_array(file, &header, 1);
+    write_array(file, program.initial.data(), program.initial.size());
+    write_array(file, program.widths.data(), program.widths.size());
+    write_array(file, program.code.data(), program.code.size());
+    write_array(file, program.latches.data(), program.latches.size());
+    write_array(file, program.operands.data(), program.operands.size());
+    write_array(file, program.terms.data(), program.terms.size());
+    write_array(file, program.masks.data(), program.masks.size());
+    write_array(file, offsets.data(), offsets.size());
+    write_array(file, fanout.data(), fanout.size());
+    write_array(file, names.data(), names.size());
+    write_array(file, strings.data(), strings.size());
+    if (!file)
+        throw runtime_error(path + ": could not be written");
+}
+
+MappedProgram::MappedProgram(string const &path) {
+    int const fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error(path + ": can not be opened");
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ProgramFileHeader)) {
+        close(fd);
+        throw runtime_error(path + " is not a program file");
+    }
+    size = info.st_size;
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw runtime_error(path + ": can not be mapped");
+    }
+
+    try {
+        load(path);
+    } catch (runtime_error const &) {
+        munmap(data, size);
+        data = nullptr;
+        throw;
+    }
+}
+
+void MappedProgram::load(string const &path) {
+    char const *cursor = static_cast<char const*>(data);
+    char const *const end = cursor + size;
+    header = read_array<ProgramFileHeader>(cursor, end, 1, path);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+            header->instruction_size != sizeof(Instruction))
+        throw runtime_error(path + " is not a program file of this version");
+    // Slots are indexed by uint32_t, NO_SLOT included
+    if (header->slots >= NO_SLOT)
+        throw runtime_error(path + " has too many slots");
+
+    view.slots = header->slots;
+    view.code_size = header->code_size;
+    view.latch_count = header->latch_count;
+    view.initial = read_array<uint64_t>(cursor, end, header->slots, path);
+    view.widths = read_array<uint8_t>(cursor, end, header->slots, path);
+    view.code = read_array<Instruction>(cursor, end, header->code_size, path);
+    view.latches = read_array<Latch>(cursor, end, header->latch_count, path);
+    view.operands = read_array<uint32_t>(cursor, end, header->operand_count, path);
+    view.terms = read_array<Term>(cursor, end, header->term_count, path);
+    view.masks = read_array<uint64_t>(cursor, end, header->mask_count, path);
+    view.calls = nullptr;
+    view.call_count = 0;
+    view.inputs = nullptr;
+    view.input_count = 0;
+    fanout_offsets = read_array<uint64_t>(cursor, end, header->slots + 1, path);
+    fanout = read_array<uint32_t>(cursor, end, header->fanout_count, path);
+    names = read_array<NamedLocation>(cursor, end, header->name_count, path);
+    strings = read_array<char>(cursor, end, header->string_size, path);
+
+    // Every index is checked once here, so the Simulator can trust them
+    for (uint64_t i = 0; i < view.code_size; ++i) {
+        if (!is_instruction(view.code[i], *header))
+            throw runtime_error(path + ": instruction " + to_string(i) + " is out of range");
+    }
+    for (uint64_t i = 0; i < view.latch_count; ++i) {
+        if (view.latches[i].state >= view.slots || view.latches[i].next >= view.slots)
+            throw runtime_error(path + ": latch " + to_string(i) + " is out of range");
+    }
+    for (uint64_t i = 0; i < header->operand_count; ++i) {
+        if (view.operands[i] >= view.slots)
+            throw runtime_error(path + ": operand " + to_string(i) + " is out of range");
+    }
+    for (uint64_t i = 0; i < header->term_count; ++i) {
+        Term const &term = view.terms[i];
+        if (term.slot >= view.slots || term.shift <= -64 || term.shift >= 64)
+            throw runtime_error(path + ": term " + to_string(i) + " is out of range");
+    }
+    if (fanout_offsets[0] != 0 || fanout_offsets[view.slots] != header->fanout_count)
+        throw runtime_error(path + ": the fan-out is out of range");
+    for (uint64_t s = 0; s < view.slots; ++s) {
+        if (fanout_offsets[s] > fanout_offsets[s + 1])
+            throw runtime_error(path + ": the fan-out is out of range");
+    }
+    for (uint64_t i = 0; i < header->fanout_count; ++i) {
+        if (fanout[i] >= view.code_size)
+            throw runtime_error(path + ": the fan-out is out of range");
+    }
+    for (uint64_t i = 0; i < header->name_count; ++i) {
+        NamedLocation const &named = names[i];
+        if (named.kind > NamedLocation::Sink || !is_location(named.location, view.slots) ||
+                !in_range(named.name_offset, named.name_size, header->string_size))
+            throw runtime_error(path + ": name " + to_string(i) + " is out of range");
+    }
+}
+
+MappedProgram::~MappedProgram() {
+    if (data != nullptr)
+        munmap(data, size);
+}
+
+Location MappedProgram::find(string const &name, NamedLocation::Kind kind) const {
+    for (uint64_t i = 0; i < header->name_count; ++i) {
+        NamedLocation const &named = names[i];
+        if (named.kind == kind && name.compare(0, string::npos, strings + named.name_offset, named.name_size) == 0)
+            return named.location;
+    }
+    throw runtime_error(name + " is not in the program");
+}
@@ -0,0 +1,86 @@
+#ifndef PROGRAM_FILE_H_
+#define PROGRAM_FILE_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "program.h"
+
+/* A binary file format for compiled designs.
+ *
+ * The file holds the arrays of a Program as they are laid out in memory:
+ * widths, initial values, instructions, latches, and the operands of Packs,
+ * Gathers and Luts. It also holds the fan-out of every slot in compressed
+ * sparse row form, and the names of the nets, registers and sinks. A
+ * MappedProgram maps the file and a Simulator runs it directly, without
+ * parsing it or allocating anything per component.
+ *
+ * Programs which call objects of the design (LookupTables, MemoizedCones and
+ * FusedRegisters) can not be saved.
+ *
+ * Nothing in a file is trusted: every count is checked against the size of
+ * the file and every index against the arrays it points into when it is
+ * mapped, which reads the file once.
+ */
+
+struct ProgramFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t instruction_size;   // sizeof(Instruction), to reject other ABIs
+    uint64_t slots;
+    uint64_t code_size;
+    uint64_t latch_count;
+    uint64_t operand_count;
+    uint64_t term_count;
+    uint64_t mask_count;
+    uint64_t fanout_count;
+    uint64_t name_count;
+    uint64_t string_size;
+    uint64_t key;                // Free for the user, see ScheduleCache
+};
+
+// A named value of the design
+struct NamedLocation {
+    enum Kind : uint32_t { Net, State, Sink };
+    Kind kind;
+    Location location;
+    uint64_t name_offset;
+    uint64_t name_size;
+};
+
+void save_program(Program const &program, std::string const &path, uint64_t key=0);
+
+class MappedProgram {
+public:
+    MappedProgram(std::string const &path);
+    MappedProgram(MappedProgram const &) = delete;
+    MappedProgram &operator=(MappedProgram const &) = delete;
+    ~MappedProgram();
+
+    ProgramView const &get_view() const { return view; }
+    ProgramFileHeader const &get_header() const { return *header; }
+
+    // Instructions reading each slot: fanout[fanout_offsets[s]] up to
+    // fanout[fanout_offsets[s + 1]]
+    uint64_t const *get_fanout_offsets() const { return fanout_offsets; }
+    uint32_t const *get_fanout() const { return fanout; }
+
+    // The location of a named net, register or sink, throws if there is none
+    Location find(std::string const &name, NamedLocation::Kind kind=NamedLocation::Net) const;
+
+private:
+    // Reads and checks the mapped file, throws if it is not a valid program
+    void load(std::string const &path);
+
+    void *data{nullptr};
+    size_t size{0};
+    ProgramFileHeader const *header{nullptr};
+    ProgramView view{};
+    uint64_t const *fanout_offsets{nullptr};
+    uint32_t const *fanout{nullptr};
+    NamedLocation const *names{nullptr};
+    char const *strings{nullptr};
+};
+
+#endif  // PROGRAM_FILE_H_
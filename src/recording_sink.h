@@ -0,0 +1,201 @@
+#ifndef RECORDING_SINK_H_
+#define RECORDING_SINK_H_
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include "component.h"
+#include "input_port.h"
+#include "bit_vector.h"
+#include "spsc_ring.h"
+
+/* A Sink which keeps the value of every cycle instead of only the last one,
+ * so a testbench can check the outputs of many cycles at once.
+ *
+ * Value i is the value the sink was set to in the i-th cycle. The values are
+ * kept in a ring of chunks, the last chunks * chunk_size of them can be read
+ * in place with get_span():
+ *
+ *   RecordingSink<8> out{"Out"};
+ *   for (...) clock.clock();
+ *   for (uint64_t i = out.get_first(); i < out.get_count();) {
+ *       RecordingSink<8>::Span span = out.get_span(i, out.get_count() - i);
+ *       check(span.data, span.size);
+ *       i += span.size;
+ *   }
+ *
+ * With a consumer, a thread is given every full chunk, and flush() gives it
+ * the values of a chunk which is not full yet. Values are only overwritten
+ * once the consumer is done with them, the sink waits for it otherwise.
+ *
+ * A Simulator records the value of every cycle into the sink as well, through
+ * write_output() after the cycle, and get_sink() is the last one. Such a
+ * Simulator can not be forked or checkpointed.
+ */
+
+template <int N>
+class RecordingSink : public OutputSink {
+public:
+    using Value = T<N>;
+    // Values in place, valid until they are overwritten
+    struct Span {
+        Value const *data;
+        size_t size;
+        Value const *begin() const { return data; }
+        Value const *end() const { return data + size; }
+    };
+    // Called on the consumer thread with values first .. first + count - 1
+    using Consumer = std::function<void(uint64_t first, Value const *values, size_t count)>;
+
+    RecordingSink(std::string const &name="RecordingSink", size_t chunk_size=4096, size_t chunks=16,
+            Consumer consumer={}):
+            OutputSink(name), chunk_size{chunk_size}, values(chunk_size * chunks),
+            ready{chunks}, consumer{std::move(consumer)} {
+        if (chunk_size == 0 || chunks == 0)
+            throw std::runtime_error(name + " needs at least one value in a chunk and one chunk");
+        if (this->consumer)
+            thread = std::thread{[this]() { drain(); }};
+    }
+    RecordingSink(RecordingSink const &) = delete;
+    RecordingSink &operator=(RecordingSink const &) = delete;
+    ~RecordingSink() {
+        if (!thread.joinable())
+            return;
+        flush();
+        running = false;
+        {
+            std::lock_guard<std::mutex> lock{ready_mutex};
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    InputPort<N> input{this, name + ".in"};
+
+    void set() override {
+        if (is_set)
+            throw std::runtime_error(name + " has already been set");
+        is_set = true;
+        record(input.get_value().get_value());
+    }
+    void reset() override {
+        is_set = false;
+    }
+    void write_output(uint64_t value) override {
+        record(static_cast<Value>(value));
+    }
+
+    std::vector<Port*> get_inputs() override { return {&input}; }
+
+    // The number of values recorded, and the first one still kept
+    uint64_t get_count() const { return count; }
+    uint64_t get_first() const { return (count > values.size()) ? count - values.size() : 0; }
+    BitVector<N> get_value() const { return get_value(count - 1); }
+    BitVector<N> get_value(uint64_t index) const {
+        check(index, 1);
+        return values[index % values.size()];
+    }
+
+    // Up to size values from first, as many as are next to each other
+    Span get_span(uint64_t first, size_t size) const {
+        check(first, size);
+        size_t const position = first % values.size();
+        return {values.data() + position, std::min(size, values.size() - position)};
+    }
+
+    // Give the consumer the values it has not had yet and wait until it is done
+    void flush() {
+        if (!consumer)
+            return;
+        if (handed < count)
+            hand_over();
+        while (drained.load(std::memory_order_acquire) < count) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Times the sink waited for the consumer
+    uint64_t get_stalls() const { return stalls; }
+
+private:
+    struct Range {
+        uint64_t first;
+        size_t size;
+    };
+
+    void record(Value value) {
+        size_t const position = count % values.size();
+        if (position % chunk_size == 0 && consumer)
+            wait_for_space();
+        values[position] = value;
+        ++count;
+        if (count % chunk_size == 0 && consumer)
+            hand_over();
+    }
+
+    void check(uint64_t first, size_t size) const {
+        // first + size may wrap
+        if (first < get_first() || size == 0 || first >= count || size > count - first)
+            throw std::runtime_error(name + " does not hold values " + std::to_string(first) +
+                " to " + std::to_string(first + size));
+    }
+
+    void wait_for_space() {
+        if (count + chunk_size - drained.load(std::memory_order_acquire) <= values.size())
+            return;
+        stalls += 1;
+        while (count + chunk_size - drained.load(std::memory_order_acquire) > values.size()) {
+            std::this_thread::yield();
+        }
+    }
+
+    void hand_over() {
+        while (!ready.try_push({handed, static_cast<size_t>(count - handed)})) {
+            std::this_thread::yield();
+        }
+        handed = count;
+        wake.notify_one();
+    }
+
+    void drain() {
+        Range range;
+        while (true) {
+            if (ready.pop(&range, 1) == 0) {
+                if (!running)
+                    return;
+                std::unique_lock<std::mutex> lock{ready_mutex};
+                wake.wait_for(lock, std::chrono::microseconds(500));
+                continue;
+            }
+            consumer(range.first, values.data() + range.first % values.size(), range.size);
+            drained.store(range.first + range.size, std::memory_order_release);
+        }
+    }
+
+    size_t const chunk_size;
+    std::vector<Value> values;
+    uint64_t count{0};
+    bool is_set{false};
+    uint64_t handed{0};
+    uint64_t stalls{0};
+
+    // Shared with the consumer thread
+    SpscRing<Range> ready;
+    std::atomic<uint64_t> drained{0};
+    std::atomic_bool running{true};
+    std::mutex ready_mutex{};
+    std::condition_variable wake{};
+    Consumer consumer;
+    std::thread thread{};
+};
+
+#endif  // RECORDING_SINK_H_
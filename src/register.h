@@ -61,6 +61,15 @@ public:
         return outvalue;
     }
 
+    std::vector<Port*> get_inputs() override { return {&input}; }
+    std::vector<Net*> get_start_wires() override {
+        if (outwire != nullptr)
+            return {outwire};
+        return {};
+    }
+    uint64_t get_raw_state() const override { return outvalue.get_value(); }
+    void set_raw_state(uint64_t state) override { outvalue = BitVector<N>{static_cast<T<N>>(state)}; }
+
 private:
     BitVector<N> outvalue;
     Wire<N> *outwire;
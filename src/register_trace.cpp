@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "register_trace.h"
+
+using namespace std;
+
+RegisterTrace::RegisterTrace(Simulator const &simulator): program{simulator.get_shared_program()} {
+    if (program->initial.empty())
+        throw runtime_error("A RegisterTrace needs a Simulator of a compiled Program");
+    size_t const slots = program->initial.size();
+    writer.assign(slots, NO_SLOT);
+    for (size_t i = 0; i < program->code.size(); ++i) {
+        for (uint32_t slot : writes(*program, program->code[i])) {
+            writer[slot] = static_cast<uint32_t>(i);
+        }
+    }
+    root_index.assign(slots, NO_SLOT);
+    for (uint32_t slot = 0; slot < slots; ++slot) {
+        if (writer[slot] != NO_SLOT)
+            continue;
+        root_index[slot] = static_cast<uint32_t>(roots.size());
+        roots.push_back(slot);
+    }
+    changes.resize(roots.size());
+    last.resize(roots.size());
+    stats.roots = roots.size();
+}
+
+void RegisterTrace::sample(Simulator const &simulator) {
+    if (simulator.get_shared_program() != program)
+        throw runtime_error("A RegisterTrace samples Simulators of its own program");
+    uint64_t const cycle = simulator.get_cycle();
+    if (stats.samples == 0) {
+        first_cycle = cycle;
+    } else if (cycle != first_cycle + stats.samples) {
+        throw runtime_error("A RegisterTrace samples every cycle, expected cycle " +
+            to_string(first_cycle + stats.samples) + " not " + to_string(cycle));
+    }
+    Location location{0, 0, 64};
+    bool const first = (stats.samples == 0);
+    for (size_t i = 0; i < roots.size(); ++i) {
+        location.slot = roots[i];
+        uint64_t const value = simulator.read(location);
+        if (value == last[i] && !first)
+            continue;
+        changes[i].push_back({cycle, value});
+        last[i] = value;
+        stats.changes += 1;
+    }
+    stats.samples += 1;
+}
+
+RegisterTrace::Cone const &RegisterTrace::find_cone(uint32_t slot) const {
+    auto it = cones.find(slot);
+    if (it != cones.end())
+        return it->second;
+
+    Cone cone{};
+    vector<bool> visited(program->code.size(), false);
+    vector<bool> seen_root(roots.size(), false);
+    vector<uint32_t> stack{slot};
+    while (!stack.empty()) {
+        uint32_t const next = stack.back();
+        stack.pop_back();
+        if (writer[next] == NO_SLOT) {
+            if (!seen_root[root_index[next]])
+                cone.roots.push_back(root_index[next]);
+            seen_root[root_index[next]] = true;
+            continue;
+        }
+        if (visited[writer[next]])
+            continue;
+        visited[writer[next]] = true;
+        cone.code.push_back(writer[next]);
+        for (uint32_t read : reads(*program, program->code[writer[next]])) {
+            stack.push_back(read);
+        }
+    }
+    sort(cone.code.begin(), cone.code.end());
+    return cones.emplace(slot, std::move(cone)).first->second;
+}
+
+uint64_t RegisterTrace::get_raw(Net const *net, uint64_t cycle) const {
+    auto it = program->net_slots.find(net);
+    if (it == program->net_slots.end())
+        throw runtime_error(net->get_name() + " is not in the program");
+    return get_value(it->second, cycle);
+}
+
+uint64_t RegisterTrace::get_value(Location const &location, uint64_t cycle) const {
+    if (cycle < first_cycle || cycle >= first_cycle + stats.samples)
+        throw runtime_error("Cycle " + to_string(cycle) + " was not sampled");
+    Cone const &cone = find_cone(location.slot);
+    if (values.empty()) {
+        values = program->initial;
+        size_t in = 0, out = 0;
+        for (Call const &call : program->calls) {
+            in = max(in, call.in.size());
+            out = max(out, call.out.size());
+        }
+        call_in.resize(in);
+        call_out.resize(out);
+    }
+
+    for (uint32_t root : cone.roots) {
+        vector<Change> const &root_changes = changes[root];
+        auto change = upper_bound(root_changes.begin(), root_changes.end(), cycle,
+            [](uint64_t c, Change const &x) { return c < x.cycle; });
+        values[roots[root]] = prev(change)->value;
+    }
+    ProgramView const view = program->view();
+    for (uint32_t index : cone.code) {
+        Instruction const &ins = program->code[index];
+        if (ins.opcode != Opcode::Call) {
+            execute(ins, values.data(), view);
+            continue;
+        }
+        Call const &call = program->calls[ins.a];
+        for (size_t i = 0; i < call.in.size(); ++i) {
+            call_in[i] = values[call.in[i]];
+        }
+        call.calculate(call_in.data(), call_out.data());
+        for (size_t i = 0; i < call.out.size(); ++i) {
+            values[call.out[i]] = call_out[i];
+        }
+    }
+    return (values[location.slot] >> location.shift) & width_mask(location.width);
+}
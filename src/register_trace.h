@@ -0,0 +1,85 @@
+#ifndef REGISTER_TRACE_H_
+#define REGISTER_TRACE_H_
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include "wire.h"
+#include "program.h"
+#include "simulator.h"
+
+/* A trace of a Simulator which only records the slots the code does not
+ * write: the state of the registers, the inputs and the constants. Every
+ * other value is a function of those, so it is computed again when asked for,
+ * by executing the instructions of its fan-in cone on the recorded values of
+ * that cycle.
+ *
+ *   RegisterTrace trace{simulator};
+ *   for (...) {
+ *       simulator.read_inputs();
+ *       trace.sample(simulator);
+ *       simulator.clock();
+ *   }
+ *   uint64_t sum = trace.get_raw(&sum_wire, 1000);
+ *
+ * A sample is taken before clock(), and get_raw(net, cycle) is the value of
+ * the net in the clock() which started at that cycle. Trace::sample() after
+ * that clock() shows the same values.
+ *
+ * Only changes are kept. Queries use the objects of Calls, so they must not
+ * run at the same time as a Simulator of a program which is not shareable.
+ */
+
+struct RegisterTraceStats {
+    uint64_t samples = 0;
+    uint64_t changes = 0;
+    uint64_t roots = 0;  // Slots recorded in every sample
+};
+
+class RegisterTrace {
+public:
+    // Simulators of mapped programs are not supported
+    RegisterTrace(Simulator const &simulator);
+    RegisterTrace(RegisterTrace const &) = delete;
+    RegisterTrace &operator=(RegisterTrace const &) = delete;
+
+    // Record the values the next clock() starts from, at simulator's cycle
+    void sample(Simulator const &simulator);
+
+    // The value of a net, or location, in the cycle
+    uint64_t get_raw(Net const *net, uint64_t cycle) const;
+    uint64_t get_value(Location const &location, uint64_t cycle) const;
+
+    RegisterTraceStats const &get_stats() const { return stats; }
+
+private:
+    struct Change {
+        uint64_t cycle;
+        uint64_t value;
+    };
+    // What it takes to compute a slot
+    struct Cone {
+        std::vector<uint32_t> code;   // Instructions, in program order
+        std::vector<uint32_t> roots;  // Indices into roots
+    };
+
+    Cone const &find_cone(uint32_t slot) const;
+
+    std::shared_ptr<Program const> program;
+    std::vector<uint32_t> roots{};
+    std::vector<uint32_t> root_index{};  // Of every slot, NO_SLOT if written by code
+    std::vector<uint32_t> writer{};      // Instruction writing every slot
+    std::vector<std::vector<Change>> changes{};  // Of every root
+    std::vector<uint64_t> last{};                // Value of every root
+    uint64_t first_cycle{0};
+    RegisterTraceStats stats{};
+
+    mutable std::unordered_map<uint32_t, Cone> cones{};
+    mutable std::vector<uint64_t> values{};
+    mutable std::vector<uint64_t> call_in{};
+    mutable std::vector<uint64_t> call_out{};
+};
+
+#endif  // REGISTER_TRACE_H_
@@ -0,0 +1,174 @@
+#include <unordered_map>
+#include <typeinfo>
+#include <stdexcept>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "schedule_cache.h"
+#include "compiler.h"
+
+using namespace std;
+
+namespace {
+
+// Removes a file when it goes out of scope, unless it is kept
+class TemporaryFile {
+public:
+    explicit TemporaryFile(string const &path): path{path} {}
+    TemporaryFile(TemporaryFile const &) = delete;
+    TemporaryFile &operator=(TemporaryFile const &) = delete;
+    ~TemporaryFile() {
+        if (!kept)
+            remove(path.c_str());
+    }
+
+    string const &get_path() const { return path; }
+    void keep() { kept = true; }
+
+private:
+    string path;
+    bool kept{false};
+};
+
+class Hasher {
+public:
+    void add(uint64_t value) {
+        // The finalizer of MurmurHash3, which mixes every bit into every bit
+        state = (state ^ value) + 0x9e3779b97f4a7c15;
+        state = (state ^ (state >> 33)) * 0xff51afd7ed558ccd;
+        state = (state ^ (state >> 33)) * 0xc4ceb9fe1a85ec53;
+        state ^= state >> 33;
+    }
+
+    void add(string const &text) {
+        add(text.size());
+        for (size_t i = 0; i < text.size(); i += 8) {
+            uint64_t chunk = 0;
+            memcpy(&chunk, text.data() + i, min<size_t>(8, text.size() - i));
+            add(chunk);
+        }
+    }
+
+    uint64_t get() const { return state; }
+
+private:
+    uint64_t state{0};
+};
+
+}  // namespace
+
+uint64_t hash_netlist(Netlist const &netlist) {
+    Hasher hasher{};
+    unordered_map<Net const*, uint64_t> index{};
+    index.reserve(netlist.get_nets().size());
+    // Hashes of the type names, which are long
+    unordered_map<type_info const*, uint64_t> types{};
+    auto add_type = [&](auto const &object) {
+        type_info const *type = &typeid(object);
+        auto it = types.find(type);
+        if (it == types.end()) {
+            Hasher name{};
+            name.add(type->name());
+            it = types.emplace(type, name.get()).first;
+        }
+        hasher.add(it->second);
+    };
+    for (Net *net : netlist.get_nets()) {
+        index[net] = index.size();
+        hasher.add(net->get_width());
+        hasher.add(net->get_name());
+    }
+    auto add_inputs = [&](Component *component) {
+        vector<Port*> const inputs = component->get_inputs();
+        hasher.add(inputs.size());
+        for (Port *port : inputs) {
+            Net *net = netlist.get_net(port);
+            hasher.add(port->get_width());
+            hasher.add((net != nullptr) ? index.at(net) : UINT64_MAX);
+        }
+    };
+
+    hasher.add(netlist.get_clockables().size());
+    for (Clockable *clockable : netlist.get_clockables()) {
+        add_type(*clockable);
+        hasher.add(clockable->is_constant());
+        hasher.add(clockable->get_raw_state());
+        vector<Net*> const wires = clockable->get_start_wires();
+        hasher.add(wires.size());
+        for (Net *wire : wires) {
+            hasher.add(index.at(wire));
+        }
+        if (Component *component = dynamic_cast<Component*>(clockable)) {
+            hasher.add(component->get_name());
+            add_inputs(component);
+        }
+    }
+
+    hasher.add(netlist.get_components().size());
+    for (Component *component : netlist.get_components()) {
+        add_type(*component);
+        hasher.add(static_cast<uint64_t>(component->get_operation()));
+        hasher.add(component->get_name());
+        add_inputs(component);
+        for (Net *outwire : component->get_outwires()) {
+            hasher.add(index.at(outwire));
+        }
+    }
+
+    hasher.add(netlist.get_endpoints().size());
+    for (Component *endpoint : netlist.get_endpoints()) {
+        add_type(*endpoint);
+        hasher.add(endpoint->get_name());
+        add_inputs(endpoint);
+    }
+    return hasher.get();
+}
+
+ScheduleCache::ScheduleCache(string const &directory): directory{directory} {
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+        throw runtime_error(directory + ": can not be made");
+}
+
+string ScheduleCache::get_path(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.prog", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+shared_ptr<MappedProgram const> ScheduleCache::load(Netlist const &netlist, Optimize const &optimize,
+        string const &version) {
+    Hasher hasher{};
+    hasher.add(hash_netlist(netlist));
+    hasher.add(version);
+    uint64_t const key = hasher.get();
+    string const path = get_path(key);
+
+    if (access(path.c_str(), R_OK) == 0) {
+        try {
+            auto mapped = make_shared<MappedProgram const>(path);
+            if (mapped->get_header().key == key) {
+                stats.hits += 1;
+                return mapped;
+            }
+        } catch (runtime_error const &) {
+            // A broken file, made again below
+        }
+    }
+
+    stats.misses += 1;
+    Program program = compile(netlist);
+    if (optimize)
+        optimize(program);
+
+    // Other runs may load the same key, they only ever see a whole file
+    TemporaryFile temporary{path + "." + to_string(getpid())};
+    save_program(program, temporary.get_path(), key);
+    if (rename(temporary.get_path().c_str(), path.c_str()) != 0)
+        throw runtime_error(path + ": can not be written");
+    temporary.keep();
+    return make_shared<MappedProgram const>(path);
+}
@@ -0,0 +1,60 @@
+#ifndef SCHEDULE_CACHE_H_
+#define SCHEDULE_CACHE_H_
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include "netlist.h"
+#include "program.h"
+#include "program_file.h"
+
+/* A cache of compiled designs on disk.
+ *
+ * Compiling a large design and running the program passes on it takes a long
+ * time, while most runs simulate a design which has not changed. The cache
+ * keys a program file by a hash of the structure of the netlist: the types,
+ * operations, names and widths of everything in it, how they are connected
+ * and the initial states. A later run with the same netlist maps the file
+ * instead of compiling, any change to the netlist gives a different key.
+ *
+ *   ScheduleCache cache{"cache"};
+ *   Simulator simulator{cache.load(netlist, [](Program &p) { lift_words(p); }, "lift")};
+ *
+ * The passes run by optimize are not part of the netlist, name them with a
+ * version which changes when they do. Programs which call objects of the
+ * design can not be cached, see program_file.h.
+ */
+
+// Hash of the structure of a netlist, the same for every run of the program
+uint64_t hash_netlist(Netlist const &netlist);
+
+struct CacheStats {
+    int hits = 0;
+    int misses = 0;
+};
+
+class ScheduleCache {
+public:
+    using Optimize = std::function<void(Program &)>;
+
+    // The directory is made if it does not exist
+    ScheduleCache(std::string const &directory);
+    ScheduleCache(ScheduleCache const &) = delete;
+    ScheduleCache &operator=(ScheduleCache const &) = delete;
+
+    // The program of a netlist, mapped from the cache, or compiled, optimized
+    // and saved to the cache first
+    std::shared_ptr<MappedProgram const> load(Netlist const &netlist, Optimize const &optimize={},
+        std::string const &version="");
+
+    std::string get_path(uint64_t key) const;
+    CacheStats const &get_stats() const { return stats; }
+
+private:
+    std::string directory;
+    CacheStats stats{};
+};
+
+#endif  // SCHEDULE_CACHE_H_
@@ -7,6 +7,7 @@
 
 #include "component.h"
 #include "input_port.h"
+#include "wire.h"
 #include "bit_vector.h"
 
 template <int N, int INPUTS>
@@ -40,6 +41,15 @@ public:
         }
     }
 
+    std::vector<Port*> get_inputs() override {
+        std::vector<Port*> ports{};
+        for (auto &port : input) {
+            ports.push_back(&port);
+        }
+        return ports;
+    }
+    std::vector<Net*> get_outwires() override { return {outwire}; }
+
 protected:
     virtual BitVector<N> calculate_outvalue() = 0;
 
@@ -54,6 +64,8 @@ public:
     Inverter(Wire<N> *outwire, std::string const &name="Inverter"): SimpleComponent<N, 1>(outwire, name) {}
     InputPort<N> &input = SimpleComponent<N, 1>::input[0];
 
+    Operation get_operation() const override { return Operation::Not; }
+
 private:
     BitVector<N> calculate_outvalue() override {
         return ~(input.get_value());
@@ -65,6 +77,8 @@ class ANDGate: public SimpleComponent<N, 2> {
 public:
     ANDGate(Wire<N> *outwire, std::string const &name="AndGate"): SimpleComponent<N, 2>(outwire, name) {}
 
+    Operation get_operation() const override { return Operation::And; }
+
 private:
     BitVector<N> calculate_outvalue() override {
         return this->input[0].get_value() & this->input[1].get_value();
@@ -76,6 +90,8 @@ class NANDGate: public SimpleComponent<N, 2> {
 public:
     NANDGate(Wire<N> *outwire, std::string const &name="AndGate"): SimpleComponent<N, 2>(outwire, name) {}
 
+    Operation get_operation() const override { return Operation::Nand; }
+
 private:
     BitVector<N> calculate_outvalue() override {
         return ~(this->input[0].get_value() & this->input[1].get_value());
@@ -87,6 +103,8 @@ class ORGate: public SimpleComponent<N, 2> {
 public:
     ORGate(Wire<N> *outwire, std::string const &name="AndGate"): SimpleComponent<N, 2>(outwire, name) {}
 
+    Operation get_operation() const override { return Operation::Or; }
+
 private:
     BitVector<N> calculate_outvalue() override {
         return this->input[0].get_value() | this->input[1].get_value();
@@ -98,6 +116,8 @@ class XORGate: public SimpleComponent<N, 2> {
 public:
     XORGate(Wire<N> *outwire, std::string const &name="AndGate"): SimpleComponent<N, 2>(outwire, name) {}
 
+    Operation get_operation() const override { return Operation::Xor; }
+
 private:
     BitVector<N> calculate_outvalue() override {
         return this->input[0].get_value() ^ this->input[1].get_value();
@@ -109,6 +129,8 @@ class NORGate: public SimpleComponent<N, 2> {
 public:
     NORGate(Wire<N> *outwire, std::string const &name="AndGate"): SimpleComponent<N, 2>(outwire, name) {}
 
+    Operation get_operation() const override { return Operation::Nor; }
+
 private:
     BitVector<N> calculate_outvalue() override {
         return ~(this->input[0].get_value() | this->input[1].get_value());
@@ -0,0 +1,168 @@
+#include <algorithm>
+
+#include "simulator.h"
+#include "parallel.h"
+
+using namespace std;
+
+Simulator::Simulator(Netlist const &netlist):
+    program{make_shared<Program const>(compile(netlist, &stats))},
+    view{program->view()} {
+    allocate();
+}
+
+Simulator::Simulator(Program compiled):
+    program{make_shared<Program const>(std::move(compiled))},
+    view{program->view()} {
+    allocate();
+}
+
+Simulator::Simulator(std::shared_ptr<Program const> shared):
+    program{shared},
+    view{program->view()} {
+    allocate();
+}
+
+Simulator::Simulator(std::shared_ptr<MappedProgram const> mapped):
+    program{make_shared<Program const>()},
+    mapped{mapped},
+    view{mapped->get_view()} {
+    allocate();
+}
+
+Simulator::Simulator(Simulator const &parent):
+    stats{parent.stats},
+    program{parent.program},
+    mapped{parent.mapped},
+    view{parent.view},
+    values{parent.values},
+    staged(parent.staged.size()),
+    call_in(parent.call_in.size()),
+    call_out(parent.call_out.size()),
+    outputs{parent.outputs},
+    copies{parent.copies},
+    cycle{parent.cycle},
+    inputs_read{parent.inputs_read} {
+}
+
+bool Simulator::is_replayable() const {
+    for (InputSlot const *input = view.inputs; input != view.inputs + view.input_count; ++input) {
+        if (!input->stateless)
+            return false;
+    }
+    return outputs.empty();
+}
+
+unique_ptr<Simulator> Simulator::fork() const {
+    if (!is_replayable())
+        throw runtime_error("A Simulator with an input read in order or a recording sink, such as a "
+            "StimulusFeed or a RecordingSink, can not be forked");
+    return unique_ptr<Simulator>(new Simulator{*this});
+}
+
+void Simulator::allocate() {
+    values.assign(view.initial, view.initial + view.slots);
+    staged.resize(view.latch_count);
+    size_t in = 0, out = 0;
+    for (Call const &call : program->calls) {
+        in = max(in, call.in.size());
+        out = max(out, call.out.size());
+    }
+    call_in.resize(in);
+    call_out.resize(out);
+    for (OutputSlot const &output : program->outputs) {
+        outputs.push_back(program->sink_slots.at(output.sink));
+    }
+    copies = view.code_size;
+    while (copies > 0 && view.code[copies - 1].opcode == Opcode::Copy) {
+        --copies;
+    }
+}
+
+void Simulator::read_inputs() {
+    for (InputSlot const *input = view.inputs; input != view.inputs + view.input_count; ++input) {
+        values[input->slot] = input->read(cycle);
+    }
+    inputs_read = cycle + 1;
+}
+
+void Simulator::clock() {
+    if (inputs_read != cycle + 1)
+        read_inputs();
+    uint64_t *v = values.data();
+    for (Instruction const *ins = view.code; ins != view.code + copies; ++ins) {
+        if (ins->opcode != Opcode::Call) {
+            execute(*ins, v, view);
+            continue;
+        }
+        Call const &call = view.calls[ins->a];
+        for (size_t i = 0; i < call.in.size(); ++i) {
+            call_in[i] = v[call.in[i]];
+        }
+        call.calculate(call_in.data(), call_out.data());
+        for (size_t i = 0; i < call.out.size(); ++i) {
+            v[call.out[i]] = call_out[i];
+        }
+    }
+    // The copies of the states for the nets and sinks of registers
+    for (Instruction const *ins = view.code + copies; ins != view.code + view.code_size; ++ins) {
+        v[ins->out] = v[ins->a];
+    }
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        program->outputs[i].write(read(outputs[i]));
+    }
+
+    // Latch in two steps, a register may feed another register directly
+    for (size_t i = 0; i < view.latch_count; ++i) {
+        staged[i] = v[view.latches[i].next];
+    }
+    for (size_t i = 0; i < view.latch_count; ++i) {
+        v[view.latches[i].state] = staged[i];
+    }
+    ++cycle;
+}
+
+void Simulator::run(uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; ++i) {
+        clock();
+    }
+}
+
+void Simulator::write(Location const &location, uint64_t value) {
+    uint64_t const mask = width_mask(location.width) << location.shift;
+    values[location.slot] = (values[location.slot] & ~mask) | ((value << location.shift) & mask);
+}
+
+uint64_t Simulator::get_raw(Net const *net) const {
+    return read(program->net_slots.at(net));
+}
+
+uint64_t Simulator::get_state(Clockable const *clockable) const {
+    return read(program->state_slots.at(clockable));
+}
+
+void Simulator::set_state(Clockable const *clockable, uint64_t value) {
+    write(program->state_slots.at(clockable), value);
+}
+
+uint64_t Simulator::get_sink(Component const *sink) const {
+    return read(program->sink_slots.at(sink));
+}
+
+void Simulator::write_back(Netlist const &netlist) const {
+    for (Clockable *clockable : netlist.get_clockables()) {
+        auto it = program->state_slots.find(clockable);
+        if (it != program->state_slots.end())
+            clockable->set_raw_state(read(it->second));
+    }
+}
+
+void run_forks(Simulator const &simulator, size_t branches, unsigned threads,
+        function<void(size_t branch, Simulator &fork)> const &function) {
+    if (!is_shareable(simulator.get_program()))
+        threads = 1;
+    parallel_tasks(branches, resolve_threads(threads), [&](size_t branch) {
+        unique_ptr<Simulator> fork = simulator.fork();
+        function(branch, *fork);
+    });
+}
@@ -0,0 +1,111 @@
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include "netlist.h"
+#include "program.h"
+#include "compiler.h"
+#include "program_file.h"
+
+/* A Simulator runs a compiled design. It is an alternative to the Clock for
+ * designs which are done with elaboration.
+ *
+ * The state is kept by the Simulator, not by the Registers of the design. Use
+ * get_state() to read it, or write_back() to copy it to the Registers.
+ *
+ * A Program is the immutable topology of a design and a Simulator is one run
+ * of it, many Simulators may share a program and run on their own threads
+ * if is_shareable(program). Programs calling a MemoizedCone, or a cone through
+ * its components, keep state in the objects of the design and are not.
+ *
+ * The inputs of the design, such as InputStreams, are read by the Simulator
+ * itself at the start of every clock(), and the sinks which record their
+ * values, such as RecordingSinks, are written at the end. Other values can be
+ * changed with write() between clock() calls.
+ *
+ * fork() makes a Simulator which continues from the same cycle and state. The
+ * program is shared, read only, between a Simulator and its forks, only the
+ * slots are copied. Every slot is written in every cycle, so copy-on-write
+ * pages would be copied in the first cycle of a fork anyway. A Simulator with
+ * an input which is read in order rather than by cycle, such as a
+ * StimulusFeed, or a recording sink can not be forked, or checkpointed: the
+ * runs would take turns at one stream of values.
+ */
+
+class Simulator {
+public:
+    Simulator(Netlist const &netlist);
+    // Run a program which has already been compiled, and possibly optimized
+    Simulator(Program program);
+    // Run a program shared with other Simulators, from its initial state
+    Simulator(std::shared_ptr<Program const> program);
+    // Run a program mapped from a file, look values up with mapped->find()
+    Simulator(std::shared_ptr<MappedProgram const> mapped);
+    Simulator &operator=(Simulator const &) = delete;
+
+    void clock();
+    void run(uint64_t cycles);
+    // Write the inputs of this cycle from their sources, see Program::inputs.
+    // clock() does it unless it was done in this cycle.
+    void read_inputs();
+    uint64_t get_cycle() const { return cycle; }
+
+    uint64_t read(Location const &location) const {
+        return (values[location.slot] >> location.shift) & width_mask(location.width);
+    }
+    void write(Location const &location, uint64_t value);
+    // The value of a net in the last cycle
+    uint64_t get_raw(Net const *net) const;
+    // The state of a Register
+    uint64_t get_state(Clockable const *clockable) const;
+    // Change the state of a Register, it is used from the next clock()
+    void set_state(Clockable const *clockable, uint64_t value);
+    // The value of a Sink
+    uint64_t get_sink(Component const *sink) const;
+
+    // Copy the state to the Registers of the design
+    void write_back(Netlist const &netlist) const;
+
+    // Every input is read by cycle and no sink records, see InputSlot::stateless
+    // and Program::outputs. Only such a run can be forked or checkpointed.
+    bool is_replayable() const;
+    // A Simulator at the same cycle and state, sharing the program
+    std::unique_ptr<Simulator> fork() const;
+
+    Program const &get_program() const { return *program; }
+    std::shared_ptr<Program const> const &get_shared_program() const { return program; }
+    CompileStats const &get_stats() const { return stats; }
+
+private:
+    friend class Checkpointer;
+    friend class Trace;
+
+    // Only made by fork()
+    Simulator(Simulator const &parent);
+    void allocate();
+
+    CompileStats stats{};
+    std::shared_ptr<Program const> program;
+    std::shared_ptr<MappedProgram const> mapped{};
+    ProgramView view;
+    std::vector<uint64_t> values{};
+    std::vector<uint64_t> staged{};
+    std::vector<uint64_t> call_in{};
+    std::vector<uint64_t> call_out{};
+    std::vector<Location> outputs{};  // Of Program::outputs
+    size_t copies{0};         // The Copies at the end of the code start here
+    uint64_t cycle{0};
+    uint64_t inputs_read{0};  // One more than the cycle of the inputs
+};
+
+// Run function(branch, simulator) on a fork of simulator for every branch, on
+// up to threads threads, 0 is one per core. Programs which are not shareable
+// run their branches one after the other.
+void run_forks(Simulator const &simulator, size_t branches, unsigned threads,
+    std::function<void(size_t branch, Simulator &fork)> const &function);
+
+#endif  // SIMULATOR_H_
@@ -31,6 +31,8 @@ public:
         is_set = false;
     }
 
+    std::vector<Port*> get_inputs() override { return {&input}; }
+
 private:
     BitVector<N> value{};
     bool is_set = false;
@@ -0,0 +1,86 @@
+#ifndef SPSC_RING_H_
+#define SPSC_RING_H_
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstddef>
+
+/* A bounded queue from one producer thread to one consumer thread, without
+ * locks. The capacity is rounded up to a power of two. Each side keeps a copy
+ * of the other side's index, so it only reads the shared one when the ring
+ * looks full or empty.
+ */
+
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity): items(round_up(capacity)), mask{items.size() - 1} {}
+    SpscRing(SpscRing const &) = delete;
+    SpscRing &operator=(SpscRing const &) = delete;
+
+    // Producer: false if the ring is full
+    bool try_push(T const &item) {
+        size_t const position = tail.load(std::memory_order_relaxed);
+        if (position - head_copy == items.size()) {
+            head_copy = head.load(std::memory_order_acquire);
+            if (position - head_copy == items.size())
+                return false;
+        }
+        items[position & mask] = item;
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Producer: push up to count items at once, returns how many
+    size_t push(T const *in, size_t count) {
+        size_t const position = tail.load(std::memory_order_relaxed);
+        if (items.size() - (position - head_copy) < count)
+            head_copy = head.load(std::memory_order_acquire);
+        size_t const space = std::min(count, items.size() - (position - head_copy));
+        for (size_t i = 0; i < space; ++i) {
+            items[(position + i) & mask] = in[i];
+        }
+        tail.store(position + space, std::memory_order_release);
+        return space;
+    }
+
+    // Consumer: move up to count items to out, returns how many
+    size_t pop(T *out, size_t count) {
+        size_t const position = head.load(std::memory_order_relaxed);
+        if (tail_copy - position < count)
+            tail_copy = tail.load(std::memory_order_acquire);
+        size_t const available = std::min(count, tail_copy - position);
+        for (size_t i = 0; i < available; ++i) {
+            out[i] = items[(position + i) & mask];
+        }
+        head.store(position + available, std::memory_order_release);
+        return available;
+    }
+
+    // Either side, a snapshot which may be out of date
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return items.size(); }
+
+private:
+    static size_t round_up(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size *= 2;
+        }
+        return size;
+    }
+
+    std::vector<T> items;
+    size_t const mask;
+    // Written by the consumer
+    alignas(64) std::atomic<size_t> head{0};
+    size_t tail_copy{0};
+    // Written by the producer
+    alignas(64) std::atomic<size_t> tail{0};
+    size_t head_copy{0};
+};
+
+#endif  // SPSC_RING_H_
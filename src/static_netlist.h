@@ -0,0 +1,306 @@
+#ifndef STATIC_NETLIST_H_
+#define STATIC_NETLIST_H_
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+
+#include "bit_vector.h"
+#include "component.h"
+#include "clockable.h"
+#include "input_port.h"
+#include "wire.h"
+
+/* A netlist whose structure is known at compile time.
+ *
+ * Components are types and the design is a type built from them, so the
+ * compiler sees the whole cycle function and inlines it: there are no virtual
+ * calls, no wires and no heap allocations. Every register, input and output
+ * is named by a tag type:
+ *
+ *   struct Count; struct Step; struct Low;
+ *   using Counter = static_netlist::Design<
+ *       Registers<Reg<Count, 8, Add<Q<Count>, In<Step>>>>,
+ *       Inputs<Input<Step, 8>>,
+ *       Outputs<Output<Low, Slice<3, 0, Q<Count>>>>>;
+ *
+ * The next value of a register may use registers and inputs, outputs may only
+ * use registers. Widths are checked by the compiler through BitVector.
+ *
+ * A StaticBlock runs a Design inside a dynamic design, as one Clockable.
+ */
+
+namespace static_netlist {
+
+// Expressions
+
+template <int N, uint64_t V>
+struct Const {
+    template <typename S>
+    static BitVector<N> eval(S const &) { return BitVector<N>{static_cast<T<N>>(V)}; }
+};
+
+// The value of a register
+template <typename Tag>
+struct Q {
+    template <typename S>
+    static auto eval(S const &s) { return s.template get<Tag>(); }
+};
+
+// The value of an input
+template <typename Tag>
+struct In {
+    template <typename S>
+    static auto eval(S const &s) { return s.template get_input<Tag>(); }
+};
+
+template <typename A>
+struct Not {
+    template <typename S>
+    static auto eval(S const &s) { return ~A::eval(s); }
+};
+
+template <typename A, typename B>
+struct And {
+    template <typename S>
+    static auto eval(S const &s) { return A::eval(s) & B::eval(s); }
+};
+
+template <typename A, typename B>
+struct Nand {
+    template <typename S>
+    static auto eval(S const &s) { return ~(A::eval(s) & B::eval(s)); }
+};
+
+template <typename A, typename B>
+struct Or {
+    template <typename S>
+    static auto eval(S const &s) { return A::eval(s) | B::eval(s); }
+};
+
+template <typename A, typename B>
+struct Xor {
+    template <typename S>
+    static auto eval(S const &s) { return A::eval(s) ^ B::eval(s); }
+};
+
+template <typename A, typename B>
+struct Nor {
+    template <typename S>
+    static auto eval(S const &s) { return ~(A::eval(s) | B::eval(s)); }
+};
+
+template <typename A, typename B, typename Cin=Const<1, 0>>
+struct Add {
+    template <typename S>
+    static auto eval(S const &s) { return A::eval(s).add(B::eval(s), Cin::eval(s)); }
+};
+
+// The carry out of Add<A, B, Cin>
+template <typename A, typename B, typename Cin=Const<1, 0>>
+struct Carry {
+    template <typename S>
+    static BitVector<1> eval(S const &s) {
+        auto const sum = A::eval(s).addc(B::eval(s), Cin::eval(s));
+        return sum[sum.length - 1];
+    }
+};
+
+// Bits Hi down to Lo
+template <int Hi, int Lo, typename A>
+struct Slice {
+    template <typename S>
+    static auto eval(S const &s) { return A::eval(s).template slice<Hi, Lo>(); }
+};
+
+// A in the high bits, B in the low bits
+template <typename A, typename B>
+struct Concat {
+    template <typename S>
+    static auto eval(S const &s) { return concatenate(A::eval(s), B::eval(s)); }
+};
+
+// Parts of a design
+
+template <typename Tag_, int N, typename Next, uint64_t Initial=0>
+struct Reg {
+    using Tag = Tag_;
+    static constexpr int width = N;
+    using next = Next;
+    static BitVector<N> initial() { return BitVector<N>{static_cast<T<N>>(Initial)}; }
+};
+
+template <typename Tag_, int N>
+struct Input {
+    using Tag = Tag_;
+    static constexpr int width = N;
+};
+
+template <typename Tag_, typename Expr>
+struct Output {
+    using Tag = Tag_;
+    using expr = Expr;
+};
+
+template <typename... R> struct Registers {};
+template <typename... I> struct Inputs {};
+template <typename... O> struct Outputs {};
+
+template <typename V>
+struct width_of;
+
+template <int N>
+struct width_of<BitVector<N>> {
+    static constexpr int value = N;
+};
+
+// Position of the part with tag Tag
+template <typename Tag, typename... Parts>
+struct index_of;
+
+template <typename Tag, typename First, typename... Rest>
+struct index_of<Tag, First, Rest...> {
+    static constexpr size_t value = std::is_same<Tag, typename First::Tag>::value ?
+        0 : 1 + index_of<Tag, Rest...>::value;
+};
+
+template <typename Tag>
+struct index_of<Tag> {
+    static constexpr size_t value = 0;
+};
+
+template <typename R, typename I=Inputs<>, typename O=Outputs<>>
+class Design;
+
+template <typename... R, typename... I, typename... O>
+class Design<Registers<R...>, Inputs<I...>, Outputs<O...>> {
+public:
+    using State = std::tuple<BitVector<R::width>...>;
+    using InputValues = std::tuple<BitVector<I::width>...>;
+
+    static constexpr size_t register_count = sizeof...(R);
+    static constexpr size_t input_count = sizeof...(I);
+    static constexpr size_t output_count = sizeof...(O);
+
+    void cycle() {
+        // All next values are calculated before any register changes
+        State next{R::next::eval(*this)...};
+        state = next;
+    }
+
+    template <typename Tag>
+    auto const &get() const { return std::get<index_of<Tag, R...>::value>(state); }
+    template <typename Tag, typename V>
+    void set(V value) { std::get<index_of<Tag, R...>::value>(state) = value; }
+
+    template <typename Tag>
+    auto const &get_input() const { return std::get<index_of<Tag, I...>::value>(inputs); }
+    template <typename Tag, typename V>
+    void set_input(V value) { std::get<index_of<Tag, I...>::value>(inputs) = value; }
+
+    // Outputs only see the registers
+    template <typename Tag>
+    auto get_output() const {
+        using Part = typename std::tuple_element<index_of<Tag, O...>::value, std::tuple<O...>>::type;
+        return Part::expr::eval(Registered{*this});
+    }
+
+    template <typename Tag>
+    static constexpr int output_width = width_of<decltype(std::declval<Design const &>().template get_output<Tag>())>::value;
+
+    State const &get_state() const { return state; }
+    InputValues &get_inputs() { return inputs; }
+
+private:
+    struct Registered {
+        Design const &design;
+        template <typename Tag>
+        auto const &get() const { return design.template get<Tag>(); }
+    };
+
+    State state{R::initial()...};
+    InputValues inputs{};
+};
+
+}  // namespace static_netlist
+
+/* A StaticBlock is a static Design in a dynamic design. It is a Component
+ * with an InputPort per Input and a Clockable which drives a wire per Output,
+ * like a Register. The inputs are sampled at clock(), the outputs are set when
+ * the set chain starts.
+ */
+template <typename D>
+class StaticBlock;
+
+template <typename... R, typename... I, typename... O>
+class StaticBlock<static_netlist::Design<static_netlist::Registers<R...>, static_netlist::Inputs<I...>, static_netlist::Outputs<O...>>>:
+        public Component, public Clockable {
+public:
+    using Design = static_netlist::Design<static_netlist::Registers<R...>, static_netlist::Inputs<I...>, static_netlist::Outputs<O...>>;
+
+    StaticBlock(std::string const &name="StaticBlock"): Component(name), Clockable() {}
+    StaticBlock(StaticBlock const &) = delete;
+    StaticBlock &operator=(StaticBlock const &) = delete;
+
+    template <typename Tag>
+    auto &input() { return std::get<static_netlist::index_of<Tag, I...>::value>(ports); }
+
+    template <typename Tag, int N>
+    void connect(Wire<N> *wire) {
+        std::get<static_netlist::index_of<Tag, O...>::value>(outwires) = wire;
+    }
+
+    Design &get_design() { return design; }
+
+    void clock() override {
+        sample(std::index_sequence_for<I...>{});
+        design.cycle();
+    }
+
+    void start_set_chain() override {
+        (drive<O>(), ...);
+    }
+
+    void start_reset_chain() override {
+        std::apply([](auto *... wire) { ((wire != nullptr ? wire->reset() : void()), ...); }, outwires);
+    }
+
+    // The inputs are only read at clock()
+    void set() override {}
+    void reset() override {}
+
+    std::vector<Port*> get_inputs() override {
+        return std::apply([](auto &... port) { return std::vector<Port*>{&port...}; }, ports);
+    }
+    std::vector<Net*> get_start_wires() override {
+        std::vector<Net*> wires{};
+        std::apply([&wires](auto *... wire) { ((wire != nullptr ? wires.push_back(wire) : void()), ...); }, outwires);
+        return wires;
+    }
+
+private:
+    template <typename In>
+    struct BlockPort: public InputPort<In::width> {
+        explicit BlockPort(Component *parent): InputPort<In::width>(parent, parent->get_name() + ".in") {}
+    };
+
+    template <size_t... Index>
+    void sample(std::index_sequence<Index...>) {
+        ((std::get<Index>(design.get_inputs()) = std::get<Index>(ports).get_value()), ...);
+    }
+
+    template <typename Out>
+    void drive() {
+        auto *wire = std::get<static_netlist::index_of<typename Out::Tag, O...>::value>(outwires);
+        if (wire != nullptr)
+            wire->set(design.template get_output<typename Out::Tag>());
+    }
+
+    Design design{};
+    std::tuple<BlockPort<I>...> ports{(static_cast<void>(sizeof(I)), this)...};
+    std::tuple<Wire<Design::template output_width<typename O::Tag>>*...> outwires{};
+};
+
+#endif  // STATIC_NETLIST_H_
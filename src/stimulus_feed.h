@@ -0,0 +1,135 @@
+#ifndef STIMULUS_FEED_H_
+#define STIMULUS_FEED_H_
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+#include <cstdint>
+
+#include "clockable.h"
+#include "wire.h"
+#include "bit_vector.h"
+#include "spsc_ring.h"
+
+/* A primary input which takes a new value in every cycle from a generator on
+ * another thread, so making the stimulus and simulating run on two cores.
+ *
+ * The generator pushes values into a lock-free ring of depth values, and
+ * waits while it is full. The simulation takes batch values out at a time,
+ * so the shared indices are touched once per batch, and waits while the
+ * ring is empty. After close() and the last value the feed keeps it:
+ *
+ *   StimulusFeed<8> a{&a_wire};
+ *   std::thread generator{[&]() {
+ *       for (...) a.push(values, count);
+ *       a.close();
+ *   }};
+ *   Clock clock{{&a, ...}};
+ *
+ * Like an InputStream, in a Simulator the feed is an input slot, which the
+ * Simulator writes with next() before every cycle. Unlike a stream it can not
+ * be read by cycle, so the Simulator can not be forked, run in a Farm or
+ * checkpointed.
+ */
+
+template <int N>
+class StimulusFeed: public InputSource {
+public:
+    using Value = T<N>;
+
+    StimulusFeed(Wire<N> *outwire, size_t depth=1 << 14, size_t batch=256):
+            InputSource(), ring{depth}, batch(batch), outwire{outwire} {
+        if (batch == 0 || batch > ring.capacity())
+            throw std::runtime_error("The batch of a StimulusFeed is 1 to depth values");
+    }
+    StimulusFeed(StimulusFeed<N> const &) = delete;
+    void operator=(StimulusFeed<N> const &) = delete;
+
+    // Generator: push values, waiting while the ring is full
+    void push(Value const *values, size_t count) {
+        size_t pushed = ring.push(values, count);
+        if (pushed == count)
+            return;
+        producer_stalls += 1;
+        while (pushed < count) {
+            std::this_thread::yield();
+            pushed += ring.push(values + pushed, count - pushed);
+        }
+    }
+    void push(Value value) { push(&value, 1); }
+    // Generator: there are no more values
+    void close() { closed.store(true, std::memory_order_release); }
+
+    // Simulation: the value of the next cycle, the last value once done
+    Value next() {
+        if (done)
+            return current;
+        if (position == batch_size)
+            refill();
+        if (position < batch_size)
+            current = batch[position++];
+        return current;
+    }
+
+    void clock() override {
+        fetched = false;
+    }
+    void start_set_chain() override {
+        if (!fetched) {
+            next();
+            fetched = true;
+        }
+        outwire->set(current);
+    }
+    void start_reset_chain() override {
+        outwire->reset();
+    }
+
+    std::vector<Net*> get_start_wires() override { return {outwire}; }
+    uint64_t get_raw_state() const override { return current; }
+    uint64_t read_input(uint64_t) override { return next(); }
+
+    // Closed and every value used
+    bool is_done() const { return done; }
+    // Times the generator waited for space, read on the generator thread
+    uint64_t get_producer_stalls() const { return producer_stalls; }
+    // Times the simulation waited for values
+    uint64_t get_consumer_stalls() const { return consumer_stalls; }
+
+private:
+    void refill() {
+        batch_size = ring.pop(batch.data(), batch.size());
+        position = 0;
+        if (batch_size > 0)
+            return;
+        consumer_stalls += 1;
+        while (batch_size == 0) {
+            // Values pushed before close() are seen by the pop after it
+            bool const last = closed.load(std::memory_order_acquire);
+            batch_size = ring.pop(batch.data(), batch.size());
+            if (batch_size == 0 && last) {
+                done = true;
+                return;
+            }
+            if (batch_size == 0)
+                std::this_thread::yield();
+        }
+    }
+
+    SpscRing<Value> ring;
+    std::atomic_bool closed{false};
+    uint64_t producer_stalls{0};
+
+    // Used by the simulation only
+    std::vector<Value> batch;
+    size_t batch_size{0};
+    size_t position{0};
+    Value current{0};
+    bool fetched{false};
+    bool done{false};
+    uint64_t consumer_stalls{0};
+    Wire<N> *outwire;
+};
+
+#endif  // STIMULUS_FEED_H_
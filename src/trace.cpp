@@ -0,0 +1,274 @@
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+#include "trace.h"
+
+using namespace std;
+
+namespace {
+
+// Identifiers of VCD signals are strings of the printable characters
+string make_id(size_t index) {
+    string id{};
+    do {
+        id += static_cast<char>('!' + index % 94);
+        index /= 94;
+    } while (index > 0);
+    return id;
+}
+
+// Names of VCD signals can not have spaces
+string make_name(string name) {
+    for (char &c : name) {
+        if (c == ' ' || c == '\t')
+            c = '_';
+    }
+    return name;
+}
+
+}  // namespace
+
+Trace::Trace(TraceWriter &writer, string const &path, TraceFormat format, size_t capacity):
+    writer{writer}, path{path}, format{format}, ring{capacity} {}
+
+Trace::~Trace() {
+    try {
+        close();
+    } catch (runtime_error const &) {
+        // The file could not be made, there is nothing to wait for
+    }
+}
+
+void Trace::add_signal(Signal const &signal) {
+    if (started)
+        throw runtime_error(signal.name + ": signals are added before the first sample of " + path);
+    if (!signals.empty() && (signals[0].net == nullptr) != (signal.net == nullptr))
+        throw runtime_error(signal.name + ": a trace is of nets or of a Simulator, not both");
+    signals.push_back(signal);
+}
+
+void Trace::add(Net const *net) {
+    add_signal({net->get_name(), net->get_width(), net, Location{}});
+}
+
+void Trace::add(string const &name, int width, Location const &location) {
+    add_signal({name, width, nullptr, location});
+}
+
+void Trace::add(Simulator const &simulator, Net const *net) {
+    auto const &slots = simulator.get_program().net_slots;
+    auto it = slots.find(net);
+    if (it == slots.end())
+        throw runtime_error(net->get_name() + " is not in the program");
+    add(net->get_name(), net->get_width(), it->second);
+}
+
+void Trace::start() {
+    for (Signal const &signal : signals) {
+        Location const &location = signal.location;
+        if (signal.net != nullptr)
+            nets.push_back(signal.net);
+        else
+            fields.push_back({location.slot, location.shift, width_mask(location.width)});
+    }
+    batch.resize(signals.size() + 1);
+    if (format == TraceFormat::Waves) {
+        waves = make_unique<WaveWriter>(path);
+        for (Signal const &signal : signals) {
+            waves->add_signal(signal.name, signal.width);
+        }
+        last.assign(signals.size(), 0);
+        started = true;
+        writer.attach(this);
+        return;
+    }
+    file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+        throw runtime_error(path + ": can not be written");
+    fprintf(file, "$timescale 1ns $end\n$scope module top $end\n");
+    for (size_t i = 0; i < signals.size(); ++i) {
+        ids.push_back(make_id(i));
+        fprintf(file, "$var wire %d %s %s $end\n", signals[i].width, ids[i].c_str(),
+            make_name(signals[i].name).c_str());
+    }
+    fprintf(file, "$upscope $end\n$enddefinitions $end\n");
+    last.assign(signals.size(), 0);
+    started = true;
+    writer.attach(this);
+}
+
+void Trace::push(Record const *records, size_t count) {
+    size_t pushed = ring.push(records, count);
+    if (pushed == count)
+        return;
+    stats.stalls += 1;
+    while (pushed < count) {
+        this_thread::yield();
+        pushed += ring.push(records + pushed, count - pushed);
+    }
+}
+
+template <typename Read>
+void Trace::sample_values(uint64_t time, Read const &read) {
+    if (closed)
+        throw runtime_error(path + " is closed");
+    if (!started)
+        start();
+    bool const first = (stats.samples == 0);
+    // The changes of a sample go to the ring at once. Every value is written
+    // and only a change is kept, about half of the nets change in a cycle,
+    // which a branch mispredicts.
+    batch[0] = {TIME, time};
+    size_t count = 1;
+    for (size_t i = 0; i < last.size(); ++i) {
+        uint64_t const value = read(i);
+        batch[count] = {static_cast<uint32_t>(i), value};
+        count += (value != last[i]) | first;
+        last[i] = value;
+    }
+    if (count > 1)
+        push(batch.data(), count);
+    stats.changes += count - 1;
+    stats.samples += 1;
+}
+
+void Trace::sample(uint64_t time) {
+    if (!signals.empty() && signals[0].net == nullptr)
+        throw runtime_error(path + " is a trace of a Simulator");
+    sample_values(time, [this](size_t i) {
+        return nets[i]->get_raw();
+    });
+}
+
+void Trace::sample(Simulator const &simulator) {
+    if (!signals.empty() && signals[0].net != nullptr)
+        throw runtime_error(path + " is a trace of nets");
+    uint64_t const *values = simulator.values.data();
+    sample_values(simulator.get_cycle(), [&](size_t i) {
+        return (values[fields[i].slot] >> fields[i].shift) & fields[i].mask;
+    });
+}
+
+void Trace::close() {
+    if (closed)
+        return;
+    closed = true;
+    if (!started)
+        start();
+    done.store(true, memory_order_release);
+    writer.detach(this);
+}
+
+TraceWriter::TraceWriter(): thread{[this]() { process(); }} {}
+
+TraceWriter::~TraceWriter() {
+    running = false;
+    thread.join();
+}
+
+void TraceWriter::attach(Trace *trace) {
+    trace->next_attached = attached.load(memory_order_relaxed);
+    while (!attached.compare_exchange_weak(trace->next_attached, trace, memory_order_release,
+            memory_order_relaxed)) {
+    }
+}
+
+void TraceWriter::detach(Trace *trace) {
+    unique_lock<mutex> lock{finished_mutex};
+    written.wait(lock, [&]() { return trace->finished; });
+}
+
+bool TraceWriter::write(Trace &trace) {
+    size_t const BATCH = 4096;
+    Trace::Record records[BATCH];
+    if (trace.waves) {
+        bool any = false;
+        size_t count;
+        while ((count = trace.ring.pop(records, BATCH)) > 0) {
+            any = true;
+            for (size_t r = 0; r < count; ++r) {
+                if (records[r].signal == Trace::TIME)
+                    trace.time = records[r].value;
+                else
+                    trace.waves->add_change(records[r].signal, trace.time, records[r].value);
+            }
+        }
+        return any;
+    }
+    // The longest line is a time of 20 digits or 64 bits and an id
+    text.resize(BATCH * 96);
+    bool any = false;
+    size_t count;
+    while ((count = trace.ring.pop(records, BATCH)) > 0) {
+        any = true;
+        char *out = text.data();
+        for (size_t r = 0; r < count; ++r) {
+            Trace::Record const &record = records[r];
+            if (record.signal == Trace::TIME) {
+                *out++ = '#';
+                out += snprintf(out, 24, "%llu", static_cast<unsigned long long>(record.value));
+                *out++ = '\n';
+                continue;
+            }
+            int const width = trace.signals[record.signal].width;
+            if (width == 1) {
+                *out++ = static_cast<char>('0' + (record.value & 1));
+            } else {
+                *out++ = 'b';
+                int bit = width - 1;
+                while (bit > 0 && ((record.value >> bit) & 1) == 0) {
+                    --bit;
+                }
+                for (; bit >= 0; --bit) {
+                    *out++ = static_cast<char>('0' + ((record.value >> bit) & 1));
+                }
+                *out++ = ' ';
+            }
+            string const &id = trace.ids[record.signal];
+            out = copy(id.begin(), id.end(), out);
+            *out++ = '\n';
+        }
+        fwrite(text.data(), 1, out - text.data(), trace.file);
+    }
+    return any;
+}
+
+void TraceWriter::process() {
+    while (running || !traces.empty() || attached.load(memory_order_acquire) != nullptr) {
+        // The stack has the newest first
+        list<Trace*> added{};
+        for (Trace *trace = attached.exchange(nullptr, memory_order_acquire); trace != nullptr;
+                trace = trace->next_attached) {
+            added.push_front(trace);
+        }
+        traces.splice(traces.end(), added);
+        bool busy = false;
+        for (auto it = traces.begin(); it != traces.end();) {
+            Trace &trace = **it;
+            // Everything pushed before done is drained below
+            bool const done = trace.done.load(memory_order_acquire) || !running;
+            busy = write(trace) || busy;
+            if (!done) {
+                ++it;
+                continue;
+            }
+            if (trace.waves) {
+                // The destructor closes it, a file which can not be written is left as it is
+                trace.waves.reset();
+            } else {
+                fclose(trace.file);
+                trace.file = nullptr;
+            }
+            it = traces.erase(it);
+            {
+                lock_guard<mutex> lock{finished_mutex};
+                trace.finished = true;
+            }
+            written.notify_all();
+            busy = true;
+        }
+        if (!busy)
+            this_thread::sleep_for(chrono::microseconds(500));
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+
+#include "wire.h"
+#include "program.h"
+#include "simulator.h"
+#include "spsc_ring.h"
+#include "wave_file.h"
+
+/* Waveforms in VCD, or in the compressed format of wave_file.h.
+ *
+ * A Trace samples a set of signals once per cycle, after Clock::clock() or
+ * Simulator::clock(), and queues the values which changed in a lock-free
+ * ring. A TraceWriter thread empties the rings of all its Traces, formats
+ * the changes and writes the files, so a slow disk only stalls the
+ * simulation when a ring fills up. Every thread running a simulation has its
+ * own Trace, and its own ring:
+ *
+ *   TraceWriter writer{};
+ *   Trace trace{writer, "run.vcd"};
+ *   trace.add(&wire);
+ *   for (...) {
+ *       clock.clock();
+ *       trace.sample(cycle);
+ *   }
+ *
+ * Signals are added before the first sample, either nets read through
+ * Net::get_raw() or locations in a Simulator. Traces must be closed or
+ * destroyed before their writer.
+ */
+
+class TraceWriter;
+
+enum class TraceFormat {
+    Vcd,
+    Waves,  // Read with MappedWaves
+};
+
+struct TraceStats {
+    uint64_t samples = 0;
+    uint64_t changes = 0;
+    uint64_t stalls = 0;  // Times the ring was full
+};
+
+class Trace {
+public:
+    Trace(TraceWriter &writer, std::string const &path, TraceFormat format=TraceFormat::Vcd,
+        size_t capacity=1 << 16);
+    Trace(Trace const &) = delete;
+    Trace &operator=(Trace const &) = delete;
+    ~Trace();
+
+    // A net of a design run by a Clock
+    void add(Net const *net);
+    // A value of a design run by a Simulator
+    void add(std::string const &name, int width, Location const &location);
+    void add(Simulator const &simulator, Net const *net);
+
+    // The values of the nets at time
+    void sample(uint64_t time);
+    // The values in the Simulator, at its cycle
+    void sample(Simulator const &simulator);
+
+    // Wait until everything is written and close the file
+    void close();
+
+    TraceStats const &get_stats() const { return stats; }
+
+private:
+    friend class TraceWriter;
+
+    struct Signal {
+        std::string name;
+        int width;
+        Net const *net;
+        Location location;
+    };
+    // A new value of a signal, or the time of the values after it
+    struct Record {
+        uint32_t signal;
+        uint64_t value;
+    };
+    // Where sample() finds a value in the slots of a Simulator
+    struct Field {
+        uint32_t slot;
+        uint32_t shift;
+        uint64_t mask;
+    };
+    static uint32_t const TIME = UINT32_MAX;
+
+    void add_signal(Signal const &signal);
+    void start();
+    void push(Record const *records, size_t count);
+    template <typename Read>
+    void sample_values(uint64_t time, Read const &read);
+
+    TraceWriter &writer;
+    std::string path;
+    TraceFormat format;
+    std::vector<Signal> signals{};
+    // What sample() reads, next to each other
+    std::vector<Net const*> nets{};
+    std::vector<Field> fields{};
+    std::vector<uint64_t> last{};
+    std::vector<Record> batch{};
+    bool started{false};
+    bool closed{false};
+    TraceStats stats{};
+
+    // Shared with the writer
+    FILE *file{nullptr};
+    std::vector<std::string> ids{};
+    std::unique_ptr<WaveWriter> waves{};
+    uint64_t time{0};  // Of the records being written
+    SpscRing<Record> ring;
+    std::atomic_bool done{false};
+    bool finished{false};       // Under the finished_mutex of the writer
+    Trace *next_attached{nullptr};  // In the attached list of the writer
+};
+
+class TraceWriter {
+public:
+    TraceWriter();
+    TraceWriter(TraceWriter const &) = delete;
+    TraceWriter &operator=(TraceWriter const &) = delete;
+    ~TraceWriter();
+
+private:
+    friend class Trace;
+
+    void attach(Trace *trace);
+    // Wait until the writer has written everything queued by trace
+    void detach(Trace *trace);
+    void process();
+    bool write(Trace &trace);
+
+    std::vector<char> text{};  // The VCD lines of a batch of records
+
+    // New traces, a lock-free stack, so the simulation never waits for a write
+    std::atomic<Trace*> attached{nullptr};
+    std::mutex finished_mutex{};
+    std::condition_variable written{};
+    std::list<Trace*> traces{};  // Of the writer thread
+    std::atomic_bool running{true};
+    std::thread thread;
+};
+
+#endif  // TRACE_H_
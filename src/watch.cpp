@@ -0,0 +1,244 @@
+#include <cctype>
+#include <stdexcept>
+
+#include "watch.h"
+
+using namespace std;
+
+// Recursive descent, with the steps in postfix order
+class Watch::Parser {
+public:
+    Parser(Watch &watch, unordered_map<string, WatchSignal> const &names):
+        watch{watch}, names{names}, text{watch.expression} {}
+
+    void parse() {
+        parse_or();
+        skip_spaces();
+        if (position != text.size())
+            fail("expected && or ||");
+        if (max_depth > 64)
+            throw runtime_error(text + ": the watch is nested too deep");
+    }
+
+private:
+    [[noreturn]] void fail(string const &what) const {
+        throw runtime_error(text + ": " + what + " at " + to_string(position));
+    }
+
+    void skip_spaces() {
+        while (position < text.size() && isspace(static_cast<unsigned char>(text[position]))) {
+            ++position;
+        }
+    }
+
+    bool accept(string const &token) {
+        skip_spaces();
+        if (text.compare(position, token.size(), token) != 0)
+            return false;
+        position += token.size();
+        return true;
+    }
+
+    void push(Step const &step) {
+        watch.steps.push_back(step);
+        if (step.compare != NO_SLOT)
+            max_depth = max(max_depth, ++depth);
+        else if (step.op != Op::Not)
+            --depth;
+    }
+
+    void parse_or() {
+        parse_and();
+        while (accept("||")) {
+            parse_and();
+            push({Op::Or, NO_SLOT});
+        }
+    }
+
+    void parse_and() {
+        parse_unary();
+        while (accept("&&")) {
+            parse_unary();
+            push({Op::And, NO_SLOT});
+        }
+    }
+
+    void parse_unary() {
+        if (accept("!")) {
+            parse_unary();
+            push({Op::Not, NO_SLOT});
+        } else if (accept("(")) {
+            parse_or();
+            if (!accept(")"))
+                fail("expected )");
+        } else {
+            parse_compare();
+        }
+    }
+
+    void parse_compare() {
+        Compare compare{Op::NotEqual, false, false, 0, 0};
+        parse_term(compare.left_signal, compare.left);
+        static pair<char const*, Op> const OPS[] = {
+            {"==", Op::Equal}, {"!=", Op::NotEqual}, {"<=", Op::LessEqual}, {">=", Op::GreaterEqual},
+            {"<", Op::Less}, {">", Op::Greater}};
+        bool found = false;
+        for (auto const &op : OPS) {
+            if (accept(op.first)) {
+                compare.op = op.second;
+                parse_term(compare.right_signal, compare.right);
+                found = true;
+                break;
+            }
+        }
+        // A term on its own is true when it is not 0
+        if (!found) {
+            compare.right_signal = false;
+            compare.right = 0;
+        }
+        watch.compares.push_back(compare);
+        push({compare.op, static_cast<uint32_t>(watch.compares.size() - 1)});
+    }
+
+    void parse_term(bool &is_signal, uint64_t &value) {
+        skip_spaces();
+        size_t const start = position;
+        if (position < text.size() && isdigit(static_cast<unsigned char>(text[position]))) {
+            int base = 10;
+            if (accept("0x")) {
+                base = 16;
+            } else if (accept("0b")) {
+                base = 2;
+            }
+            size_t const digits = position;
+            while (position < text.size() && isalnum(static_cast<unsigned char>(text[position]))) {
+                ++position;
+            }
+            try {
+                size_t used = 0;
+                value = stoull(text.substr(digits, position - digits), &used, base);
+                if (used != position - digits)
+                    throw invalid_argument("");
+            } catch (logic_error const &) {
+                position = start;
+                fail("expected a number");
+            }
+            is_signal = false;
+            return;
+        }
+        while (position < text.size() && (isalnum(static_cast<unsigned char>(text[position])) ||
+                text[position] == '_' || text[position] == '.')) {
+            ++position;
+        }
+        if (position == start)
+            fail("expected a name or a number");
+        string const name = text.substr(start, position - start);
+        auto signal = names.find(name);
+        if (signal == names.end()) {
+            position = start;
+            fail("unknown name " + name);
+        }
+        auto index = indices.find(name);
+        if (index == indices.end()) {
+            index = indices.emplace(name, watch.signals.size()).first;
+            watch.signals.push_back(signal->second);
+        }
+        is_signal = true;
+        value = index->second;
+    }
+
+    Watch &watch;
+    unordered_map<string, WatchSignal> const &names;
+    string const &text;
+    size_t position{0};
+    unordered_map<string, size_t> indices{};
+    int depth{0};
+    int max_depth{0};
+};
+
+Watch::Watch(string const &expression, unordered_map<string, WatchSignal> const &names):
+        expression{expression} {
+    Parser{*this, names}.parse();
+}
+
+bool Watch::evaluate(uint64_t const *values) const {
+    // The results, the last one in the lowest bit
+    uint64_t stack = 0;
+    for (Step const &step : steps) {
+        if (step.compare != NO_SLOT) {
+            Compare const &compare = compares[step.compare];
+            uint64_t const a = compare.left_signal ? values[compare.left] : compare.left;
+            uint64_t const b = compare.right_signal ? values[compare.right] : compare.right;
+            bool result = false;
+            switch (compare.op) {
+            case Op::Equal: result = (a == b); break;
+            case Op::NotEqual: result = (a != b); break;
+            case Op::Less: result = (a < b); break;
+            case Op::LessEqual: result = (a <= b); break;
+            case Op::Greater: result = (a > b); break;
+            case Op::GreaterEqual: result = (a >= b); break;
+            default: break;
+            }
+            stack = (stack << 1) | result;
+        } else if (step.op == Op::Not) {
+            stack ^= 1;
+        } else {
+            uint64_t const b = stack & 1;
+            stack >>= 1;
+            uint64_t const a = stack & 1;
+            stack = (stack & ~uint64_t{1}) | ((step.op == Op::And) ? (a & b) : (a | b));
+        }
+    }
+    return stack & 1;
+}
+
+WatchResult run_until(Simulator &simulator, Watch const &watch, uint64_t max_cycles) {
+    Program const &program = simulator.get_program();
+    vector<Location> locations{};
+    for (WatchSignal const &signal : watch.get_signals()) {
+        if (signal.net != nullptr) {
+            auto it = program.net_slots.find(signal.net);
+            if (it == program.net_slots.end())
+                throw runtime_error(signal.net->get_name() + " is not in the program");
+            locations.push_back(it->second);
+        } else {
+            auto it = program.state_slots.find(signal.clockable);
+            if (it == program.state_slots.end())
+                throw runtime_error(watch.get_expression() + ": a register is not in the program");
+            locations.push_back(it->second);
+        }
+    }
+
+    vector<uint64_t> values(locations.size());
+    WatchResult result{};
+    while (result.cycles < max_cycles) {
+        simulator.clock();
+        ++result.cycles;
+        for (size_t i = 0; i < locations.size(); ++i) {
+            values[i] = simulator.read(locations[i]);
+        }
+        if (watch.evaluate(values.data())) {
+            result.hit = true;
+            break;
+        }
+    }
+    return result;
+}
+
+WatchResult run_until(Clock &clock, Watch const &watch, uint64_t max_cycles) {
+    vector<WatchSignal> const &signals = watch.get_signals();
+    vector<uint64_t> values(signals.size());
+    WatchResult result{};
+    while (result.cycles < max_cycles) {
+        clock.clock();
+        ++result.cycles;
+        for (size_t i = 0; i < signals.size(); ++i) {
+            values[i] = signals[i].net ? signals[i].net->get_raw() : signals[i].clockable->get_raw_state();
+        }
+        if (watch.evaluate(values.data())) {
+            result.hit = true;
+            break;
+        }
+    }
+    return result;
+}
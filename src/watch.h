@@ -0,0 +1,83 @@
+#ifndef WATCH_H_
+#define WATCH_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "wire.h"
+#include "clockable.h"
+#include "program.h"
+#include "simulator.h"
+#include "clock.h"
+
+/* Watchpoints, conditions over nets and registers which stop a run at the
+ * first cycle they hold:
+ *
+ *   Watch watch{"r0 == 0x42 && w5 == 1", {{"r0", &r0}, {"w5", &w5}}};
+ *   WatchResult result = run_until(simulator, watch, 1000000);
+ *
+ * An expression compares names and numbers with == != < <= > >=, a name on
+ * its own is true when it is not 0, and conditions are combined with &&, ||,
+ * ! and parentheses. Numbers are decimal, 0x hexadecimal or 0b binary.
+ *
+ * The expression is compiled to a short program over the values of its
+ * signals, which run_until() executes after every cycle, so the caller is
+ * only back when the watch hits or the cycles run out. As after clock(),
+ * every net has the value of the cycle, the net driven by a register as well,
+ * and registers the next state, in a Simulator as on a Clock.
+ */
+
+// A net or a register
+struct WatchSignal {
+    WatchSignal(Net const *net): net{net} {}
+    WatchSignal(Clockable const *clockable): clockable{clockable} {}
+
+    Net const *net = nullptr;
+    Clockable const *clockable = nullptr;
+};
+
+struct WatchResult {
+    bool hit = false;
+    uint64_t cycles = 0;  // Run, including the one the watch hit in
+};
+
+class Watch {
+public:
+    Watch(std::string const &expression, std::unordered_map<std::string, WatchSignal> const &names);
+
+    // With the values of the signals, in the order of get_signals()
+    bool evaluate(uint64_t const *values) const;
+    std::vector<WatchSignal> const &get_signals() const { return signals; }
+    std::string const &get_expression() const { return expression; }
+
+private:
+    enum class Op : uint8_t { Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual, And, Or, Not };
+    // A comparison of two terms, each a signal or a constant
+    struct Compare {
+        Op op;
+        bool left_signal;
+        bool right_signal;
+        uint64_t left;   // Index into the signals, or the constant
+        uint64_t right;
+    };
+    // Postfix, a compare pushes its result, the others combine the results
+    struct Step {
+        Op op;
+        uint32_t compare;  // NO_SLOT unless a compare
+    };
+    class Parser;
+    friend class AssertionSet;
+
+    std::string expression;
+    std::vector<WatchSignal> signals{};
+    std::vector<Compare> compares{};
+    std::vector<Step> steps{};
+};
+
+// Run until the watch holds after a cycle, for at most max_cycles
+WatchResult run_until(Simulator &simulator, Watch const &watch, uint64_t max_cycles);
+WatchResult run_until(Clock &clock, Watch const &watch, uint64_t max_cycles);
+
+#endif  // WATCH_H_
@@ -0,0 +1,444 @@
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wave_file.h"
+#include "parallel.h"
+#include "bit_vector.h"
+
+using namespace std;
+
+namespace {
+
+char const MAGIC[8] = {'H', 'W', 'W', 'A', 'V', 'E', 'S', '\0'};
+uint32_t const VERSION = 1;
+
+enum ValueCoding : uint8_t { Dictionary, Changes };
+
+// True if [first, first + count) is in [0, size)
+bool in_range(uint64_t first, uint64_t count, uint64_t size) {
+    return first <= size && count <= size - first;
+}
+
+// The most bytes encode() makes of a block of a signal of width bits: the
+// count, a time delta per change and the values, in a full dictionary or
+// as changes. A varint of 64 bits is 10 bytes.
+size_t max_block_bytes(uint32_t width) {
+    size_t const changes = WaveWriter::BLOCK_CHANGES;
+    size_t const value = (width + 6) / 7;
+    return 10 + changes * 10 + 1 + max(3 + 256 * value + changes, changes * value);
+}
+
+void put_varint(vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Reads from a buffer which may be broken
+class Cursor {
+public:
+    Cursor(uint8_t const *begin, size_t size): position{begin}, end{begin + size} {}
+
+    uint8_t byte() {
+        if (position == end)
+            throw runtime_error("A wave block is broken");
+        return *position++;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t const b = byte();
+            value |= uint64_t{b & 0x7fu} << shift;
+            if ((b & 0x80) == 0)
+                return value;
+        }
+        throw runtime_error("A wave block is broken");
+    }
+
+    uint8_t const *take(size_t count) {
+        if (static_cast<size_t>(end - position) < count)
+            throw runtime_error("A wave block is broken");
+        uint8_t const *taken = position;
+        position += count;
+        return taken;
+    }
+
+private:
+    uint8_t const *position;
+    uint8_t const *end;
+};
+
+/* LZ77 in sequences of: a varint count of literals, the literals, a varint
+ * length of a match and a varint distance back to it. A match of length 0
+ * ends the data. Matches are found through a hash of the next four bytes.
+ */
+vector<uint8_t> lz_compress(vector<uint8_t> const &in) {
+    size_t const MIN_MATCH = 4;
+    size_t const HASH_BITS = 12;
+    vector<uint32_t> table(size_t{1} << HASH_BITS, UINT32_MAX);
+    auto read32 = [&](size_t i) {
+        uint32_t word;
+        memcpy(&word, &in[i], sizeof(word));
+        return word;
+    };
+
+    vector<uint8_t> out{};
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + MIN_MATCH <= in.size()) {
+        uint32_t const word = read32(i);
+        uint32_t const hash = (word * 2654435761u) >> (32 - HASH_BITS);
+        size_t const candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(i);
+        if (candidate == UINT32_MAX || read32(candidate) != word) {
+            ++i;
+            continue;
+        }
+        size_t length = MIN_MATCH;
+        while (i + length < in.size() && in[candidate + length] == in[i + length]) {
+            ++length;
+        }
+        put_varint(out, i - anchor);
+        out.insert(out.end(), in.begin() + anchor, in.begin() + i);
+        put_varint(out, length);
+        put_varint(out, i - candidate);
+        i += length;
+        anchor = i;
+    }
+    put_varint(out, in.size() - anchor);
+    out.insert(out.end(), in.begin() + anchor, in.end());
+    put_varint(out, 0);
+    return out;
+}
+
+vector<uint8_t> lz_decompress(uint8_t const *in, size_t size, size_t raw_size) {
+    vector<uint8_t> out(raw_size);
+    size_t length = 0;
+    Cursor cursor{in, size};
+    while (true) {
+        uint64_t const literals = cursor.varint();
+        if (literals > raw_size - length)
+            throw runtime_error("A wave block is broken");
+        memcpy(out.data() + length, cursor.take(literals), literals);
+        length += literals;
+        uint64_t const match = cursor.varint();
+        if (match == 0)
+            break;
+        uint64_t const distance = cursor.varint();
+        if (distance == 0 || distance > length || match > raw_size - length)
+            throw runtime_error("A wave block is broken");
+        // The match may overlap the bytes it makes
+        uint8_t *to = out.data() + length;
+        uint8_t const *from = to - distance;
+        for (uint64_t k = 0; k < match; ++k) {
+            to[k] = from[k];
+        }
+        length += match;
+    }
+    if (length != raw_size)
+        throw runtime_error("A wave block is broken");
+    return out;
+}
+
+vector<uint8_t> encode(vector<uint64_t> const &times, vector<uint64_t> const &values) {
+    vector<uint8_t> out{};
+    put_varint(out, times.size());
+    for (size_t i = 0; i < times.size(); ++i) {
+        put_varint(out, times[i] - ((i == 0) ? times[0] : times[i - 1]));
+    }
+
+    unordered_map<uint64_t, uint8_t> dictionary{};
+    vector<uint64_t> entries{};
+    for (uint64_t value : values) {
+        if (dictionary.size() > 256)
+            break;
+        if (dictionary.emplace(value, static_cast<uint8_t>(entries.size())).second)
+            entries.push_back(value);
+    }
+    if (entries.size() <= 256) {
+        out.push_back(Dictionary);
+        put_varint(out, entries.size());
+        for (uint64_t entry : entries) {
+            put_varint(out, entry);
+        }
+        for (uint64_t value : values) {
+            out.push_back(dictionary[value]);
+        }
+    } else {
+        out.push_back(Changes);
+        uint64_t previous = 0;
+        for (uint64_t value : values) {
+            put_varint(out, value ^ previous);
+            previous = value;
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+WaveWriter::WaveWriter(string const &path, unsigned threads):
+        path{path}, threads{resolve_threads(threads)} {
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        throw runtime_error(path + ": can not be written");
+    // The header is written again by close()
+    WaveFileHeader const header{};
+    fwrite(&header, sizeof(header), 1, file);
+    offset = sizeof(header);
+}
+
+WaveWriter::~WaveWriter() {
+    try {
+        close();
+    } catch (runtime_error const &) {
+        // Nothing more can be done about a file which can not be written
+    }
+}
+
+uint32_t WaveWriter::add_signal(string const &name, int width) {
+    if (stats.changes > 0)
+        throw runtime_error(name + ": signals are added before the first change in " + path);
+    if (width < 1 || width > 64)
+        throw runtime_error(name + ": a signal is 1 to 64 bits");
+    signals.push_back({static_cast<uint32_t>(width), 0, 0, names.size(), name.size()});
+    names += name;
+    uint32_t const signal = static_cast<uint32_t>(signals.size() - 1);
+    open_blocks.push_back({signal, {}, {}});
+    blocks.emplace_back();
+    return signal;
+}
+
+void WaveWriter::add_change(uint32_t signal, uint64_t time, uint64_t value) {
+    Pending &block = open_blocks.at(signal);
+    // A reader relies on the width to bound the size of a block
+    value &= width_mask(signals[signal].width);
+    if (!block.times.empty() && time <= block.times.back()) {
+        if (time < block.times.back())
+            throw runtime_error(path + ": the changes of a signal go back in time");
+        block.values.back() = value;
+        return;
+    }
+    block.times.push_back(time);
+    block.values.push_back(value);
+    stats.changes += 1;
+    if (block.times.size() < BLOCK_CHANGES)
+        return;
+    full_blocks.push_back(std::move(block));
+    block = Pending{signal, {}, {}};
+    if (full_blocks.size() >= 4 * threads)
+        write_blocks();
+}
+
+void WaveWriter::write_blocks() {
+    vector<vector<uint8_t>> raw(full_blocks.size());
+    vector<vector<uint8_t>> compressed(full_blocks.size());
+    parallel_tasks(full_blocks.size(), threads, [&](size_t i) {
+        raw[i] = encode(full_blocks[i].times, full_blocks[i].values);
+        compressed[i] = lz_compress(raw[i]);
+    });
+    for (size_t i = 0; i < full_blocks.size(); ++i) {
+        Pending const &block = full_blocks[i];
+        fwrite(compressed[i].data(), 1, compressed[i].size(), file);
+        blocks[block.signal].push_back({block.times.front(), block.times.back(), offset,
+            static_cast<uint32_t>(compressed[i].size()), static_cast<uint32_t>(raw[i].size())});
+        offset += compressed[i].size();
+        stats.blocks += 1;
+        stats.raw_bytes += 16 * block.times.size();
+    }
+    full_blocks.clear();
+}
+
+void WaveWriter::close() {
+    if (closed)
+        return;
+    closed = true;
+    for (Pending &block : open_blocks) {
+        if (!block.times.empty())
+            full_blocks.push_back(std::move(block));
+    }
+    open_blocks.clear();
+    write_blocks();
+
+    // The index, the signals and the names, 8 byte aligned
+    char const zeros[8] = {};
+    fwrite(zeros, 1, (8 - offset % 8) % 8, file);
+    offset += (8 - offset % 8) % 8;
+    WaveFileHeader header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.signal_count = static_cast<uint32_t>(signals.size());
+    header.index_offset = offset;
+    for (size_t signal = 0; signal < signals.size(); ++signal) {
+        signals[signal].first_block = header.block_count;
+        signals[signal].block_count = static_cast<uint32_t>(blocks[signal].size());
+        fwrite(blocks[signal].data(), sizeof(WaveBlock), blocks[signal].size(), file);
+        header.block_count += blocks[signal].size();
+    }
+    header.signals_offset = header.index_offset + header.block_count * sizeof(WaveBlock);
+    fwrite(signals.data(), sizeof(WaveSignal), signals.size(), file);
+    header.names_offset = header.signals_offset + signals.size() * sizeof(WaveSignal);
+    header.names_size = names.size();
+    fwrite(names.data(), 1, names.size(), file);
+    stats.compressed_bytes = header.names_offset + names.size();
+
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    bool const failed = ferror(file) != 0;
+    fclose(file);
+    file = nullptr;
+    if (failed)
+        throw runtime_error(path + ": could not be written");
+}
+
+MappedWaves::MappedWaves(string const &path): path{path} {
+    int const fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error(path + ": can not be opened");
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(WaveFileHeader)) {
+        close(fd);
+        throw runtime_error(path + " is not a wave file");
+    }
+    size = info.st_size;
+    data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+        throw runtime_error(path + ": can not be mapped");
+    }
+
+    char const *bytes = static_cast<char const*>(data);
+    header = reinterpret_cast<WaveFileHeader const*>(bytes);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION) {
+        munmap(data, size);
+        throw runtime_error(path + " is not a wave file of this version");
+    }
+    // The counts are not trusted, the index and the signals are 8 byte aligned
+    if (header->index_offset % 8 != 0 || header->signals_offset % 8 != 0 ||
+            header->block_count > size / sizeof(WaveBlock) ||
+            !in_range(header->index_offset, header->block_count * sizeof(WaveBlock), size) ||
+            !in_range(header->signals_offset, uint64_t{header->signal_count} * sizeof(WaveSignal), size) ||
+            !in_range(header->names_offset, header->names_size, size)) {
+        munmap(data, size);
+        throw runtime_error(path + " is truncated");
+    }
+    index = reinterpret_cast<WaveBlock const*>(bytes + header->index_offset);
+    signals = reinterpret_cast<WaveSignal const*>(bytes + header->signals_offset);
+    names = bytes + header->names_offset;
+    for (uint32_t signal = 0; signal < header->signal_count; ++signal) {
+        WaveSignal const &entry = signals[signal];
+        if (entry.width == 0 || entry.width > 64 ||
+                !in_range(entry.first_block, entry.block_count, header->block_count) ||
+                !in_range(entry.name_offset, entry.name_size, header->names_size)) {
+            munmap(data, size);
+            throw runtime_error(path + " has a broken signal " + to_string(signal));
+        }
+    }
+}
+
+MappedWaves::~MappedWaves() {
+    if (data != nullptr)
+        munmap(data, size);
+}
+
+string MappedWaves::get_name(uint32_t signal) const {
+    return string(names + signals[signal].name_offset, signals[signal].name_size);
+}
+
+uint32_t MappedWaves::find(string const &name) const {
+    for (uint32_t signal = 0; signal < header->signal_count; ++signal) {
+        if (name.compare(0, string::npos, names + signals[signal].name_offset, signals[signal].name_size) == 0)
+            return signal;
+    }
+    throw runtime_error(name + " is not in " + path);
+}
+
+void MappedWaves::decode(uint64_t block, uint32_t width, vector<uint64_t> &block_times,
+        vector<uint64_t> &block_values) const {
+    WaveBlock const &entry = index[block];
+    if (!in_range(entry.offset, entry.size, size))
+        throw runtime_error(path + " is truncated");
+    // Before the size is allocated
+    if (entry.raw_size > max_block_bytes(width))
+        throw runtime_error(path + " has a broken block");
+    vector<uint8_t> const raw = lz_decompress(static_cast<uint8_t const*>(data) + entry.offset,
+        entry.size, entry.raw_size);
+    Cursor cursor{raw.data(), raw.size()};
+    // Every change takes a byte at least
+    size_t const count = cursor.varint();
+    if (count == 0 || count > raw.size())
+        throw runtime_error(path + " has a broken block");
+    block_times.resize(count);
+    block_values.resize(count);
+    uint64_t time = entry.first_time;
+    for (size_t i = 0; i < count; ++i) {
+        time += cursor.varint();
+        block_times[i] = time;
+    }
+    if (cursor.byte() == Dictionary) {
+        vector<uint64_t> entries(cursor.varint());
+        for (uint64_t &value : entries) {
+            value = cursor.varint();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t const entry_index = cursor.byte();
+            if (entry_index >= entries.size())
+                throw runtime_error(path + " has a broken block");
+            block_values[i] = entries[entry_index];
+        }
+    } else {
+        uint64_t previous = 0;
+        for (size_t i = 0; i < count; ++i) {
+            previous ^= cursor.varint();
+            block_values[i] = previous;
+        }
+    }
+}
+
+uint64_t MappedWaves::get_value(uint32_t signal, uint64_t time) const {
+    if (signal >= header->signal_count)
+        throw runtime_error(path + " has no signal " + to_string(signal));
+    WaveBlock const *first = index + signals[signal].first_block;
+    WaveBlock const *last = first + signals[signal].block_count;
+    // The last block which starts at or before time
+    WaveBlock const *block = upper_bound(first, last, time, [](uint64_t t, WaveBlock const &b) {
+        return t < b.first_time;
+    });
+    if (block == first)
+        throw runtime_error(get_name(signal) + " has no value at " + to_string(time));
+    --block;
+    if (static_cast<uint64_t>(block - index) != decoded) {
+        decoded = UINT64_MAX;
+        decode(block - index, signals[signal].width, times, values);
+        decoded = block - index;
+    }
+    size_t const i = upper_bound(times.begin(), times.end(), time) - times.begin();
+    return values[i - 1];
+}
+
+vector<pair<uint64_t, uint64_t>> MappedWaves::get_changes(uint32_t signal) const {
+    if (signal >= header->signal_count)
+        throw runtime_error(path + " has no signal " + to_string(signal));
+    vector<pair<uint64_t, uint64_t>> changes{};
+    vector<uint64_t> block_times{};
+    vector<uint64_t> block_values{};
+    uint64_t const first = signals[signal].first_block;
+    for (uint64_t block = first; block < first + signals[signal].block_count; ++block) {
+        decode(block, signals[signal].width, block_times, block_values);
+        for (size_t i = 0; i < block_times.size(); ++i) {
+            changes.emplace_back(block_times[i], block_values[i]);
+        }
+    }
+    return changes;
+}
@@ -0,0 +1,141 @@
+#ifndef WAVE_FILE_H_
+#define WAVE_FILE_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdio>
+#include <cstdint>
+
+/* A compressed binary format for waveforms, with random access.
+ *
+ * The changes of each signal are stored in blocks of up to BLOCK_CHANGES
+ * changes. A block holds the times as varint deltas and the values either as
+ * indices into a dictionary of the values in the block, or as varints of the
+ * bits which changed, and the whole block is compressed with a small LZ77
+ * coder. An index of the blocks of every signal, with their first and last
+ * times, follows the blocks, so the value of a signal at any time is found by
+ * a binary search in the index and one block decoded.
+ *
+ * The WaveWriter compresses the full blocks of different signals on several
+ * threads. MappedWaves maps a file to read it, from one thread at a time if
+ * get_value() is used:
+ *
+ *   MappedWaves waves{"run.waves"};
+ *   uint64_t value = waves.get_value(waves.find("Q"), 1000);
+ */
+
+struct WaveFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t signal_count;
+    uint64_t block_count;
+    uint64_t index_offset;    // WaveBlock[block_count], by signal and time
+    uint64_t signals_offset;  // WaveSignal[signal_count]
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+
+struct WaveBlock {
+    uint64_t first_time;
+    uint64_t last_time;
+    uint64_t offset;
+    uint32_t size;       // Compressed
+    uint32_t raw_size;
+};
+
+struct WaveSignal {
+    uint32_t width;
+    uint32_t block_count;
+    uint64_t first_block;
+    uint64_t name_offset;
+    uint64_t name_size;
+};
+
+struct WaveStats {
+    uint64_t changes = 0;
+    uint64_t blocks = 0;
+    uint64_t raw_bytes = 0;         // 16 bytes per change
+    uint64_t compressed_bytes = 0;  // The whole file
+};
+
+class WaveWriter {
+public:
+    static size_t const BLOCK_CHANGES = 1024;
+
+    // 0 threads is one per core
+    WaveWriter(std::string const &path, unsigned threads=0);
+    WaveWriter(WaveWriter const &) = delete;
+    WaveWriter &operator=(WaveWriter const &) = delete;
+    ~WaveWriter();
+
+    // Signals of 1 to 64 bits are added before any change
+    uint32_t add_signal(std::string const &name, int width);
+    // The times of the changes of a signal must not decrease, values are cut
+    // to the width of the signal
+    void add_change(uint32_t signal, uint64_t time, uint64_t value);
+    // Write the blocks left, the index and the names
+    void close();
+
+    WaveStats const &get_stats() const { return stats; }
+
+private:
+    struct Pending {
+        uint32_t signal;
+        std::vector<uint64_t> times;
+        std::vector<uint64_t> values;
+    };
+
+    void write_blocks();
+
+    std::string path;
+    unsigned threads;
+    FILE *file{nullptr};
+    uint64_t offset{0};
+    std::vector<WaveSignal> signals{};
+    std::string names{};
+    std::vector<Pending> open_blocks{};
+    std::vector<Pending> full_blocks{};
+    std::vector<std::vector<WaveBlock>> blocks{};  // Written blocks of every signal
+    WaveStats stats{};
+    bool closed{false};
+};
+
+class MappedWaves {
+public:
+    MappedWaves(std::string const &path);
+    MappedWaves(MappedWaves const &) = delete;
+    MappedWaves &operator=(MappedWaves const &) = delete;
+    ~MappedWaves();
+
+    uint32_t get_signal_count() const { return header->signal_count; }
+    std::string get_name(uint32_t signal) const;
+    int get_width(uint32_t signal) const { return signals[signal].width; }
+    // The signal with a name, throws if there is none
+    uint32_t find(std::string const &name) const;
+
+    // The value of a signal at time, throws if it has none yet. It keeps the
+    // last block it decoded, so it is called from one thread at a time.
+    uint64_t get_value(uint32_t signal, uint64_t time) const;
+    // Every change of a signal, as (time, value), from any number of threads
+    std::vector<std::pair<uint64_t, uint64_t>> get_changes(uint32_t signal) const;
+
+private:
+    // The times and values of a block of a signal of width bits
+    void decode(uint64_t block, uint32_t width, std::vector<uint64_t> &block_times,
+        std::vector<uint64_t> &block_values) const;
+
+    std::string path;
+    void *data{nullptr};
+    size_t size{0};
+    WaveFileHeader const *header{nullptr};
+    WaveBlock const *index{nullptr};
+    WaveSignal const *signals{nullptr};
+    char const *names{nullptr};
+    // The last block decoded by get_value()
+    mutable uint64_t decoded{UINT64_MAX};
+    mutable std::vector<uint64_t> times{};
+    mutable std::vector<uint64_t> values{};
+};
+
+#endif  // WAVE_FILE_H_
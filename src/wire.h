@@ -2,18 +2,46 @@
 #define WIRE_H_
 
 #include <list>
+#include <vector>
+#include <memory>
 #include <cassert>
 
 #include "component.h"
 #include "input_port.h"
 #include "bit_vector.h"
 
+/* Net is the width independent view of a Wire, see Port in input_port.h. */
+class Net : public Entity {
+public:
+    Net(std::string const &name="Net"): Entity(name) {}
+    virtual int get_width() const = 0;
+    virtual std::vector<Port*> get_targets() const = 0;
+    virtual void add_target(Port *port) = 0;
+    virtual void remove_target(Port *port) = 0;
+
+    // The value the wire was last set to
+    virtual uint64_t get_raw() const = 0;
+    virtual void set_raw(uint64_t val) = 0;
+
+    // Make a new InputPort or Wire of the same width as this net
+    virtual std::unique_ptr<Port> make_port(Component *parent, std::string const &name) const = 0;
+    virtual std::unique_ptr<Net> make_wire(std::string const &name) const = 0;
+
+    // Move all targets of this net to other
+    void move_targets(Net *other) {
+        for (Port *port : get_targets()) {
+            remove_target(port);
+            other->add_target(port);
+        }
+    }
+};
+
 template <int N>
-class Wire : public Entity {
+class Wire : public Net {
 public:
-    Wire(std::string const &name="Wire"): Entity(name), target_list{} {};
-    Wire(InputPort<N> *target, std::string const &name="Wire"): Entity(name), target_list{target} {}
-    Wire(std::initializer_list<InputPort<N>*> lst, std::string const &name="Wire"): Entity(name), target_list{lst} {}
+    Wire(std::string const &name="Wire"): Net(name), target_list{} {};
+    Wire(InputPort<N> *target, std::string const &name="Wire"): Net(name), target_list{target} {}
+    Wire(std::initializer_list<InputPort<N>*> lst, std::string const &name="Wire"): Net(name), target_list{lst} {}
 
     void add_targets(InputPort<N>* item) {
         target_list.push_back(item);
@@ -32,7 +60,7 @@ public:
         }
     }
 
-    int get_width() const { return N; }
+    int get_width() const override { return N; }
 
     void set(BitVector<N> val) {
         //std::cout << "Setting " << name << "=" << val<< std::endl;
@@ -40,7 +68,7 @@ public:
             throw std::runtime_error(name + " has alredy been set");
         }
         is_set = true;
-        BitVector<N> value = val & MASK;
+        value = val & MASK;
         if (val != value) {
             std::cout << "Warning: wire not wide enough for value" << std::endl;
         }
@@ -51,11 +79,37 @@ public:
         }
     }
 
+    BitVector<N> get_value() const { return value; }
+
+    std::vector<Port*> get_targets() const override {
+        return std::vector<Port*>(target_list.begin(), target_list.end());
+    }
+    void add_target(Port *port) override {
+        if (port->get_width() != N) {
+            throw std::runtime_error(port->get_name() + " does not have the same width as " + name);
+        }
+        target_list.push_back(static_cast<InputPort<N>*>(port));
+    }
+    void remove_target(Port *port) override {
+        if (port->get_width() == N)
+            target_list.remove(static_cast<InputPort<N>*>(port));
+    }
+
+    uint64_t get_raw() const override { return value.get_value(); }
+    void set_raw(uint64_t val) override { set(BitVector<N>{static_cast<T<N>>(val)}); }
+
+    std::unique_ptr<Port> make_port(Component *parent, std::string const &name) const override {
+        return std::make_unique<InputPort<N>>(parent, name);
+    }
+    std::unique_ptr<Net> make_wire(std::string const &name) const override {
+        return std::make_unique<Wire<N>>(name);
+    }
+
 private:
     bool is_set = false;
-    BitVector<N> const MASK = static_cast<BitVector<N>>((1 << N) - 1);
+    BitVector<N> value{};
+    BitVector<N> const MASK{bitmask<N>()};
     std::list<InputPort<N>*> target_list;
 };
 
 #endif  // WIRE_H_
-
@@ -0,0 +1,789 @@
+#include <map>
+#include <tuple>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "word_lifting.h"
+
+using namespace std;
+
+namespace {
+
+bool is_bitwise(Opcode opcode) {
+    switch (opcode) {
+    case Opcode::Not:
+    case Opcode::And:
+    case Opcode::Nand:
+    case Opcode::Or:
+    case Opcode::Xor:
+    case Opcode::Nor:
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint64_t pair_key(uint32_t a, uint32_t b) {
+    return (uint64_t{min(a, b)} << 32) | max(a, b);
+}
+
+// One bit of a ripple carry adder
+struct Cell {
+    uint32_t a{}, b{};
+    uint32_t cin{};    // NO_SLOT for a half adder
+    uint32_t sum{};
+    uint32_t carry{};  // NO_SLOT if the carry is not used
+    vector<int> instructions{};  // Replaced by the lifted adder, a half
+                                 // adder keeps its a ^ b
+    int carry_reads{1};          // How often the cell reads cin
+};
+
+class Lifter {
+public:
+    Lifter(Program &program, LiftOptions const &options, LiftStats &stats):
+        program{program}, options{options}, stats{stats} {}
+    void run();
+
+private:
+    void init();
+    void compact();
+    void count_uses();
+    uint32_t new_slot(int width, uint64_t value=0);
+    uint32_t resolve(uint32_t slot) const;
+    Instruction const *live_writer(uint32_t slot) const;
+    // The word a bit was extracted from, or the given word if it is known to
+    // hold the bit as well
+    bool get_bit(uint32_t slot, Location &bit, uint32_t word=NO_SLOT) const;
+    bool is_constant(uint32_t slot) const;
+    bool is_free_register(uint32_t slot) const;
+
+    void add(Instruction const &ins);
+    void remove(int index);
+    uint32_t pack(vector<uint32_t> const &bits);
+    void extract(uint32_t out, uint32_t word, int bit);
+    uint32_t word_operation(Opcode opcode, int width, uint32_t a, uint32_t b);
+
+    bool merge_duplicates();
+    bool lift_adders();
+    bool fold_packs();
+    uint32_t new_register(vector<uint32_t> const &bits, unordered_map<uint32_t, size_t> &latch_of);
+    bool pack_registers();
+    bool lift_bitwise();
+    bool seed_registers();
+    void lift_reductions();
+    void remap(Location &location) const;
+
+    Program &program;
+    LiftOptions const &options;
+    LiftStats &stats;
+
+    vector<int> writer{};
+    vector<bool> dead{};
+    vector<uint32_t> alias{};
+    vector<bool> state{};
+    vector<bool> input{};  // Written by the Simulator, not constant
+    vector<int> uses{};
+    vector<bool> removed_latch{};
+    vector<bool> produced{};
+    unordered_map<uint32_t, Location> extracted{};
+    unordered_map<uint32_t, Location> equal{};  // Bits also found in a word
+};
+
+void Lifter::init() {
+    size_t const slots = program.initial.size();
+    writer.assign(slots, -1);
+    alias.resize(slots);
+    for (size_t i = 0; i < slots; ++i) {
+        alias[i] = i;
+    }
+    state.assign(slots, false);
+    dead.assign(program.code.size(), false);
+    removed_latch.assign(program.latches.size(), false);
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        for (uint32_t slot : writes(program, program.code[i])) {
+            writer[slot] = i;
+        }
+    }
+    for (Latch const &latch : program.latches) {
+        state[latch.state] = true;
+    }
+    input.assign(slots, false);
+    for (InputSlot const &in : program.inputs) {
+        input[in.slot] = true;
+    }
+}
+
+// Apply the aliases and drop what was removed
+void Lifter::compact() {
+    vector<Instruction> code{};
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        if (dead[i])
+            continue;
+        Instruction ins = program.code[i];
+        switch (ins.opcode) {
+        case Opcode::Call:
+            for (uint32_t &slot : program.calls[ins.a].in) {
+                slot = resolve(slot);
+            }
+            break;
+        case Opcode::Pack:
+            for (uint32_t j = 0; j < ins.b; ++j) {
+                program.operands[ins.a + j] = resolve(program.operands[ins.a + j]);
+            }
+            break;
+        case Opcode::Gather:
+            for (uint32_t j = 0; j < ins.b; ++j) {
+                program.terms[ins.a + j].slot = resolve(program.terms[ins.a + j].slot);
+            }
+            break;
+        case Opcode::Extract:
+            ins.a = resolve(ins.a);
+            break;
+        case Opcode::Lut:
+            ins.a = resolve(ins.a);
+            ins.b = resolve(ins.b);
+            break;
+        default:
+            ins.a = resolve(ins.a);
+            ins.b = resolve(ins.b);
+            ins.c = resolve(ins.c);
+        }
+        code.push_back(ins);
+    }
+    program.code = code;
+
+    vector<Latch> latches{};
+    for (size_t i = 0; i < program.latches.size(); ++i) {
+        if (!removed_latch[i])
+            latches.push_back({program.latches[i].state, resolve(program.latches[i].next)});
+    }
+    program.latches = latches;
+
+    for (auto &entry : program.net_slots) {
+        entry.second.slot = resolve(entry.second.slot);
+    }
+    for (auto &entry : program.sink_slots) {
+        entry.second.slot = resolve(entry.second.slot);
+    }
+    sort_code(program);
+    init();
+}
+
+void Lifter::count_uses() {
+    uses.assign(program.initial.size(), 0);
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        if (dead[i])
+            continue;
+        for (uint32_t slot : reads(program, program.code[i])) {
+            uses[resolve(slot)] += 1;
+        }
+    }
+    for (size_t i = 0; i < program.latches.size(); ++i) {
+        if (!removed_latch[i])
+            uses[resolve(program.latches[i].next)] += 1;
+    }
+    for (auto const &sink : program.sink_slots) {
+        uses[resolve(sink.second.slot)] += 1;
+    }
+}
+
+uint32_t Lifter::new_slot(int width, uint64_t value) {
+    uint32_t const slot = program.add_slot(width, value);
+    writer.push_back(-1);
+    alias.push_back(slot);
+    state.push_back(false);
+    input.push_back(false);
+    uses.push_back(0);
+    produced.push_back(false);
+    return slot;
+}
+
+uint32_t Lifter::resolve(uint32_t slot) const {
+    while (alias[slot] != slot) {
+        slot = alias[slot];
+    }
+    return slot;
+}
+
+Instruction const *Lifter::live_writer(uint32_t slot) const {
+    int const index = writer[slot];
+    if (index < 0 || dead[index])
+        return nullptr;
+    return &program.code[index];
+}
+
+bool Lifter::get_bit(uint32_t slot, Location &bit, uint32_t word) const {
+    auto it = equal.find(slot);
+    if (it != equal.end() && it->second.slot == word) {
+        bit = it->second;
+        return true;
+    }
+    Instruction const *ins = live_writer(slot);
+    if (ins == nullptr || ins->opcode != Opcode::Extract)
+        return false;
+    bit = {resolve(ins->a), static_cast<uint8_t>(ins->b), 1};
+    return true;
+}
+
+bool Lifter::is_constant(uint32_t slot) const {
+    return writer[slot] < 0 && !state[slot] && !input[slot];
+}
+
+// A 1 bit register which has not been packed yet
+bool Lifter::is_free_register(uint32_t slot) const {
+    return state[slot] && program.widths[slot] == 1;
+}
+
+void Lifter::add(Instruction const &ins) {
+    program.code.push_back(ins);
+    dead.push_back(false);
+    for (uint32_t slot : writes(program, ins)) {
+        writer[slot] = program.code.size() - 1;
+    }
+}
+
+void Lifter::remove(int index) {
+    dead[index] = true;
+    for (uint32_t slot : writes(program, program.code[index])) {
+        if (writer[slot] == index)
+            writer[slot] = -1;
+    }
+}
+
+uint32_t Lifter::pack(vector<uint32_t> const &bits) {
+    uint32_t const out = new_slot(bits.size());
+    uint32_t const first = program.operands.size();
+    for (uint32_t bit : bits) {
+        program.operands.push_back(resolve(bit));
+    }
+    add({Opcode::Pack, static_cast<uint8_t>(bits.size()), out, NO_SLOT, first, static_cast<uint32_t>(bits.size()), first});
+    return out;
+}
+
+void Lifter::extract(uint32_t out, uint32_t word, int bit) {
+    add({Opcode::Extract, 1, out, NO_SLOT, word, static_cast<uint32_t>(bit), word});
+    extracted[out] = {word, static_cast<uint8_t>(bit), 1};
+}
+
+uint32_t Lifter::word_operation(Opcode opcode, int width, uint32_t a, uint32_t b) {
+    uint32_t const out = new_slot(width);
+    add({opcode, static_cast<uint8_t>(width), out, NO_SLOT, a, b, a});
+    return out;
+}
+
+// Identical instructions, typically a ^ b in both an adder and a comparator
+bool Lifter::merge_duplicates() {
+    bool changed = false;
+    map<vector<uint32_t>, int> seen{};
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        Instruction const &ins = program.code[i];
+        if (dead[i] || ins.opcode == Opcode::Call || ins.opcode == Opcode::Gather || ins.opcode == Opcode::Lut)
+            continue;
+        vector<uint32_t> key{static_cast<uint32_t>(ins.opcode), ins.width, ins.carry != NO_SLOT};
+        if (ins.opcode == Opcode::Extract) {
+            key.insert(key.end(), {resolve(ins.a), ins.b});
+        } else {
+            vector<uint32_t> operands = reads(program, ins);
+            for (uint32_t &slot : operands) {
+                slot = resolve(slot);
+            }
+            if (is_bitwise(ins.opcode))
+                sort(operands.begin(), operands.end());
+            key.insert(key.end(), operands.begin(), operands.end());
+        }
+        auto found = seen.emplace(key, i);
+        if (found.second)
+            continue;
+        Instruction const &first = program.code[found.first->second];
+        alias[ins.out] = first.out;
+        if (equal.count(ins.out))
+            equal.emplace(first.out, equal[ins.out]);
+        if (ins.carry != NO_SLOT)
+            alias[ins.carry] = first.carry;
+        remove(i);
+        changed = true;
+    }
+    return changed;
+}
+
+bool Lifter::lift_adders() {
+    count_uses();
+    unordered_map<uint64_t, int> ands{}, ors{};
+    vector<int> xors{};
+    vector<Cell> cells{};
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        Instruction const &ins = program.code[i];
+        if (dead[i] || ins.width != 1)
+            continue;
+        uint32_t const a = resolve(ins.a), b = resolve(ins.b);
+        if (ins.opcode == Opcode::And)
+            ands[pair_key(a, b)] = i;
+        else if (ins.opcode == Opcode::Or)
+            ors[pair_key(a, b)] = i;
+        else if (ins.opcode == Opcode::Xor && a != b)
+            xors.push_back(i);
+        else if (ins.opcode == Opcode::Add)
+            cells.push_back({a, b, resolve(ins.c), ins.out, ins.carry, {static_cast<int>(i)}});
+    }
+
+    // Half adders, sum = a ^ b and carry = a & b
+    unordered_map<uint32_t, Cell> halves{};
+    for (int x : xors) {
+        Instruction const &ins = program.code[x];
+        uint32_t const a = resolve(ins.a), b = resolve(ins.b);
+        auto it = ands.find(pair_key(a, b));
+        if (it != ands.end())
+            halves[ins.out] = {a, b, NO_SLOT, ins.out, program.code[it->second].out, {it->second}};
+    }
+
+    // Full adders, sum = (a ^ b) ^ cin and carry = (a & b) | ((a ^ b) & cin).
+    // Without a carry only the sum is left: (a ^ b) ^ cin. Only the sum and
+    // the carry are replaced, a ^ b and the rest may be used elsewhere.
+    unordered_set<uint32_t> absorbed{};
+    for (int x : xors) {
+        Instruction const &ins = program.code[x];
+        uint32_t const operands[2] = {resolve(ins.a), resolve(ins.b)};
+        for (int i = 0; i < 2; ++i) {
+            uint32_t const p = operands[i], cin = operands[1 - i];
+            Instruction const *px = live_writer(p);
+            Instruction const *cx = live_writer(cin);
+            if (px == nullptr || px->opcode != Opcode::Xor || px->width != 1 || (cx != nullptr && cx->opcode == Opcode::Xor))
+                continue;
+            Cell cell{resolve(px->a), resolve(px->b), cin, ins.out, NO_SLOT, {x}, 1};
+            auto half = halves.find(p);
+            if (half != halves.end()) {
+                auto t = ands.find(pair_key(p, cin));
+                auto o = (t == ands.end()) ? ors.end() : ors.find(pair_key(half->second.carry, program.code[t->second].out));
+                if (o != ors.end()) {
+                    cell.carry = program.code[o->second].out;
+                    cell.instructions.push_back(o->second);
+                    cell.carry_reads = 2;
+                }
+            }
+            cells.push_back(cell);
+            absorbed.insert(p);
+            break;
+        }
+    }
+    for (auto const &half : halves) {
+        if (!absorbed.count(half.first))
+            cells.push_back(half.second);
+    }
+
+    unordered_map<uint32_t, size_t> by_cin{};
+    unordered_set<uint32_t> carries{};
+    for (size_t i = 0; i < cells.size(); ++i) {
+        if (cells[i].cin != NO_SLOT)
+            by_cin.emplace(cells[i].cin, i);
+        if (cells[i].carry != NO_SLOT)
+            carries.insert(cells[i].carry);
+    }
+
+    bool changed = false;
+    vector<bool> used(cells.size(), false);
+    for (size_t start = 0; start < cells.size(); ++start) {
+        if (used[start] || (cells[start].cin != NO_SLOT && carries.count(cells[start].cin)))
+            continue;
+        vector<size_t> chain{start};
+        while (chain.size() < 64 && cells[chain.back()].carry != NO_SLOT) {
+            uint32_t const carry = cells[chain.back()].carry;
+            auto next = by_cin.find(carry);
+            if (next == by_cin.end() || used[next->second])
+                break;
+            // Only the next cell may see the carry
+            if (uses[carry] != cells[next->second].carry_reads)
+                break;
+            chain.push_back(next->second);
+        }
+        for (size_t i : chain) {
+            used[i] = true;
+        }
+        if (static_cast<int>(chain.size()) < options.min_width)
+            continue;
+
+        vector<uint32_t> a{}, b{};
+        for (size_t i : chain) {
+            a.push_back(cells[i].a);
+            b.push_back(cells[i].b);
+            for (int index : cells[i].instructions) {
+                remove(index);
+            }
+        }
+        int const width = chain.size();
+        uint32_t const cin = (cells[start].cin == NO_SLOT) ? new_slot(1) : cells[start].cin;
+        uint32_t const sum = new_slot(width);
+        add({Opcode::Add, static_cast<uint8_t>(width), sum, cells[chain.back()].carry, pack(a), pack(b), cin});
+        for (int i = 0; i < width; ++i) {
+            if (cells[chain[i]].cin != NO_SLOT)
+                extract(cells[chain[i]].sum, sum, i);
+            else
+                equal[cells[chain[i]].sum] = {sum, 0, 1};
+        }
+        stats.adders += 1;
+        stats.adder_bits += width;
+        changed = true;
+    }
+    return changed;
+}
+
+// Packs of all bits of a word in order are the word, packs of constants are
+// constants
+bool Lifter::fold_packs() {
+    bool changed = false;
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        Instruction const ins = program.code[i];
+        if (dead[i] || ins.opcode != Opcode::Pack)
+            continue;
+        Location first{};
+        bool whole = get_bit(resolve(program.operands[ins.a + ins.b - 1]), first) && program.widths[first.slot] == ins.width;
+        bool constant = true;
+        uint64_t value = 0;
+        for (uint32_t j = 0; j < ins.b; ++j) {
+            uint32_t const slot = resolve(program.operands[ins.a + j]);
+            Location bit{};
+            whole = whole && get_bit(slot, bit, first.slot) && bit.slot == first.slot && bit.shift == static_cast<int>(j);
+            constant = constant && is_constant(slot);
+            value |= program.initial[slot] << j;
+        }
+        if (whole) {
+            alias[ins.out] = first.slot;
+        } else if (constant) {
+            alias[ins.out] = new_slot(ins.width, value);
+        } else {
+            continue;
+        }
+        remove(i);
+        changed = true;
+    }
+    return changed;
+}
+
+// Replace 1 bit registers by one word register, the bits are extracted from it
+uint32_t Lifter::new_register(vector<uint32_t> const &bits, unordered_map<uint32_t, size_t> &latch_of) {
+    uint64_t initial = 0;
+    vector<uint32_t> next{};
+    for (size_t j = 0; j < bits.size(); ++j) {
+        initial |= program.initial[bits[j]] << j;
+        size_t const latch = latch_of.at(bits[j]);
+        next.push_back(program.latches[latch].next);
+        removed_latch[latch] = true;
+        state[bits[j]] = false;
+    }
+    uint32_t const word = new_slot(bits.size(), initial);
+    for (size_t j = 0; j < bits.size(); ++j) {
+        extract(bits[j], word, j);
+    }
+    state[word] = true;
+    program.latches.push_back({word, pack(next)});
+    removed_latch.push_back(false);
+    latch_of[word] = program.latches.size() - 1;
+    stats.registers += bits.size();
+    return word;
+}
+
+// Packs of 1 bit registers become a word register
+bool Lifter::pack_registers() {
+    unordered_map<uint32_t, size_t> latch_of{};
+    for (size_t i = 0; i < program.latches.size(); ++i) {
+        if (!removed_latch[i])
+            latch_of[program.latches[i].state] = i;
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        Instruction const ins = program.code[i];
+        if (dead[i] || ins.opcode != Opcode::Pack)
+            continue;
+        vector<uint32_t> bits{};
+        unordered_set<uint32_t> distinct{};
+        for (uint32_t j = 0; j < ins.b; ++j) {
+            uint32_t const slot = resolve(program.operands[ins.a + j]);
+            if (!is_free_register(slot) || !distinct.insert(slot).second)
+                break;
+            bits.push_back(slot);
+        }
+        if (bits.size() != ins.b)
+            continue;
+
+        uint32_t const word = new_register(bits, latch_of);
+        alias[ins.out] = word;
+        remove(i);
+        changed = true;
+    }
+
+    // 1 bit registers fed by all bits of a word
+    map<uint32_t, vector<uint32_t>> fed{};
+    for (size_t i = 0; i < program.latches.size(); ++i) {
+        Location bit{};
+        if (!removed_latch[i] && is_free_register(program.latches[i].state) && get_bit(resolve(program.latches[i].next), bit)) {
+            vector<uint32_t> &bits = fed[bit.slot];
+            bits.resize(program.widths[bit.slot], NO_SLOT);
+            bits[bit.shift] = program.latches[i].state;
+        }
+    }
+    for (auto const &word : fed) {
+        vector<uint32_t> const &bits = word.second;
+        if (static_cast<int>(bits.size()) < options.min_width || count(bits.begin(), bits.end(), NO_SLOT))
+            continue;
+        new_register(bits, latch_of);
+        changed = true;
+    }
+    return changed;
+}
+
+// 1 bit operations on the same bit of words
+bool Lifter::lift_bitwise() {
+    struct Member {
+        int index;
+        int bit;
+        uint64_t constant;
+    };
+    uint32_t const CONSTANT = NO_SLOT;
+    map<tuple<Opcode, uint32_t, uint32_t>, vector<Member>> groups{};
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        Instruction const &ins = program.code[i];
+        if (dead[i] || ins.width != 1 || !is_bitwise(ins.opcode))
+            continue;
+        uint32_t a = resolve(ins.a), b = resolve(ins.b);
+        Location bit_a{}, bit_b{};
+        if (!get_bit(a, bit_a)) {
+            swap(a, b);
+            if (ins.opcode == Opcode::Not || !get_bit(a, bit_a))
+                continue;
+        }
+        if (ins.opcode == Opcode::Not) {
+            groups[make_tuple(ins.opcode, bit_a.slot, CONSTANT)].push_back({static_cast<int>(i), bit_a.shift, 0});
+        } else if (is_constant(b)) {
+            groups[make_tuple(ins.opcode, bit_a.slot, CONSTANT)].push_back({static_cast<int>(i), bit_a.shift, program.initial[b]});
+        } else if (get_bit(b, bit_b) && bit_b.shift == bit_a.shift && program.widths[bit_b.slot] == program.widths[bit_a.slot]) {
+            groups[make_tuple(ins.opcode, bit_a.slot, bit_b.slot)].push_back({static_cast<int>(i), bit_a.shift, 0});
+        }
+    }
+
+    bool changed = false;
+    for (auto const &group : groups) {
+        Opcode const opcode = get<0>(group.first);
+        uint32_t const a = get<1>(group.first);
+        int const width = program.widths[a];
+        vector<Member> members{};
+        vector<bool> seen(width, false);
+        uint64_t constant = 0;
+        for (Member const &member : group.second) {
+            if (seen[member.bit])
+                continue;
+            seen[member.bit] = true;
+            members.push_back(member);
+            constant |= member.constant << member.bit;
+        }
+        if (static_cast<int>(members.size()) < options.min_width)
+            continue;
+
+        uint32_t b = get<2>(group.first);
+        if (b == CONSTANT)
+            b = (opcode == Opcode::Not) ? a : new_slot(width, constant);
+        uint32_t const out = word_operation(opcode, width, a, b);
+        for (Member const &member : members) {
+            uint32_t const bit = program.code[member.index].out;
+            remove(member.index);
+            extract(bit, out, member.bit);
+        }
+        stats.bitwise += 1;
+        stats.bitwise_bits += members.size();
+        changed = true;
+    }
+    return changed;
+}
+
+// 1 bit operations on registers which are not part of a word yet. Any order
+// of the bits works, as long as it is the same for both operands.
+bool Lifter::seed_registers() {
+    struct Member {
+        int index;
+        uint32_t a, b;
+    };
+    map<pair<Opcode, bool>, vector<Member>> groups{};
+    unordered_set<uint32_t> claimed{};
+    for (size_t i = 0; i < program.code.size(); ++i) {
+        Instruction const &ins = program.code[i];
+        if (dead[i] || ins.width != 1 || !is_bitwise(ins.opcode))
+            continue;
+        uint32_t a = resolve(ins.a), b = resolve(ins.b);
+        if (!is_free_register(a))
+            swap(a, b);
+        if (!is_free_register(a) || claimed.count(a))
+            continue;
+        bool const constant = ins.opcode != Opcode::Not && is_constant(b);
+        if (ins.opcode != Opcode::Not && !constant && (!is_free_register(b) || claimed.count(b) || a == b))
+            continue;
+        claimed.insert(a);
+        if (ins.opcode != Opcode::Not && !constant)
+            claimed.insert(b);
+        groups[make_pair(ins.opcode, constant)].push_back({static_cast<int>(i), a, b});
+    }
+
+    bool changed = false;
+    for (auto const &group : groups) {
+        Opcode const opcode = group.first.first;
+        vector<Member> const &members = group.second;
+        for (size_t first = 0; first < members.size(); first += 64) {
+            size_t const last = min(members.size(), first + 64);
+            int const width = last - first;
+            if (width < options.min_width)
+                continue;
+            vector<uint32_t> a{}, b{};
+            for (size_t i = first; i < last; ++i) {
+                a.push_back(members[i].a);
+                b.push_back(members[i].b);
+            }
+            uint32_t const word_a = pack(a);
+            uint32_t const word_b = (opcode == Opcode::Not) ? word_a : pack(b);
+            uint32_t const out = word_operation(opcode, width, word_a, word_b);
+            for (size_t i = first; i < last; ++i) {
+                uint32_t const bit = program.code[members[i].index].out;
+                remove(members[i].index);
+                extract(bit, out, i - first);
+            }
+            stats.bitwise += 1;
+            stats.bitwise_bits += width;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+// And and Or trees over all bits of a word
+void Lifter::lift_reductions() {
+    count_uses();
+    vector<bool> visited(program.code.size(), false);
+    for (int i = program.code.size() - 1; i >= 0; --i) {
+        Instruction const ins = program.code[i];
+        if (visited[i] || ins.width != 1)
+            continue;
+        Opcode inner;
+        switch (ins.opcode) {
+        case Opcode::And:
+        case Opcode::Nand:
+            inner = Opcode::And;
+            break;
+        case Opcode::Or:
+        case Opcode::Nor:
+            inner = Opcode::Or;
+            break;
+        default:
+            continue;
+        }
+
+        vector<int> nodes{};
+        vector<uint32_t> leaves{}, pending{ins.a, ins.b};
+        while (!pending.empty()) {
+            uint32_t const slot = resolve(pending.back());
+            pending.pop_back();
+            Instruction const *w = live_writer(slot);
+            if (w != nullptr && w->opcode == inner && w->width == 1 && uses[slot] == 1) {
+                nodes.push_back(writer[slot]);
+                pending.push_back(w->a);
+                pending.push_back(w->b);
+            } else {
+                leaves.push_back(slot);
+            }
+        }
+
+        Location first{};
+        int const width = leaves.size();
+        if (!get_bit(leaves[0], first) || program.widths[first.slot] != width || width < options.min_width)
+            continue;
+        vector<bool> seen(leaves.size(), false);
+        bool complete = true;
+        for (uint32_t leaf : leaves) {
+            Location bit{};
+            complete = complete && get_bit(leaf, bit) && bit.slot == first.slot && !seen[bit.shift];
+            if (complete)
+                seen[bit.shift] = true;
+        }
+        if (!complete)
+            continue;
+
+        remove(i);
+        for (int node : nodes) {
+            visited[node] = true;
+            remove(node);
+        }
+        Opcode const reduce = (inner == Opcode::And) ? Opcode::ReduceAnd : Opcode::ReduceOr;
+        if (ins.opcode == inner) {
+            add({reduce, program.widths[first.slot], ins.out, NO_SLOT, first.slot, first.slot, first.slot});
+        } else {
+            uint32_t const reduced = new_slot(1);
+            add({reduce, program.widths[first.slot], reduced, NO_SLOT, first.slot, first.slot, first.slot});
+            add({Opcode::Not, 1, ins.out, NO_SLOT, reduced, reduced, reduced});
+        }
+        stats.reductions += 1;
+    }
+}
+
+// Bits which were extracted from a word are read from the word
+void Lifter::remap(Location &location) const {
+    auto it = extracted.find(location.slot);
+    while (it != extracted.end() && location.width == 1 && location.shift == 0) {
+        location = it->second;
+        it = extracted.find(location.slot);
+    }
+}
+
+void Lifter::run() {
+    stats.instructions_before = program.code.size();
+    drop_register_net_copies(program);
+    init();
+    produced.assign(program.initial.size(), false);
+    for (Instruction const &ins : program.code) {
+        for (uint32_t slot : writes(program, ins)) {
+            produced[slot] = true;
+        }
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = merge_duplicates();
+        changed = lift_adders() || changed;
+        while (merge_duplicates() || fold_packs() || pack_registers() || lift_bitwise()) {
+            changed = true;
+        }
+        if (!changed)
+            changed = seed_registers();
+    }
+    compact();
+    lift_reductions();
+    compact();
+
+    for (auto &entry : program.net_slots) {
+        remap(entry.second);
+    }
+    for (auto &entry : program.state_slots) {
+        remap(entry.second);
+    }
+    for (auto &entry : program.sink_slots) {
+        remap(entry.second);
+    }
+    remove_dead_code(program);
+
+    // Nets whose value is no longer calculated
+    init();
+    for (auto it = program.net_slots.begin(); it != program.net_slots.end();) {
+        uint32_t const slot = it->second.slot;
+        if (slot < produced.size() && produced[slot] && writer[slot] < 0 && !state[slot])
+            it = program.net_slots.erase(it);
+        else
+            ++it;
+    }
+    copy_register_nets(program);
+    stats.instructions_after = program.code.size();
+}
+
+}  // namespace
+
+LiftStats lift_words(Program &program, LiftOptions const &options) {
+    LiftStats stats{};
+    Lifter lifter{program, options, stats};
+    lifter.run();
+    return stats;
+}
@@ -0,0 +1,41 @@
+#ifndef WORD_LIFTING_H_
+#define WORD_LIFTING_H_
+
+#include "program.h"
+
+/* Word level lifting of bit level designs.
+ *
+ * A design made of 1 bit gates and registers, such as a synthesized netlist,
+ * spends one instruction per bit. This pass recognizes bit sliced structures
+ * in a compiled Program and replaces them with word level instructions:
+ *   - ripple carry adders, built from Adder<1> cells or from half and full
+ *     adder gates, become one Add
+ *   - 1 bit operations on the same bits of two words become one operation on
+ *     the words
+ *   - And and Or trees over all bits of a word, as found in equality
+ *     comparators, become one reduction
+ *   - 1 bit registers used as a bus are packed into one word register
+ *
+ * Bits which are still needed on their own are extracted from the words, and
+ * buses which are not yet words are packed, so the pass can stop anywhere.
+ * Only nets which still have a value after lifting can be read by a Simulator.
+ */
+
+struct LiftOptions {
+    int min_width = 4;   // Narrowest structure worth lifting
+};
+
+struct LiftStats {
+    int adders = 0;          // Ripple carry adders lifted into an Add
+    int adder_bits = 0;
+    int bitwise = 0;         // Groups of 1 bit operations lifted into one
+    int bitwise_bits = 0;
+    int reductions = 0;      // And and Or trees lifted into a reduction
+    int registers = 0;       // 1 bit registers packed into words
+    int instructions_before = 0;
+    int instructions_after = 0;
+};
+
+LiftStats lift_words(Program &program, LiftOptions const &options=LiftOptions{});
+
+#endif  // WORD_LIFTING_H_
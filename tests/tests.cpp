@@ -2,6 +2,12 @@
 
 #include "catch.hpp"
 
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <deque>
+#include <algorithm>
+
 #include "wire.h"
 #include "adder.h"
 #include "register.h"
@@ -10,6 +16,29 @@
 #include "sink.h"
 #include "simple_components.h"
 #include "clock.h"
+#include "netlist.h"
+#include "lookup_table.h"
+#include "memoized_cone.h"
+#include "fused_register.h"
+#include "simulator.h"
+#include "word_lifting.h"
+#include "bit_slicing.h"
+#include "static_netlist.h"
+#include "importer.h"
+#include "schedule_cache.h"
+#include "parallel_build.h"
+#include "checkpoint.h"
+#include "farm.h"
+#include "trace.h"
+#include "wave_file.h"
+#include "register_trace.h"
+#include "probe.h"
+#include "recording_sink.h"
+#include "input_stream.h"
+#include "stimulus_feed.h"
+#include "golden_checker.h"
+#include "watch.h"
+#include "assertion.h"
 
 using namespace std;
 
@@ -752,6 +781,12 @@ TEST_CASE( "Constallation 2: Owned by Clock") {
         Clock system_clock{0, {&r0, &r1, &r2, &r3, &c0, &c1, &c2, &c3}};
         meter.measure([&system_clock] { return system_clock.clock(); });
     };
+
+    BENCHMARK_ADVANCED("Compiled")(Catch::Benchmark::Chronometer meter) {
+        Netlist netlist{&r0, &r1, &r2, &r3, &c0, &c1, &c2, &c3};
+        Simulator simulator{netlist};
+        meter.measure([&simulator] { return simulator.clock(); });
+    };
 }
 
 TEST_CASE( "Constallation 3: Owned by Clock -- Very large circuit") {
@@ -1171,4 +1206,2889 @@ TEST_CASE( "Constallation 3: Owned by Clock -- Very large circuit") {
         meter.measure([&system_clock] { return system_clock.clock(); });
     };
 
+    BENCHMARK_ADVANCED("Compiled")(Catch::Benchmark::Chronometer meter) {
+        vector<Clockable*> clockables{};
+        auto r0_it = r0.begin();
+        auto r1_it = r1.begin();
+        auto r2_it = r2.begin();
+        auto r3_it = r3.begin();
+        auto c0_it = c0.begin();
+        auto c1_it = c1.begin();
+        auto c2_it = c2.begin();
+        auto c3_it = c3.begin();
+        for (unsigned i=0; i<N; ++i) {
+            clockables.push_back(&(*r0_it++));
+            clockables.push_back(&(*r1_it++));
+            clockables.push_back(&(*r2_it++));
+            clockables.push_back(&(*r3_it++));
+            clockables.push_back(&(*c0_it++));
+            clockables.push_back(&(*c1_it++));
+            clockables.push_back(&(*c2_it++));
+            clockables.push_back(&(*c3_it++));
+        }
+        Netlist netlist{clockables};
+        Simulator simulator{netlist};
+        meter.measure([&simulator] { return simulator.clock(); });
+    };
+
+}
+
+TEST_CASE( "Lookup tables" ) {
+    SECTION( "Adder with carry out" ) {
+        //
+        //    ra    rb
+        //    ___   ___
+        //   |>  | |>  |
+        //     |    |
+        //     |   _|_
+        //     |   \ / i
+        //     |    O      c
+        //     |    |      |
+        //   \-A-\/-B-/    |
+        //    \   a   Cin---
+        //     \    /
+        //      ----
+        //     |    |
+        //    _|_  _|_
+        //   |>  ||>  |
+        //    rc    rs
+        //
+        Register<4> rs{"SumRegister"};
+        Register<1> rc{"CarryRegister"};
+        Wire<4> w_sum{&rs.input};
+        Wire<1> w_cout{&rc.input};
+        Adder<4> a{&w_cout, &w_sum, "Adder"};
+        Wire<4> w_b{&a.B};
+        Inverter<4> i{&w_b, "Inverter"};
+        Wire<4> w_ra{&a.A};
+        Wire<4> w_rb{&i.input};
+        Wire<1> w_c{&a.Cin};
+        Register<4> ra{3, &w_ra, "RegisterA"};
+        Register<4> rb{2, &w_rb, "RegisterB"};
+        Constant<1> c{0, &w_c};
+
+        Netlist netlist{&ra, &rb, &rs, &rc, &c};
+        LookupTableStats stats = collapse_small_cones(netlist);
+        CHECK( stats.cones == 1 );
+        CHECK( stats.components_replaced == 2 );
+        CHECK( stats.table_bytes == 256 );
+        CHECK( netlist.get_components().size() == 1 );
+
+        Clock system_clock{1, {&ra, &rb, &rs, &rc, &c}};
+        system_clock.clock();
+        CHECK( rs.get_value() == 0 );
+        CHECK( rc.get_value() == 1 );
+    }
+
+    // Constallation 2
+    Wire<8> w0{"Wire0"};
+    Wire<8> w1{"Wire1"};
+    Wire<8> w2{"Wire2"};
+    Wire<8> w3{"Wire3"};
+    Wire<8> w4{"Wire4"};
+    Wire<1> w5{"Wire5"};
+    Wire<1> w6{"Wire6"};
+    Wire<8> w7{"Wire7"};
+    Wire<8> w8{"Wire8"};
+    Wire<8> w9{"Wire9"};
+    Wire<8> w10{"Wire10"};
+    Wire<8> w11{"Wire11"};
+    Wire<8> w12{"Wire12"};
+    Wire<8> w13{"Wire13"};
+
+    Register<8> r0{25, &w0, "Register0"};
+    Register<8> r1{25, &w2, "Register1"};
+    Constant<8> c0{1, &w1};
+    Constant<8> c1{1, &w4};
+    Constant<1> c2{0, &w5};
+    Constant<1> c3{1, &w6};
+    Adder<8> a0{&w7, "Adder0"};
+    Adder<8> a1{&w8, "Adder1"};
+    Inverter<8> i0{&w3, "Inverter0"};
+    Register<8> r2{&w9, "Register2"};
+    Register<8> r3{&w10, "Register3"};
+    Inverter<8> i1{&w11, "Inverter1"};
+    ORGate<8> OR{&w12, "ORGate"};
+    XORGate<8> XOR{&w13, "XORGate"};
+    Sink<8> s0{"Sink0"};
+    Sink<8> s1{"Sink1"};
+
+    w0.add_targets(&a0.A);
+    w1.add_targets(&a0.B);
+    w2.add_targets(&a1.A);
+    w3.add_targets(&a1.B);
+    w4.add_targets(&i0.input);
+    w5.add_targets(&a0.Cin);
+    w6.add_targets(&a1.Cin);
+    w7.add_targets({&r0.input, &r2.input});
+    w8.add_targets({&r1.input, &r3.input});
+    w9.add_targets({&OR.input[0], &XOR.input[0]});
+    w10.add_targets(&i1.input);
+    w11.add_targets({&OR.input[1], &XOR.input[1]});
+    w12.add_targets(&s0.input);
+    w13.add_targets(&s1.input);
+
+    Netlist netlist{&r0, &r1, &r2, &r3, &c0, &c1, &c2, &c3};
+    REQUIRE( netlist.get_components().size() == 6 );
+
+    SECTION( "Default options" ) {
+        // Only Adder1 and Inverter0 forms a cone with more than one component
+        LookupTableStats stats = collapse_small_cones(netlist);
+        CHECK( stats.cones == 1 );
+        CHECK( stats.components_replaced == 2 );
+        CHECK( netlist.get_components().size() == 5 );
+    }
+
+    SECTION( "Memory cap" ) {
+        LookupTableOptions options{};
+        options.max_table_bytes = 255;
+        LookupTableStats stats = collapse_small_cones(netlist, options);
+        CHECK( stats.cones == 0 );
+        CHECK( netlist.get_components().size() == 6 );
+    }
+
+    SECTION( "Replace every component" ) {
+        LookupTableOptions options{};
+        options.min_components = 1;
+        LookupTableStats stats = collapse_small_cones(netlist, options);
+        CHECK( stats.cones == 5 );
+        CHECK( stats.components_replaced == 6 );
+        CHECK( stats.table_bytes == 3 * 256 + 2 * 65536 );
+        CHECK( netlist.get_components().size() == 5 );
+
+        Clock system_clock{1, {&r0, &r1, &r2, &r3, &c0, &c1, &c2, &c3}};
+        system_clock.clock();
+        CHECK( r0.get_value() == 26 );
+        CHECK( r1.get_value() == 24 );
+        CHECK( r2.get_value() == 26 );
+        CHECK( r3.get_value() == 24 );
+        CHECK( s0.get_value() == (0 | ~0) );
+        CHECK( s1.get_value() == (0 ^ ~0) );
+
+        system_clock.clock();
+        CHECK( r0.get_value() == 27 );
+        CHECK( r1.get_value() == 23 );
+        CHECK( r2.get_value() == 27 );
+        CHECK( r3.get_value() == 23 );
+        CHECK( s0.get_value() == (26 | ~24) );
+        CHECK( s1.get_value() == (26 ^ ~24) );
+    }
+}
+
+TEST_CASE( "Memoized cones" ) {
+    // r0 counts 0, 1, 2, 3, 0, ... and r1 = (r0 ^ 0x100) + (r0 & 0xff)
+    //
+    //      |-------------------|
+    //     _|_                  |
+    //    |>  | r0              |
+    //      |                   |
+    //      *---------------    |
+    //      |    |     |   |    |
+    //     _|_  _|_   _|_  |    |
+    //    | + || ^ | | & | |    |
+    //      |    |     |   |    |
+    //      |  \-A-\/-B-/  |    |
+    //      |   \  a1  /   |    |
+    //      |    ----      |    |
+    //     _|_     |       |    |
+    //    | & |   _|_      |    |
+    //      |    |>  | r1  |    |
+    //      |---------------    |
+    //      |-------------------|
+    //
+    Wire<32> w0{"Wire0"};
+    Wire<32> w1{"Wire1"};
+    Wire<32> w2{"Wire2"};
+    Wire<32> w3{"Wire3"};
+    Wire<32> w4{"Wire4"};
+    Wire<32> w5{"Wire5"};
+    Wire<32> w_one{};
+    Wire<32> w_three{};
+    Wire<32> w_k1{};
+    Wire<32> w_k2{};
+    Wire<1> w_cin0{};
+    Wire<1> w_cin1{};
+
+    Register<32> r0{0, &w0, "Register0"};
+    Register<32> r1{"Register1"};
+    Constant<32> one{1, &w_one};
+    Constant<32> three{3, &w_three};
+    Constant<32> k1{0x100, &w_k1};
+    Constant<32> k2{0xff, &w_k2};
+    Constant<1> cin0{0, &w_cin0};
+    Constant<1> cin1{0, &w_cin1};
+
+    Adder<32> a0{&w1, "Adder0"};
+    ANDGate<32> wrap{&w2, "Wrap"};
+    XORGate<32> x{&w3, "XORGate"};
+    ANDGate<32> m{&w4, "ANDGate"};
+    Adder<32> a1{&w5, "Adder1"};
+
+    w0.add_targets({&a0.A, &x.input[0], &m.input[0]});
+    w1.add_targets(&wrap.input[0]);
+    w2.add_targets(&r0.input);
+    w3.add_targets(&a1.A);
+    w4.add_targets(&a1.B);
+    w5.add_targets(&r1.input);
+    w_one.add_targets(&a0.B);
+    w_three.add_targets(&wrap.input[1]);
+    w_k1.add_targets(&x.input[1]);
+    w_k2.add_targets(&m.input[1]);
+    w_cin0.add_targets(&a0.Cin);
+    w_cin1.add_targets(&a1.Cin);
+
+    Netlist netlist{&r0, &r1, &one, &three, &k1, &k2, &cin0, &cin1};
+    // Refused before the netlist is changed
+    MemoOptions bad{};
+    bad.ways = 0;
+    CHECK_THROWS_AS( memoize_cones(netlist, bad), std::invalid_argument );
+    bad.ways = 4;
+    bad.sets = 48;
+    CHECK_THROWS_WITH( memoize_cones(netlist, bad), Catch::Contains("power of two") );
+    vector<MemoizedCone*> cones = memoize_cones(netlist);
+    REQUIRE( cones.size() == 2 );
+    CHECK( netlist.get_components().size() == 2 );
+
+    Clock system_clock{1, {&r0, &r1, &one, &three, &k1, &k2, &cin0, &cin1}};
+
+    // Profiling, only the first four cycles misses
+    for (int i = 0; i < 20; ++i) {
+        system_clock.clock();
+    }
+    for (MemoizedCone *cone : cones) {
+        CHECK( cone->get_misses() == 4 );
+        CHECK( cone->get_hits() == 16 );
+    }
+
+    SECTION( "Enabled" ) {
+        MemoStats stats = apply_memo_profile(cones);
+        CHECK( stats.enabled == 2 );
+        CHECK( stats.disabled == 0 );
+        for (int i = 0; i < 3; ++i) {
+            system_clock.clock();
+        }
+        // 23 cycles
+        CHECK( r0.get_value() == 3 );
+        CHECK( r1.get_value() == 0x104 );
+        for (MemoizedCone *cone : cones) {
+            CHECK( cone->get_mode() == MemoizedCone::Mode::Enabled );
+            CHECK( cone->get_misses() == 0 );
+            CHECK( cone->get_hits() == 3 );
+        }
+    }
+
+    SECTION( "Disabled" ) {
+        MemoStats stats = apply_memo_profile(cones, 0.9);
+        CHECK( stats.enabled == 0 );
+        CHECK( stats.disabled == 2 );
+        system_clock.clock();
+        CHECK( r0.get_value() == 1 );
+        CHECK( r1.get_value() == 0x100 );
+        CHECK( cones[0]->get_hits() + cones[0]->get_misses() == 0 );
+    }
+}
+
+TEST_CASE( "Fused registers" ) {
+    // Constallation 2, r0 counts up and r1 counts down
+    Wire<8> w0{"Wire0"};
+    Wire<8> w1{"Wire1"};
+    Wire<8> w2{"Wire2"};
+    Wire<8> w3{"Wire3"};
+    Wire<8> w4{"Wire4"};
+    Wire<1> w5{"Wire5"};
+    Wire<1> w6{"Wire6"};
+    Wire<8> w7{"Wire7"};
+    Wire<8> w8{"Wire8"};
+    Wire<8> w9{"Wire9"};
+    Wire<8> w10{"Wire10"};
+    Wire<8> w11{"Wire11"};
+    Wire<8> w12{"Wire12"};
+    Wire<8> w13{"Wire13"};
+
+    Register<8> r0{25, &w0, "Register0"};
+    Register<8> r1{25, &w2, "Register1"};
+    Constant<8> c0{1, &w1};
+    Constant<8> c1{1, &w4};
+    Constant<1> c2{0, &w5};
+    Constant<1> c3{1, &w6};
+    Adder<8> a0{&w7, "Adder0"};
+    Adder<8> a1{&w8, "Adder1"};
+    Inverter<8> i0{&w3, "Inverter0"};
+    Register<8> r2{&w9, "Register2"};
+    Register<8> r3{&w10, "Register3"};
+    Inverter<8> i1{&w11, "Inverter1"};
+    ORGate<8> OR{&w12, "ORGate"};
+    XORGate<8> XOR{&w13, "XORGate"};
+    Sink<8> s0{"Sink0"};
+    Sink<8> s1{"Sink1"};
+
+    w0.add_targets(&a0.A);
+    w1.add_targets(&a0.B);
+    w2.add_targets(&a1.A);
+    w3.add_targets(&a1.B);
+    w4.add_targets(&i0.input);
+    w5.add_targets(&a0.Cin);
+    w6.add_targets(&a1.Cin);
+    w7.add_targets({&r0.input, &r2.input});
+    w8.add_targets({&r1.input, &r3.input});
+    w9.add_targets({&OR.input[0], &XOR.input[0]});
+    w10.add_targets(&i1.input);
+    w11.add_targets({&OR.input[1], &XOR.input[1]});
+    w12.add_targets(&s0.input);
+    w13.add_targets(&s1.input);
+
+    Netlist netlist{&r0, &r1, &r2, &r3, &c0, &c1, &c2, &c3};
+    FusionStats stats = fuse_feedback_registers(netlist);
+    CHECK( stats.fused == 2 );
+    CHECK( stats.counters == 2 );
+    CHECK( netlist.get_components().size() == 3 );
+
+    Clock system_clock{1, netlist.get_clockables()};
+
+    SECTION( "Clock" ) {
+        system_clock.clock();
+        CHECK( r0.get_value() == 26 );
+        CHECK( r1.get_value() == 24 );
+        CHECK( r2.get_value() == 26 );
+        CHECK( r3.get_value() == 24 );
+        CHECK( s0.get_value() == (0 | ~0) );
+        CHECK( s1.get_value() == (0 ^ ~0) );
+
+        system_clock.clock();
+        CHECK( r0.get_value() == 27 );
+        CHECK( r1.get_value() == 23 );
+        CHECK( r2.get_value() == 27 );
+        CHECK( r3.get_value() == 23 );
+        CHECK( s0.get_value() == (26 | ~24) );
+        CHECK( s1.get_value() == (26 ^ ~24) );
+    }
+
+    SECTION( "Fast forward" ) {
+        // r2 and r3 are one register after the counters, so only the last
+        // two cycles has to be clocked
+        CHECK( fast_forward(netlist, system_clock, 1002) == 1000 );
+        CHECK( r0.get_value() == ((25 + 1002) & 0xff) );
+        CHECK( r1.get_value() == ((25 - 1002) & 0xff) );
+        CHECK( r2.get_value() == r0.get_value() );
+        CHECK( r3.get_value() == r1.get_value() );
+        CHECK( s0.get_value() == (((26 + 1000) | ~(24 - 1000)) & 0xff) );
+        CHECK( s1.get_value() == (((26 + 1000) ^ ~(24 - 1000)) & 0xff) );
+    }
+}
+
+TEST_CASE( "Compiled designs" ) {
+    SECTION( "Identities" ) {
+        //
+        //    r0
+        //    ___
+        //   |>  |
+        //     |
+        //   x & x -> x | 0 -> ~x -> ~x -> x + 0 -> r1
+        //                          |
+        //                        x ^ 0 (unused)
+        //
+        Wire<8> w0{"Wire0"};
+        Wire<8> w1{"Wire1"};
+        Wire<8> w2{"Wire2"};
+        Wire<8> w3{"Wire3"};
+        Wire<8> w4{"Wire4"};
+        Wire<8> w5{"Wire5"};
+        Wire<8> w6{"Wire6"};
+        Wire<8> w_zero{"WireZero"};
+        Wire<1> w_cin{"WireCin"};
+
+        Register<8> r0{0x5a, &w0, "Register0"};
+        Register<8> r1{"Register1"};
+        Constant<8> zero{0, &w_zero};
+        Constant<1> cin{0, &w_cin};
+        ANDGate<8> and_gate{&w1};
+        ORGate<8> or_gate{&w2};
+        Inverter<8> i0{&w3};
+        Inverter<8> i1{&w4};
+        Adder<8> adder{&w5};
+        XORGate<8> unused{&w6};
+
+        w0.add_targets({&and_gate.input[0], &and_gate.input[1]});
+        w1.add_targets(&or_gate.input[0]);
+        w2.add_targets(&i0.input);
+        w3.add_targets({&i1.input, &unused.input[0]});
+        w4.add_targets(&adder.A);
+        w5.add_targets(&r1.input);
+        w_zero.add_targets({&or_gate.input[1], &adder.B, &unused.input[1]});
+        w_cin.add_targets(&adder.Cin);
+
+        Netlist netlist{&r0, &r1, &zero, &cin};
+        Simulator simulator{netlist};
+        CompileStats const &stats = simulator.get_stats();
+        CHECK( stats.components == 6 );
+        CHECK( stats.aliased == 5 );
+        CHECK( stats.removed == 1 );
+        // The copy of the state of r1 for its net
+        CHECK( stats.instructions == 1 );
+
+        simulator.clock();
+        CHECK( simulator.get_state(&r1) == 0x5a );
+        CHECK( simulator.get_raw(&w5) == 0x5a );
+    }
+
+    // Constallation 2
+    Wire<8> w0{"Wire0"};
+    Wire<8> w1{"Wire1"};
+    Wire<8> w2{"Wire2"};
+    Wire<8> w3{"Wire3"};
+    Wire<8> w4{"Wire4"};
+    Wire<1> w5{"Wire5"};
+    Wire<1> w6{"Wire6"};
+    Wire<8> w7{"Wire7"};
+    Wire<8> w8{"Wire8"};
+    Wire<8> w9{"Wire9"};
+    Wire<8> w10{"Wire10"};
+    Wire<8> w11{"Wire11"};
+    Wire<8> w12{"Wire12"};
+    Wire<8> w13{"Wire13"};
+
+    Register<8> r0{25, &w0, "Register0"};
+    Register<8> r1{25, &w2, "Register1"};
+    Constant<8> c0{1, &w1};
+    Constant<8> c1{1, &w4};
+    Constant<1> c2{0, &w5};
+    Constant<1> c3{1, &w6};
+    Adder<8> a0{&w7, "Adder0"};
+    Adder<8> a1{&w8, "Adder1"};
+    Inverter<8> i0{&w3, "Inverter0"};
+    Register<8> r2{&w9, "Register2"};
+    Register<8> r3{&w10, "Register3"};
+    Inverter<8> i1{&w11, "Inverter1"};
+    ORGate<8> OR{&w12, "ORGate"};
+    XORGate<8> XOR{&w13, "XORGate"};
+    Sink<8> s0{"Sink0"};
+    Sink<8> s1{"Sink1"};
+
+    w0.add_targets(&a0.A);
+    w1.add_targets(&a0.B);
+    w2.add_targets(&a1.A);
+    w3.add_targets(&a1.B);
+    w4.add_targets(&i0.input);
+    w5.add_targets(&a0.Cin);
+    w6.add_targets(&a1.Cin);
+    w7.add_targets({&r0.input, &r2.input});
+    w8.add_targets({&r1.input, &r3.input});
+    w9.add_targets({&OR.input[0], &XOR.input[0]});
+    w10.add_targets(&i1.input);
+    w11.add_targets({&OR.input[1], &XOR.input[1]});
+    w12.add_targets(&s0.input);
+    w13.add_targets(&s1.input);
+
+    Netlist netlist{&r0, &r1, &r2, &r3, &c0, &c1, &c2, &c3};
+
+    auto check = [&](Simulator &simulator) {
+        simulator.clock();
+        CHECK( simulator.get_state(&r0) == 26 );
+        CHECK( simulator.get_state(&r1) == 24 );
+        CHECK( simulator.get_state(&r2) == 26 );
+        CHECK( simulator.get_state(&r3) == 24 );
+        CHECK( simulator.get_sink(&s0) == (0 | 0xff) );
+        CHECK( simulator.get_sink(&s1) == (0 ^ 0xff) );
+
+        simulator.clock();
+        CHECK( simulator.get_state(&r0) == 27 );
+        CHECK( simulator.get_state(&r1) == 23 );
+        CHECK( simulator.get_state(&r2) == 27 );
+        CHECK( simulator.get_state(&r3) == 23 );
+        CHECK( simulator.get_sink(&s0) == ((26 | ~24) & 0xff) );
+        CHECK( simulator.get_sink(&s1) == ((26 ^ ~24) & 0xff) );
+
+        simulator.write_back(netlist);
+        CHECK( r0.get_value() == 27 );
+        CHECK( r3.get_value() == 23 );
+    };
+
+    SECTION( "Wires and ports are collapsed" ) {
+        Simulator simulator{netlist};
+        CompileStats const &stats = simulator.get_stats();
+        CHECK( stats.wires == 14 );
+        CHECK( stats.ports == 18 );
+        CHECK( stats.folded == 1 );
+        // And a copy of the state of every register for its net
+        CHECK( stats.instructions == 5 + 4 );
+        check(simulator);
+    }
+
+    SECTION( "After other passes" ) {
+        LookupTableOptions options{};
+        options.min_components = 1;
+        collapse_small_cones(netlist, options);
+        fuse_feedback_registers(netlist);
+        Simulator simulator{netlist};
+        check(simulator);
+        CHECK_THROWS( save_program(simulator.get_program(), "test_program.bin") );
+    }
+
+    SECTION( "Saved and mapped" ) {
+        Program program = compile(netlist);
+        save_program(program, "test_program.bin", 42);
+        auto mapped = make_shared<MappedProgram const>("test_program.bin");
+        std::remove("test_program.bin");
+        CHECK( mapped->get_header().key == 42 );
+        CHECK( mapped->get_view().code_size == program.code.size() );
+
+        // Fan-out of Register0: the adder feeding it again, and the copy for its net
+        uint32_t const slot = mapped->find("Register0", NamedLocation::State).slot;
+        uint64_t const *offsets = mapped->get_fanout_offsets();
+        REQUIRE( offsets[slot + 1] - offsets[slot] == 2 );
+        CHECK( mapped->get_view().code[mapped->get_fanout()[offsets[slot]]].opcode == Opcode::Add );
+        CHECK( mapped->get_view().code[mapped->get_fanout()[offsets[slot] + 1]].opcode == Opcode::Copy );
+
+        Simulator simulator{mapped};
+        simulator.run(2);
+        CHECK( simulator.read(mapped->find("Register0", NamedLocation::State)) == 27 );
+        CHECK( simulator.read(mapped->find("Register3", NamedLocation::State)) == 23 );
+        CHECK( simulator.read(mapped->find("Sink1", NamedLocation::Sink)) == ((26 ^ ~24) & 0xff) );
+        CHECK( simulator.read(mapped->find("Wire7")) == 27 );
+        CHECK_THROWS( mapped->find("Wire42") );
+    }
+
+    SECTION( "Corrupt files" ) {
+        Program program = compile(netlist);
+        // Overwrite a value at offset of a saved program
+        auto corrupt = [&](size_t offset, auto value) {
+            save_program(program, "test_program.bin");
+            std::fstream file{"test_program.bin", std::ios::binary | std::ios::in | std::ios::out};
+            file.seekp(offset);
+            file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+        };
+        // count * sizeof(Term) wraps to 0
+        corrupt(offsetof(ProgramFileHeader, term_count), uint64_t{1} << 60);
+        CHECK_THROWS_WITH( MappedProgram{"test_program.bin"}, "test_program.bin is truncated" );
+        corrupt(offsetof(ProgramFileHeader, slots), uint64_t{UINT32_MAX});
+        CHECK_THROWS_WITH( MappedProgram{"test_program.bin"}, "test_program.bin has too many slots" );
+
+        size_t const code = sizeof(ProgramFileHeader) + 8 * program.initial.size() +
+            (program.initial.size() + 7) / 8 * 8;
+        corrupt(code + offsetof(Instruction, out), uint32_t{1000000});
+        CHECK_THROWS_WITH( MappedProgram{"test_program.bin"},
+            "test_program.bin: instruction 0 is out of range" );
+        corrupt(code + offsetof(Instruction, opcode), Opcode::Call);
+        CHECK_THROWS_WITH( MappedProgram{"test_program.bin"},
+            "test_program.bin: instruction 0 is out of range" );
+        std::remove("test_program.bin");
+    }
+
+    SECTION( "Mapping a large program" ) {
+        // One million instructions
+        Program program{};
+        uint32_t previous = program.add_slot(8, 1);
+        for (int i = 0; i < 1000000; ++i) {
+            uint32_t const next = program.add_slot(8);
+            program.code.push_back({Opcode::Not, 8, next, NO_SLOT, previous, previous, previous});
+            previous = next;
+        }
+        save_program(program, "test_program.bin");
+
+        BENCHMARK( "Map" ) {
+            return MappedProgram{"test_program.bin"}.get_view().code_size;
+        };
+        MappedProgram mapped{"test_program.bin"};
+        std::remove("test_program.bin");
+        CHECK( mapped.get_view().code_size == 1000000 );
+        CHECK( mapped.get_view().code[999999].a == 999999 );
+    }
+}
+
+TEST_CASE( "Word level lifting" ) {
+    // An 8 bit accumulator made of 1 bit registers and gates:
+    //   acc = acc + b          ripple carry adder of half and full adders
+    //   y = acc ^ b            bitwise
+    //   eq = (acc == b)        and tree of ~(acc ^ b)
+    vector<unique_ptr<Wire<1>>> wires{};
+    vector<unique_ptr<Component>> gates{};
+    vector<unique_ptr<Register<1>>> acc{}, b{}, y{};
+    auto wire = [&]() {
+        wires.push_back(make_unique<Wire<1>>());
+        return wires.back().get();
+    };
+    auto gate = [&](auto *g, Wire<1> *in0, Wire<1> *in1) {
+        gates.emplace_back(g);
+        in0->add_targets(&g->input[0]);
+        in1->add_targets(&g->input[1]);
+    };
+
+    vector<Wire<1>*> acc_out{}, b_out{};
+    for (int i = 0; i < 8; ++i) {
+        acc_out.push_back(wire());
+        b_out.push_back(wire());
+        acc.push_back(make_unique<Register<1>>((0x5a >> i) & 1, acc_out[i], "acc[" + to_string(i) + "]"));
+        b.push_back(make_unique<Register<1>>((0x37 >> i) & 1, b_out[i], "b[" + to_string(i) + "]"));
+        y.push_back(make_unique<Register<1>>("y[" + to_string(i) + "]"));
+    }
+
+    Wire<1> *carry = nullptr;
+    for (int i = 0; i < 8; ++i) {
+        Wire<1> *p = wire(), *g = wire();
+        gate(new XORGate<1>{p}, acc_out[i], b_out[i]);
+        gate(new ANDGate<1>{g}, acc_out[i], b_out[i]);
+        if (carry == nullptr) {
+            p->add_targets(&acc[i]->input);
+            carry = g;
+            continue;
+        }
+        Wire<1> *s = wire(), *t = wire(), *o = wire();
+        gate(new XORGate<1>{s}, p, carry);
+        gate(new ANDGate<1>{t}, p, carry);
+        gate(new ORGate<1>{o}, g, t);
+        s->add_targets(&acc[i]->input);
+        carry = o;
+    }
+    Sink<1> carry_out{"CarryOut"};
+    carry->add_targets(&carry_out.input);
+
+    Wire<1> *eq = nullptr;
+    for (int i = 0; i < 8; ++i) {
+        Wire<1> *x = wire(), *nx = wire();
+        gate(new XORGate<1>{x}, acc_out[i], b_out[i]);
+        x->add_targets(&y[i]->input);
+        gates.emplace_back(new Inverter<1>{nx});
+        x->add_targets(&static_cast<Inverter<1>*>(gates.back().get())->input);
+        if (eq == nullptr) {
+            eq = nx;
+            continue;
+        }
+        Wire<1> *next = wire();
+        gate(new ANDGate<1>{next}, eq, nx);
+        eq = next;
+    }
+    Sink<1> equal{"Equal"};
+    eq->add_targets(&equal.input);
+
+    vector<Clockable*> clockables{};
+    for (auto const *regs : {&acc, &b, &y}) {
+        for (auto const &reg : *regs) {
+            clockables.push_back(reg.get());
+        }
+    }
+    Netlist netlist{clockables};
+
+    Simulator reference{netlist};
+    Program program = compile(netlist);
+    LiftStats stats = lift_words(program);
+    CHECK( stats.adders == 1 );
+    CHECK( stats.adder_bits == 8 );
+    CHECK( stats.registers == 24 );
+    CHECK( stats.reductions == 1 );
+    // And 16 copies of registers for their nets
+    CHECK( stats.instructions_before == 8 * 5 - 3 + 8 * 2 + 7 + 16 );
+    CHECK( stats.instructions_after < 10 );
+
+    Simulator lifted{std::move(program)};
+    auto value = [](Simulator const &simulator, vector<unique_ptr<Register<1>>> const &regs) {
+        uint64_t v = 0;
+        for (size_t i = 0; i < regs.size(); ++i) {
+            v |= simulator.get_state(regs[i].get()) << i;
+        }
+        return v;
+    };
+    for (int cycle = 0; cycle < 40; ++cycle) {
+        uint64_t const before = value(lifted, acc);
+        reference.clock();
+        lifted.clock();
+        CHECK( value(lifted, acc) == ((before + 0x37) & 0xff) );
+        CHECK( value(lifted, acc) == value(reference, acc) );
+        CHECK( value(lifted, y) == value(reference, y) );
+        CHECK( lifted.get_sink(&carry_out) == reference.get_sink(&carry_out) );
+        CHECK( lifted.get_sink(&equal) == reference.get_sink(&equal) );
+        CHECK( lifted.get_raw(acc_out[3]) == reference.get_raw(acc_out[3]) );
+    }
+
+    BENCHMARK_ADVANCED("Bit level")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&reference] { return reference.clock(); });
+    };
+
+    BENCHMARK_ADVANCED("Word level")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&lifted] { return lifted.clock(); });
+    };
+
+    SECTION( "Adder<1> cells" ) {
+        // A 16 bit ripple carry adder of Adder<1>, carry out to carry in
+        vector<unique_ptr<Register<1>>> regs{};
+        vector<unique_ptr<Adder<1>>> cells{};
+        Wire<1> cin{"Cin"};
+        Constant<1> zero{0, &cin};
+        Wire<1> *carry_in = &cin;
+        for (int i = 0; i < 16; ++i) {
+            Wire<1> *out = wire(), *sum = wire(), *cout = wire();
+            regs.push_back(make_unique<Register<1>>((0xbeef >> i) & 1, out));
+            cells.push_back(make_unique<Adder<1>>(cout, sum));
+            out->add_targets({&cells[i]->A, &cells[i]->B});
+            carry_in->add_targets(&cells[i]->Cin);
+            sum->add_targets(&regs[i]->input);
+            carry_in = cout;
+        }
+        vector<Clockable*> doubled{&zero};
+        for (auto const &reg : regs) {
+            doubled.push_back(reg.get());
+        }
+        Netlist doubler{doubled};
+        Program doubling = compile(doubler);
+        LiftStats doubling_stats = lift_words(doubling);
+        CHECK( doubling_stats.adders == 1 );
+        CHECK( doubling_stats.adder_bits == 16 );
+        // The adder and a copy of the register word for the nets
+        CHECK( doubling_stats.instructions_after == 2 );
+
+        Simulator simulator{std::move(doubling)};
+        simulator.run(3);
+        CHECK( value(simulator, regs) == ((0xbeef << 3) & 0xffff) );
+    }
+}
+
+TEST_CASE( "Bit slicing" ) {
+    // 48 1 bit registers feeding 4 levels of 48 random gates each, the last
+    // level feeds the registers again
+    int const BITS = 48;
+    int const LEVELS = 4;
+    vector<unique_ptr<Wire<1>>> wires{};
+    vector<unique_ptr<Component>> gates{};
+    vector<unique_ptr<Register<1>>> regs{};
+    uint32_t seed = 1;
+    auto random = [&seed](int n) {
+        seed = seed * 1103515245 + 12345;
+        return static_cast<int>((seed >> 16) % n);
+    };
+
+    vector<Wire<1>*> level{};
+    for (int i = 0; i < BITS; ++i) {
+        wires.push_back(make_unique<Wire<1>>());
+        regs.push_back(make_unique<Register<1>>(random(2), wires.back().get()));
+        level.push_back(wires.back().get());
+    }
+    for (int l = 0; l < LEVELS; ++l) {
+        vector<Wire<1>*> next{};
+        for (int i = 0; i < BITS; ++i) {
+            wires.push_back(make_unique<Wire<1>>());
+            Wire<1> *out = wires.back().get();
+            next.push_back(out);
+            Wire<1> *in0 = level[i], *in1 = level[random(BITS)];
+            switch (random(6)) {
+            case 0: {
+                auto *g = new Inverter<1>{out};
+                gates.emplace_back(g);
+                in0->add_targets(&g->input);
+                continue;
+            }
+            case 1: gates.emplace_back(new ANDGate<1>{out}); break;
+            case 2: gates.emplace_back(new NANDGate<1>{out}); break;
+            case 3: gates.emplace_back(new ORGate<1>{out}); break;
+            case 4: gates.emplace_back(new XORGate<1>{out}); break;
+            default: gates.emplace_back(new NORGate<1>{out}); break;
+            }
+            auto *g = static_cast<SimpleComponent<1, 2>*>(gates.back().get());
+            in0->add_targets(&g->input[0]);
+            in1->add_targets(&g->input[1]);
+        }
+        level = next;
+    }
+    for (int i = 0; i < BITS; ++i) {
+        level[i]->add_targets(&regs[i]->input);
+    }
+
+    vector<Clockable*> clockables{};
+    for (auto const &reg : regs) {
+        clockables.push_back(reg.get());
+    }
+    Netlist netlist{clockables};
+    Simulator reference{netlist};
+
+    Program program = compile(netlist);
+    SliceStats stats = slice_bits(program);
+    CHECK( stats.registers == BITS );
+    // Every instruction but the copies of the registers for their nets
+    CHECK( stats.gates == static_cast<int>(reference.get_program().code.size()) - BITS );
+    CHECK( stats.words == LEVELS );
+    CHECK( stats.instructions_after < stats.instructions_before / 2 );
+    Simulator sliced{std::move(program)};
+
+    for (int cycle = 0; cycle < 50; ++cycle) {
+        reference.clock();
+        sliced.clock();
+        for (int i = 0; i < BITS; ++i) {
+            CHECK( sliced.get_state(regs[i].get()) == reference.get_state(regs[i].get()) );
+        }
+        CHECK( sliced.get_raw(level[7]) == reference.get_raw(level[7]) );
+    }
+
+    BENCHMARK_ADVANCED("1 bit instructions")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&reference] { return reference.clock(); });
+    };
+
+    BENCHMARK_ADVANCED("Bit sliced")(Catch::Benchmark::Chronometer meter) {
+        meter.measure([&sliced] { return sliced.clock(); });
+    };
+}
+
+namespace static_test {
+    using namespace static_netlist;
+    struct Count; struct Acc; struct Lfsr; struct Step; struct Low; struct Parity;
+
+    // A counter, an accumulator of an input and a 16 bit Fibonacci LFSR
+    using Example = static_netlist::Design<
+        Registers<
+            Reg<Count, 8, Add<Q<Count>, Const<8, 1>>>,
+            Reg<Acc, 16, Add<Q<Acc>, Concat<Const<8, 0>, In<Step>>>>,
+            Reg<Lfsr, 16, Concat<Slice<14, 0, Q<Lfsr>>,
+                Xor<Xor<Slice<15, 15, Q<Lfsr>>, Slice<13, 13, Q<Lfsr>>>,
+                    Xor<Slice<12, 12, Q<Lfsr>>, Slice<10, 10, Q<Lfsr>>>>>, 0xace1>>,
+        Inputs<Input<Step, 8>>,
+        Outputs<
+            Output<Low, Slice<7, 0, Q<Acc>>>,
+            Output<Parity, Carry<Q<Count>, Const<8, 0x80>>>>>;
+}
+
+TEST_CASE( "Static netlists" ) {
+    using namespace static_test;
+
+    auto lfsr = [](uint16_t v) {
+        uint16_t const bit = ((v >> 15) ^ (v >> 13) ^ (v >> 12) ^ (v >> 10)) & 1;
+        return static_cast<uint16_t>((v << 1) | bit);
+    };
+
+    SECTION( "Standalone" ) {
+        Example design{};
+        design.set_input<Step>(3);
+        uint16_t expected = 0xace1;
+        for (int i = 1; i <= 300; ++i) {
+            design.cycle();
+            expected = lfsr(expected);
+            CHECK( design.get<Count>() == (i & 0xff) );
+            CHECK( design.get<Acc>() == ((3 * i) & 0xffff) );
+            CHECK( design.get<Lfsr>() == expected );
+            CHECK( design.get_output<Parity>() == ((i & 0xff) >= 0x80) );
+        }
+        CHECK( Example::register_count == 3 );
+        CHECK( Example::output_width<Low> == 8 );
+    }
+
+    SECTION( "As a Clockable" ) {
+        // Constant -> Wire0 -> block -> Wire1 -> Register1
+        //                            -> Wire2 -> Sink
+        Wire<8> w0{"Wire0"};
+        Wire<8> w1{"Wire1"};
+        Wire<1> w2{"Wire2"};
+        Constant<8> step{5, &w0};
+        Register<8> r1{"Register1"};
+        Sink<1> sink{"Sink"};
+        StaticBlock<Example> block{"Block"};
+
+        w0.add_targets(&block.input<Step>());
+        w1.add_targets(&r1.input);
+        w2.add_targets(&sink.input);
+        block.connect<Low>(&w1);
+        block.connect<Parity>(&w2);
+        CHECK( block.get_inputs().size() == 1 );
+        CHECK( block.get_start_wires().size() == 2 );
+
+        Clock clock{0, {&step, &block, &r1}};
+        for (int i = 1; i <= 60; ++i) {
+            clock.clock();
+            CHECK( block.get_design().get<Acc>() == 5 * i );
+            CHECK( r1.get_value() == ((5 * (i - 1)) & 0xff) );
+            CHECK( sink.get_value() == ((i - 1) >= 0x80) );
+        }
+
+        // The block can be part of a Netlist, but not of a compiled one
+        Netlist netlist{&step, &block, &r1};
+        CHECK( netlist.get_endpoints().size() == 3 );
+        CHECK_THROWS( compile(netlist) );
+    }
+
+    BENCHMARK_ADVANCED("Static cycle")(Catch::Benchmark::Chronometer meter) {
+        Example design{};
+        design.set_input<Step>(1);
+        meter.measure([&design] { design.cycle(); return design.get<Lfsr>(); });
+    };
+}
+
+namespace import_test {
+
+// A 4 bit counter from Yosys, count += step and flipped = count ^ 5
+char const *const COUNTER_JSON = R"({
+  "creator": "Yosys 0.38",
+  "modules": {
+    "counter": {
+      "attributes": { "top": "00000000000000000000000000000001", "src": "counter.v:1.1-9.10" },
+      "ports": {
+        "clk": { "direction": "input", "bits": [ 2 ] },
+        "step": { "direction": "input", "bits": [ 3, 4, 5, 6 ] },
+        "count": { "direction": "output", "bits": [ 7, 8, 9, 10 ] },
+        "flipped": { "direction": "output", "bits": [ 11, 12, 13, 14 ] }
+      },
+      "cells": {
+        "$add$counter.v:6$2": {
+          "hide_name": 1,
+          "type": "$add",
+          "parameters": { "A_SIGNED": "00000000000000000000000000000000", "A_WIDTH": 4,
+                          "B_SIGNED": 0, "B_WIDTH": 4, "Y_WIDTH": "00000000000000000000000000000100" },
+          "attributes": { "src": "counter.v:6.18-6.30 \"quoted\" A" },
+          "port_directions": { "A": "input", "B": "input", "Y": "output" },
+          "connections": { "A": [ 7, 8, 9, 10 ], "B": [ 3, 4, 5, 6 ], "Y": [ 15, 16, 17, 18 ] }
+        },
+        "count": {
+          "hide_name": 0,
+          "type": "$dff",
+          "parameters": { "CLK_POLARITY": 1, "WIDTH": 4 },
+          "connections": { "CLK": [ 2 ], "D": [ 15, 16, 17, 18 ], "Q": [ 7, 8, 9, 10 ] }
+        },
+        "$xor$counter.v:7$3": {
+          "type": "$xor",
+          "parameters": { "A_WIDTH": 4, "B_WIDTH": 4, "Y_WIDTH": 4 },
+          "connections": { "A": [ 7, 8, 9, 10 ], "B": [ "1", "0", "1", "0" ], "Y": [ 11, 12, 13, 14 ] }
+        }
+      },
+      "netnames": {
+        "count": { "hide_name": 0, "bits": [ 7, 8, 9, 10 ], "attributes": { } }
+      }
+    }
+  }
+})";
+
+// A 2 bit counter with enable, written by hand
+char const *const COUNTER_BLIF = R"(# A 2 bit counter
+.model counter
+.inputs en
+.outputs q[0] q[1] odd \
+    all none
+.names en q[0] d[0]
+10 1
+01 1
+.names en q[0] c
+11 1
+.names c q[1] d[1]
+01 1
+10 1
+.names q[0] odd
+1 1
+.names en q[0] q[1] all
+111 1
+.names q[0] q[1] none
+1- 0
+-1 0
+.latch d[0] q[0] re clk 0
+.latch d[1] q[1] re clk 1
+.end
+
+.model unused
+.inputs a
+.outputs b
+.names a b
+1 1
+.end
+)";
+
+template <typename Read>
+uint64_t read_bits(std::vector<Component*> const &bits, Read read) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bits.size(); ++i) {
+        value |= read(bits[i]) << i;
+    }
+    return value;
+}
+
+}  // namespace import_test
+
+TEST_CASE( "Importing netlists" ) {
+    using namespace import_test;
+
+    SECTION( "Yosys JSON" ) {
+        std::istringstream in{COUNTER_JSON};
+        ImportedDesign design = import_yosys_json(in);
+        CHECK( design.get_stats().cells == 3 );
+        CHECK( design.get_stats().adders == 4 );
+        CHECK( design.get_stats().gates == 4 );
+        CHECK( design.get_stats().registers == 4 );
+        CHECK( design.get_stats().inputs == 5 );
+        CHECK( design.get_stats().outputs == 8 );
+        CHECK( design.get_register("count").size() == 4 );
+        CHECK_THROWS( design.get_input("count") );
+
+        Netlist netlist{design.get_clockables()};
+        Program program = compile(netlist);
+        Program lifted = compile(netlist);
+        LiftStats const stats = lift_words(lifted);
+        CHECK( stats.adders == 1 );
+        CHECK( stats.adder_bits == 4 );
+
+        Simulator bits{std::move(program)};
+        Simulator words{std::move(lifted)};
+        for (Simulator *simulator : {&bits, &words}) {
+            auto const &step = design.get_input("step");
+            for (size_t i = 0; i < step.size(); ++i) {
+                simulator->set_state(step[i], (3 >> i) & 1);
+            }
+            for (int i = 1; i <= 20; ++i) {
+                simulator->clock();
+                auto sink = [simulator](Component *c) { return simulator->get_sink(c); };
+                CHECK( read_bits(design.get_output("count"), sink) == ((3 * (i - 1)) & 0xf) );
+                CHECK( read_bits(design.get_output("flipped"), sink) == (((3 * (i - 1)) & 0xf) ^ 5) );
+            }
+        }
+
+        // The components also run on the Clock
+        Clock clock{0, design.get_clockables()};
+        design.get_input("step")[1]->set_raw_state(1);
+        for (int i = 1; i <= 20; ++i) {
+            clock.clock();
+            auto sink = [](Component *c) { return dynamic_cast<Sink<1>*>(c)->get_value().get_value(); };
+            CHECK( read_bits(design.get_output("count"), sink) == ((2 * (i - 1)) & 0xf) );
+        }
+    }
+
+    SECTION( "BLIF" ) {
+        std::istringstream in{COUNTER_BLIF};
+        ImportedDesign design = import_blif(in);
+        CHECK( design.get_stats().cells == 8 );
+        CHECK( design.get_stats().registers == 2 );
+        CHECK( design.get_output("q").size() == 2 );
+        CHECK( design.get_register("q").size() == 2 );
+        CHECK_THROWS( design.get_input("a") );
+
+        Netlist netlist{design.get_clockables()};
+        Simulator simulator{netlist};
+        auto sink = [&simulator](Component *c) { return simulator.get_sink(c); };
+        uint64_t count = 2;
+        for (int i = 0; i < 20; ++i) {
+            bool const en = (i % 3) != 0;
+            simulator.set_state(design.get_input("en")[0], en);
+            simulator.clock();
+            CHECK( read_bits(design.get_output("q"), sink) == count );
+            CHECK( read_bits(design.get_output("odd"), sink) == (count & 1) );
+            CHECK( read_bits(design.get_output("all"), sink) == (en && count == 3) );
+            CHECK( read_bits(design.get_output("none"), sink) == (count == 0) );
+            count = (count + en) & 3;
+        }
+
+        std::istringstream second{COUNTER_BLIF};
+        CHECK( import_blif(second, "unused").get_stats().cells == 1 );
+    }
+
+    SECTION( "Errors" ) {
+        std::istringstream unsupported{R"({"modules": {"m": {"cells": {"mul": {"type": "$mul", "connections": {}}}}}})"};
+        CHECK_THROWS_WITH( import_yosys_json(unsupported), "mul is a $mul cell, which can not be imported" );
+        std::istringstream twice{R"({"modules": {"m": {"cells": {
+            "a": {"type": "$_NOT_", "connections": {"A": [2], "Y": [3]}},
+            "b": {"type": "$_NOT_", "connections": {"A": [2], "Y": [3]}}}}}})"};
+        CHECK_THROWS_WITH( import_yosys_json(twice), "b drives a bit which is already driven" );
+        std::istringstream modules{R"({"modules": {"a": {}, "b": {}}})"};
+        CHECK_THROWS( import_yosys_json(modules) );
+        std::istringstream broken{R"({"modules": {"a": {"ports": [}}})"};
+        CHECK_THROWS_WITH( import_yosys_json(broken), "JSON line 1: expected '{'" );
+        std::istringstream subckt{".model m\n.subckt adder a=x\n.end\n"};
+        CHECK_THROWS( import_blif(subckt) );
+        // Not a port of 4 billion bits
+        std::istringstream wide{".model m\n.inputs x[4000000000]\n.end\n"};
+        CHECK_THROWS_WITH( import_blif(wide), Catch::Contains("x[4000000000]: a port has at most") );
+        std::istringstream wider{".model m\n.outputs y[99999999999999999999999]\n.end\n"};
+        CHECK_THROWS_WITH( import_blif(wider), Catch::Contains("a port has at most") );
+    }
+
+    SECTION( "Streaming" ) {
+        // A chain of 100000 gates
+        int const CELLS = 100000;
+        std::ostringstream text{};
+        text << R"({"modules": {"chain": {"ports": {"in": {"direction": "input", "bits": [2]}, )"
+             << R"("out": {"direction": "output", "bits": [)" << CELLS + 2 << "]}}, \"cells\": {";
+        for (int i = 0; i < CELLS; ++i) {
+            text << (i ? "," : "") << "\"g" << i << "\": {\"type\": \"$_XOR_\", \"connections\": {\"A\": ["
+                 << i + 2 << "], \"B\": [2], \"Y\": [" << i + 3 << "]}}";
+        }
+        text << "}}}}";
+        std::string const json = text.str();
+
+        BENCHMARK( "Import 100000 cells" ) {
+            std::istringstream in{json};
+            return import_yosys_json(in).get_stats().gates;
+        };
+        std::istringstream in{json};
+        ImportedDesign design = import_yosys_json(in);
+        CHECK( design.get_stats().gates == CELLS );
+
+        Netlist netlist{design.get_clockables()};
+        Simulator simulator{netlist};
+        simulator.set_state(design.get_input("in")[0], 1);
+        simulator.clock();
+        // An even number of inversions
+        CHECK( simulator.get_sink(design.get_output("out")[0]) == 1 );
+    }
+}
+
+namespace cache_test {
+
+// Acc += step, the output is Acc
+struct Accumulator {
+    explicit Accumulator(uint8_t step_value, std::string const &adder_name="Adder"):
+            step{step_value, &step_wire}, adder{&sum, adder_name} {
+        q.add_targets({&adder.A, &out.input});
+        step_wire.add_targets(&adder.B);
+        sum.add_targets(&acc.input);
+    }
+
+    Wire<8> q{"Q"};
+    Wire<8> step_wire{"Step"};
+    Wire<8> sum{"Sum"};
+    Constant<8> step;
+    Register<8> acc{&q, "Acc"};
+    Adder<8> adder;
+    Sink<8> out{"Out"};
+};
+
+// Reg += 3, with nothing else reading Reg, which a Clock can run as well
+struct Counter {
+    Counter() {
+        q.add_targets(&adder.A);
+        step_wire.add_targets(&adder.B);
+        carry.add_targets(&adder.Cin);
+        sum.add_targets(&reg.input);
+    }
+
+    Wire<8> q{"Q"};
+    Wire<8> step_wire{"Step"};
+    Wire<8> sum{"Sum"};
+    Wire<1> carry{"Carry"};
+    Register<8> reg{&q, "Reg"};
+    Constant<8> step{3, &step_wire};
+    Constant<1> cin{0, &carry};
+    Adder<8> adder{&sum, "Adder"};
+};
+
+// count Counters, and a netlist of them followed by the other clockables
+struct Counters {
+    explicit Counters(size_t count, std::vector<Clockable*> const &others={}):
+            list(count), clockables{clockables_of(list, others)}, netlist{clockables} {}
+
+    static std::vector<Clockable*> clockables_of(std::list<Counter> &list, std::vector<Clockable*> const &others) {
+        std::vector<Clockable*> clockables{};
+        for (Counter &counter : list) {
+            clockables.insert(clockables.end(), {&counter.step, &counter.cin, &counter.reg});
+        }
+        clockables.insert(clockables.end(), others.begin(), others.end());
+        return clockables;
+    }
+
+    std::list<Counter> list;
+    std::vector<Clockable*> clockables;
+    Netlist netlist;
+};
+
+}  // namespace cache_test
+
+TEST_CASE( "Schedule cache" ) {
+    using namespace cache_test;
+    std::string const directory = "test_cache";
+
+    Accumulator first{3};
+    Accumulator same{3};
+    Accumulator other_step{5};
+    Accumulator other_name{3, "Sum"};
+    Netlist netlist{&first.step, &first.acc};
+    Netlist same_netlist{&same.step, &same.acc};
+    Netlist step_netlist{&other_step.step, &other_step.acc};
+    Netlist name_netlist{&other_name.step, &other_name.acc};
+
+    uint64_t const hash = hash_netlist(netlist);
+    CHECK( hash_netlist(same_netlist) == hash );
+    CHECK( hash_netlist(step_netlist) != hash );
+    CHECK( hash_netlist(name_netlist) != hash );
+    first.step_wire.remove_target(&first.adder.B);
+    netlist.update();
+    CHECK( hash_netlist(netlist) != hash );
+    first.step_wire.add_target(&first.adder.B);
+    netlist.update();
+    CHECK( hash_netlist(netlist) == hash );
+
+    std::filesystem::remove_all(directory);
+    ScheduleCache cache{directory};
+    auto run = [](std::shared_ptr<MappedProgram const> const &mapped, int cycles) {
+        Simulator simulator{mapped};
+        simulator.run(cycles);
+        return simulator.read(mapped->find("Acc", NamedLocation::State));
+    };
+
+    SECTION( "Hits and misses" ) {
+        auto mapped = cache.load(netlist);
+        CHECK( cache.get_stats().misses == 1 );
+        CHECK( run(mapped, 10) == 30 );
+
+        CHECK( run(cache.load(same_netlist), 10) == 30 );
+        CHECK( cache.get_stats().hits == 1 );
+        CHECK( run(cache.load(step_netlist), 10) == 50 );
+        CHECK( cache.get_stats().misses == 2 );
+
+        // A new cache finds the files of the old one
+        ScheduleCache again{directory};
+        again.load(netlist);
+        again.load(step_netlist);
+        CHECK( again.get_stats().hits == 2 );
+        CHECK( again.get_stats().misses == 0 );
+
+        // Optimized programs are cached apart
+        int passes = 0;
+        auto optimize = [&passes](Program &) { passes += 1; };
+        cache.load(netlist, optimize, "v1");
+        cache.load(netlist, optimize, "v1");
+        cache.load(netlist, optimize, "v2");
+        CHECK( passes == 2 );
+    }
+
+    SECTION( "Broken files are made again" ) {
+        std::string const path = cache.get_path(cache.load(netlist)->get_header().key);
+        CHECK( std::filesystem::exists(path) );
+        std::FILE *file = std::fopen(path.c_str(), "r+b");
+        REQUIRE( file != nullptr );
+        std::fputs("broken", file);
+        std::fclose(file);
+
+        ScheduleCache again{directory};
+        CHECK( run(again.load(netlist), 4) == 12 );
+        CHECK( again.get_stats().misses == 1 );
+        CHECK( again.get_stats().hits == 0 );
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+namespace parallel_test {
+
+// Copies of Acc += step, all adding the same step
+struct Copies {
+    Copies(size_t copies, unsigned threads): build{threads} {
+        build.build(copies, [this](size_t copy, BuildBatch &batch) {
+            auto *q = batch.make<Wire<8>>("Q");
+            auto *sum = batch.make<Wire<8>>("Sum");
+            auto *acc = batch.make_clockable<Register<8>>(BitVector<8>{static_cast<T<8>>(copy)}, q, "Acc");
+            auto *adder = batch.make<Adder<8>>(sum, "Adder");
+            auto *out = batch.make<Sink<8>>("Out");
+            q->add_targets({&adder->A, &out->input});
+            sum->add_targets(&acc->input);
+            batch.connect(&step_wire, &adder->B);
+        });
+        clockables = build.get_clockables();
+        clockables.push_back(&step);
+    }
+
+    Wire<8> step_wire{"Step"};
+    Constant<8> step{3, &step_wire};
+    ParallelBuild build;
+    std::vector<Clockable*> clockables{};
+};
+
+}  // namespace parallel_test
+
+TEST_CASE( "Parallel elaboration" ) {
+    using namespace parallel_test;
+    size_t const COPIES = 50000;
+
+    Copies serial{COPIES, 1};
+    Copies parallel{COPIES, 4};
+    CHECK( parallel.build.get_object_count() == 5 * COPIES );
+    CHECK( parallel.step_wire.get_targets().size() == COPIES );
+
+    Netlist serial_netlist{serial.clockables, 1};
+    Netlist parallel_netlist{parallel.clockables, 4};
+    Netlist mixed_netlist{serial.clockables, 4};
+    CHECK( serial_netlist.get_components().size() == COPIES );
+    CHECK( serial_netlist.get_endpoints().size() == 2 * COPIES );
+    CHECK( serial_netlist.get_nets().size() == 2 * COPIES + 1 );
+
+    // The order does not depend on the threads
+    CHECK( mixed_netlist.get_nets() == serial_netlist.get_nets() );
+    CHECK( mixed_netlist.get_components() == serial_netlist.get_components() );
+    CHECK( mixed_netlist.get_endpoints() == serial_netlist.get_endpoints() );
+    CHECK( hash_netlist(parallel_netlist) == hash_netlist(serial_netlist) );
+    for (Component *component : serial_netlist.get_components()) {
+        REQUIRE( mixed_netlist.get_level(component) == 1 );
+    }
+
+    Simulator simulator{parallel_netlist};
+    simulator.run(2);
+    for (size_t copy : {size_t{0}, size_t{1}, COPIES / 2, COPIES - 1}) {
+        CHECK( simulator.get_state(parallel.clockables[copy]) == ((copy + 6) & 0xff) );
+    }
+
+    SECTION( "Loops" ) {
+        Wire<8> a{"A"}, b{"B"}, c{"C"};
+        Constant<8> constant{1, &a};
+        XORGate<8> first{&b, "First"};
+        XORGate<8> second{&c, "Second"};
+        a.add_targets(&first.input[0]);
+        b.add_targets(&second.input[0]);
+        c.add_targets(&first.input[1]);
+        a.add_targets(&second.input[1]);
+        CHECK_THROWS_WITH( (Netlist{{&constant}, 4}), Catch::Contains("combinational loop") );
+        CHECK_THROWS_WITH( (Netlist{{&constant}, 1}), Catch::Contains("combinational loop") );
+    }
+
+    BENCHMARK( "Netlist, 1 thread" ) {
+        return Netlist{serial.clockables, 1}.get_nets().size();
+    };
+    BENCHMARK( "Netlist, 4 threads" ) {
+        return Netlist{serial.clockables, 4}.get_nets().size();
+    };
+    BENCHMARK( "Build, 1 thread" ) {
+        return Copies{COPIES, 1}.clockables.size();
+    };
+    BENCHMARK( "Build, 4 threads" ) {
+        return Copies{COPIES, 4}.clockables.size();
+    };
+}
+
+TEST_CASE( "Checkpoints" ) {
+    using namespace cache_test;
+    // The first accumulator counts, the others stay at 0
+    std::list<Accumulator> accumulators{};
+    std::vector<Clockable*> clockables{};
+    for (int i = 0; i < 2000; ++i) {
+        accumulators.emplace_back((i == 0) ? 3 : 0);
+        clockables.push_back(&accumulators.back().step);
+        clockables.push_back(&accumulators.back().acc);
+    }
+    Register<8> const *counter = &accumulators.front().acc;
+    Netlist netlist{clockables};
+    Simulator simulator{netlist};
+    Checkpointer checkpoints{simulator};
+
+    CHECK_THROWS_WITH( checkpoints.save_delta("test_delta.ckpt"), Catch::Contains("needs a checkpoint") );
+    simulator.run(10);
+    checkpoints.save("test_full.ckpt");
+    uint64_t const full_bytes = checkpoints.get_saved_bytes();
+    simulator.run(5);
+    checkpoints.save_delta("test_delta_1.ckpt");
+    CHECK( checkpoints.get_saved_bytes() < full_bytes / 10 );
+    simulator.run(7);
+    checkpoints.save_delta("test_delta_2.ckpt");
+    CHECK( simulator.get_state(counter) == 66 );
+
+    SECTION( "Restore" ) {
+        Simulator other{netlist};
+        Checkpointer other_checkpoints{other};
+        other_checkpoints.restore({"test_full.ckpt"});
+        CHECK( other.get_cycle() == 10 );
+        CHECK( other.get_state(counter) == 30 );
+        other_checkpoints.restore({"test_full.ckpt", "test_delta_1.ckpt", "test_delta_2.ckpt"});
+        CHECK( other.get_cycle() == 22 );
+        CHECK( other.get_state(counter) == 66 );
+        other.run(3);
+        simulator.run(3);
+        CHECK( other.get_state(counter) == simulator.get_state(counter) );
+
+        // Go back to an earlier state, and make deltas from there
+        checkpoints.restore({"test_full.ckpt", "test_delta_1.ckpt"});
+        CHECK( simulator.get_cycle() == 15 );
+        CHECK( simulator.get_state(counter) == 45 );
+        simulator.run(1);
+        checkpoints.save_delta("test_delta_3.ckpt");
+        other_checkpoints.restore({"test_full.ckpt", "test_delta_1.ckpt", "test_delta_3.ckpt"});
+        CHECK( other.get_state(counter) == 48 );
+    }
+
+    SECTION( "Errors" ) {
+        Checkpointer other{simulator};
+        CHECK_THROWS_WITH( other.restore({"test_delta_1.ckpt"}), Catch::Contains("is a delta") );
+        CHECK_THROWS_WITH( other.restore({"test_full.ckpt", "test_delta_2.ckpt"}),
+            Catch::Contains("not a delta of cycle 10") );
+        CHECK_THROWS_WITH( other.restore({"test_missing.ckpt"}), Catch::Contains("can not be opened") );
+
+        Accumulator single{3};
+        Netlist single_netlist{&single.step, &single.acc};
+        Simulator single_simulator{single_netlist};
+        CHECK_THROWS_WITH( Checkpointer{single_simulator}.restore({"test_full.ckpt"}),
+            Catch::Contains("another program") );
+
+        // A failed restore changes nothing
+        CHECK( simulator.get_cycle() == 22 );
+        CHECK( simulator.get_state(counter) == 66 );
+    }
+
+    SECTION( "Deltas of another run" ) {
+        // A run from cycle 15 with another state, its deltas have the same
+        // base cycles as those of the first run
+        checkpoints.restore({"test_full.ckpt", "test_delta_1.ckpt"});
+        simulator.set_state(counter, 0);
+        simulator.run(7);
+        checkpoints.save_delta("test_delta_4.ckpt");
+        simulator.run(1);
+        checkpoints.save_delta("test_delta_5.ckpt");
+
+        Simulator other{netlist};
+        Checkpointer other_checkpoints{other};
+        CHECK_THROWS_WITH( other_checkpoints.restore({"test_full.ckpt", "test_delta_1.ckpt", "test_delta_2.ckpt",
+            "test_delta_5.ckpt"}), Catch::Contains("another checkpoint of cycle 22") );
+        other_checkpoints.restore({"test_full.ckpt", "test_delta_1.ckpt", "test_delta_4.ckpt", "test_delta_5.ckpt"});
+        CHECK( other.get_cycle() == 23 );
+        CHECK( other.get_state(counter) == 24 );
+    }
+
+    // A design of 1 million slots, 8 MB
+    Program large{};
+    large.initial.assign(1 << 20, 1);
+    large.widths.assign(1 << 20, 64);
+    Simulator large_simulator{large};
+    Checkpointer large_checkpoints{large_simulator};
+    large_checkpoints.save("test_large.ckpt");
+    BENCHMARK( "Save 8 MB" ) {
+        large_checkpoints.save("test_large.ckpt");
+    };
+    BENCHMARK( "Save an unchanged delta of 8 MB" ) {
+        large_checkpoints.save_delta("test_large_delta.ckpt");
+    };
+    BENCHMARK( "Restore 8 MB" ) {
+        large_checkpoints.restore({"test_large.ckpt"});
+    };
+
+    for (std::string const name : {"full", "delta_1", "delta_2", "delta_3", "delta_4", "delta_5", "large", "large_delta"}) {
+        std::filesystem::remove("test_" + name + ".ckpt");
+    }
+}
+
+TEST_CASE( "Forked simulations" ) {
+    using namespace cache_test;
+    Accumulator accumulator{3};
+    Netlist netlist{&accumulator.step, &accumulator.acc};
+    Simulator simulator{netlist};
+    simulator.run(10);
+
+    SECTION( "Fork" ) {
+        std::unique_ptr<Simulator> fork = simulator.fork();
+        CHECK( &fork->get_program() == &simulator.get_program() );
+        CHECK( fork->get_cycle() == 10 );
+        CHECK( fork->get_state(&accumulator.acc) == 30 );
+        fork->set_state(&accumulator.acc, 100);
+        fork->run(2);
+        CHECK( fork->get_state(&accumulator.acc) == 106 );
+        CHECK( simulator.get_state(&accumulator.acc) == 30 );
+        simulator.run(1);
+        CHECK( simulator.get_state(&accumulator.acc) == 33 );
+        CHECK( fork->get_cycle() == 12 );
+    }
+
+    SECTION( "Branches" ) {
+        std::vector<uint64_t> results(16);
+        run_forks(simulator, results.size(), 4, [&](size_t branch, Simulator &fork) {
+            fork.set_state(&accumulator.acc, branch * 10);
+            fork.run(5);
+            results[branch] = fork.get_state(&accumulator.acc);
+        });
+        for (size_t branch = 0; branch < results.size(); ++branch) {
+            CHECK( results[branch] == ((branch * 10 + 15) & 0xff) );
+        }
+        CHECK( simulator.get_cycle() == 10 );
+    }
+
+    SECTION( "Mapped programs" ) {
+        save_program(simulator.get_program(), "test_fork.prog");
+        Simulator mapped{std::make_shared<MappedProgram const>("test_fork.prog")};
+        mapped.run(4);
+        std::unique_ptr<Simulator> fork = mapped.fork();
+        fork->run(4);
+        CHECK( fork->get_cycle() == 8 );
+        std::filesystem::remove("test_fork.prog");
+    }
+
+    // A design of 1 million slots, 8 MB
+    Program large{};
+    large.initial.assign(1 << 20, 1);
+    large.widths.assign(1 << 20, 64);
+    Simulator large_simulator{large};
+    BENCHMARK( "Fork 8 MB" ) {
+        return large_simulator.fork()->get_cycle();
+    };
+}
+
+TEST_CASE( "Shared programs" ) {
+    using namespace cache_test;
+
+    SECTION( "Runs on several threads" ) {
+        Accumulator accumulator{3};
+        Netlist netlist{&accumulator.step, &accumulator.acc};
+        auto program = std::make_shared<Program const>(compile(netlist));
+        REQUIRE( is_shareable(*program) );
+
+        std::vector<uint64_t> results(8);
+        parallel_tasks(results.size(), 4, [&](size_t run) {
+            Simulator simulator{program};
+            simulator.set_state(&accumulator.acc, run);
+            simulator.run(100);
+            results[run] = simulator.get_state(&accumulator.acc);
+            CHECK( simulator.get_shared_program() == program );
+        });
+        for (size_t run = 0; run < results.size(); ++run) {
+            CHECK( results[run] == ((run + 300) & 0xff) );
+        }
+        // The design itself is not changed by any run
+        CHECK( accumulator.acc.get_value() == 0 );
+    }
+
+    SECTION( "Calls" ) {
+        Counter fused{};
+        Netlist fused_netlist{&fused.reg, &fused.step, &fused.cin};
+        REQUIRE( fuse_feedback_registers(fused_netlist).counters == 1 );
+        Program fused_program = compile(fused_netlist);
+        CHECK( !fused_program.calls.empty() );
+        CHECK( is_shareable(fused_program) );
+
+        Counter memoized{};
+        Netlist memoized_netlist{&memoized.reg, &memoized.step, &memoized.cin};
+        MemoOptions options{};
+        options.min_components = 1;
+        REQUIRE( memoize_cones(memoized_netlist, options).size() == 1 );
+        CHECK( !is_shareable(compile(memoized_netlist)) );
+    }
+}
+
+TEST_CASE( "Regression farm" ) {
+    using namespace cache_test;
+    Accumulator accumulator{3};
+    Netlist netlist{&accumulator.step, &accumulator.acc};
+    Simulator start{netlist};
+    start.run(2);
+
+    // Job i starts the accumulator at i and runs i % 50 cycles
+    size_t const JOBS = 1000;
+    auto job = [&](size_t index, Simulator &simulator) {
+        simulator.set_state(&accumulator.acc, index);
+        simulator.run(index % 50);
+        return simulator.get_state(&accumulator.acc);
+    };
+    uint64_t expected_cycles = 0;
+    for (size_t index = 0; index < JOBS; ++index) {
+        expected_cycles += index % 50;
+    }
+
+    for (unsigned threads : {1u, 4u}) {
+        FarmOptions options{};
+        options.threads = threads;
+        Farm farm{start, options};
+        std::vector<uint64_t> results(JOBS, UINT64_MAX);
+        size_t reports = 0;
+        FarmStats const stats = farm.run(JOBS, job, [&](size_t index, uint64_t result) {
+            results[index] = result;
+            ++reports;
+        });
+        CHECK( stats.jobs == JOBS );
+        CHECK( stats.threads == threads );
+        CHECK( stats.cycles == expected_cycles );
+        CHECK( reports == JOBS );
+        for (size_t index = 0; index < JOBS; ++index) {
+            CHECK( results[index] == ((index + 3 * (index % 50)) & 0xff) );
+        }
+    }
+    // Jobs start from the state of the start Simulator
+    CHECK( start.get_cycle() == 2 );
+
+    SECTION( "Uneven jobs are stolen" ) {
+        FarmOptions options{};
+        options.threads = 4;
+        options.pin = false;
+        Farm farm{start, options};
+        // The jobs of the first thread are far longer
+        FarmStats const stats = farm.run_jobs(400, [](size_t index, Simulator &simulator) {
+            simulator.run((index < 100) ? 2000 : 1);
+        });
+        CHECK( stats.cycles == 100 * 2000 + 300 );
+        if (std::thread::hardware_concurrency() > 1)
+            CHECK( stats.steals > 0 );
+    }
+
+    SECTION( "Errors are passed on" ) {
+        Farm farm{start};
+        CHECK_THROWS_WITH( farm.run_jobs(100, [](size_t index, Simulator &) {
+            if (index == 42)
+                throw std::runtime_error("Job 42 failed");
+        }), "Job 42 failed" );
+    }
+
+    BENCHMARK( "1000 jobs of 1000 cycles, 1 thread" ) {
+        FarmOptions options{};
+        options.threads = 1;
+        return Farm{start, options}.run_jobs(1000, [](size_t, Simulator &s) { s.run(1000); }).cycles;
+    };
+    BENCHMARK( "1000 jobs of 1000 cycles, one thread per core" ) {
+        return Farm{start}.run_jobs(1000, [](size_t, Simulator &s) { s.run(1000); }).cycles;
+    };
+}
+
+TEST_CASE( "Waveforms" ) {
+    using namespace cache_test;
+    auto read_file = [](std::string const &path) {
+        std::ifstream file{path};
+        std::stringstream text{};
+        text << file.rdbuf();
+        return text.str();
+    };
+    std::string const header =
+        "$timescale 1ns $end\n"
+        "$scope module top $end\n"
+        "$var wire 8 ! Q $end\n"
+        "$var wire 8 \" Sum $end\n"
+        "$upscope $end\n"
+        "$enddefinitions $end\n";
+
+    SECTION( "Clock" ) {
+        Counter accumulator{};
+        Clock clock{1, {&accumulator.step, &accumulator.cin, &accumulator.reg}};
+        TraceWriter writer{};
+        Trace trace{writer, "test_trace.vcd"};
+        trace.add(&accumulator.q);
+        trace.add(&accumulator.sum);
+        for (uint64_t cycle = 0; cycle < 3; ++cycle) {
+            clock.clock();
+            trace.sample(cycle);
+        }
+        // Nothing changed
+        trace.sample(3);
+        CHECK_THROWS_WITH( trace.add(&accumulator.step_wire), Catch::Contains("before the first sample") );
+        trace.close();
+        CHECK( trace.get_stats().samples == 4 );
+        CHECK( trace.get_stats().changes == 6 );
+        CHECK( read_file("test_trace.vcd") == header +
+            "#0\nb0 !\nb11 \"\n#1\nb11 !\nb110 \"\n#2\nb110 !\nb1001 \"\n" );
+    }
+
+    SECTION( "Simulator" ) {
+        Accumulator accumulator{3};
+        Netlist netlist{&accumulator.step, &accumulator.acc};
+        Simulator simulator{netlist};
+        TraceWriter writer{};
+        Trace trace{writer, "test_trace.vcd"};
+        trace.add(simulator, &accumulator.q);
+        trace.add("Sum", 8, simulator.get_program().net_slots.at(&accumulator.sum));
+        CHECK_THROWS_WITH( trace.add(&accumulator.step_wire), Catch::Contains("not both") );
+        CHECK_THROWS_WITH( trace.sample(0), Catch::Contains("trace of a Simulator") );
+        // The net of the register has the value of the cycle, as on a Clock
+        for (int cycle = 0; cycle < 2; ++cycle) {
+            simulator.clock();
+            trace.sample(simulator);
+        }
+        trace.close();
+        CHECK( read_file("test_trace.vcd") == header + "#1\nb0 !\nb11 \"\n#2\nb11 !\nb110 \"\n" );
+    }
+
+    SECTION( "Several traces and a small ring" ) {
+        Accumulator first{1};
+        Accumulator second{2};
+        Netlist first_netlist{&first.step, &first.acc};
+        Netlist second_netlist{&second.step, &second.acc};
+        TraceWriter writer{};
+        std::vector<uint64_t> stalls(2);
+        parallel_tasks(2, 2, [&](size_t run) {
+            Accumulator &accumulator = (run == 0) ? first : second;
+            Simulator simulator{(run == 0) ? first_netlist : second_netlist};
+            Trace trace{writer, "test_trace_" + std::to_string(run) + ".vcd", TraceFormat::Vcd, 16};
+            trace.add(simulator, &accumulator.sum);
+            simulator.run(1000);
+            for (int cycle = 0; cycle < 1000; ++cycle) {
+                simulator.clock();
+                trace.sample(simulator);
+            }
+        });
+        for (int run = 0; run < 2; ++run) {
+            std::string const text = read_file("test_trace_" + std::to_string(run) + ".vcd");
+            CHECK( std::count(text.begin(), text.end(), '#') == 1000 );
+            std::remove(("test_trace_" + std::to_string(run) + ".vcd").c_str());
+        }
+    }
+    std::remove("test_trace.vcd");
+
+    SECTION( "Overhead" ) {
+        // Every net traced, the nets of the registers and adders change in every
+        // cycle
+        Counters counters{1000};
+        Clock clock{1, counters.clockables};
+        Simulator simulator{counters.netlist};
+        TraceWriter writer{};
+        BENCHMARK( "Clock, 1000 counters, 100 cycles" ) {
+            for (int i = 0; i < 100; ++i) {
+                clock.clock();
+            }
+        };
+        BENCHMARK( "Clock, 1000 counters, 100 cycles, traced" ) {
+            Trace trace{writer, "test_trace.vcd"};
+            for (Net *net : counters.netlist.get_nets()) {
+                trace.add(net);
+            }
+            for (int i = 0; i < 100; ++i) {
+                clock.clock();
+                trace.sample(i);
+            }
+            return trace.get_stats().stalls;
+        };
+        BENCHMARK( "Simulator, 1000 counters, 100 cycles" ) {
+            simulator.run(100);
+        };
+        BENCHMARK( "Simulator, 1000 counters, 100 cycles, traced" ) {
+            Trace trace{writer, "test_trace.vcd"};
+            for (Net *net : counters.netlist.get_nets()) {
+                trace.add(simulator, net);
+            }
+            for (int i = 0; i < 100; ++i) {
+                simulator.clock();
+                trace.sample(simulator);
+            }
+            return trace.get_stats().stalls;
+        };
+    }
+    std::remove("test_trace.vcd");
+}
+
+TEST_CASE( "Compressed waveforms" ) {
+    SECTION( "Blocks and random access" ) {
+        // A counter, a signal with few values and one of random values
+        std::vector<uint64_t> random(20000);
+        std::mt19937_64 generator{7};
+        for (uint64_t &value : random) {
+            value = generator();
+        }
+        {
+            WaveWriter writer{"test_waves.bin", 2};
+            uint32_t const count = writer.add_signal("Count", 32);
+            uint32_t const state = writer.add_signal("State", 2);
+            uint32_t const noise = writer.add_signal("Noise", 64);
+            CHECK( writer.add_signal("Idle", 1) == 3 );
+            for (uint64_t time = 0; time < 20000; ++time) {
+                writer.add_change(count, 2 * time, time);
+                writer.add_change(noise, 2 * time + 1, random[time]);
+                if (time % 7 == 0)
+                    writer.add_change(state, 2 * time, time % 4);
+            }
+            // The last change at a time counts
+            writer.add_change(count, 40000, 1);
+            writer.add_change(count, 40000, 2);
+            CHECK_THROWS_WITH( writer.add_change(count, 10, 0), Catch::Contains("back in time") );
+            CHECK_THROWS_WITH( writer.add_signal("Late", 1), Catch::Contains("before the first change") );
+            writer.close();
+            CHECK( writer.get_stats().changes == 20000 + 20001 + 2858 );
+            CHECK( writer.get_stats().blocks > 10 );
+        }
+
+        MappedWaves waves{"test_waves.bin"};
+        CHECK( waves.get_signal_count() == 4 );
+        uint32_t const count = waves.find("Count");
+        uint32_t const state = waves.find("State");
+        uint32_t const noise = waves.find("Noise");
+        CHECK( waves.get_name(noise) == "Noise" );
+        CHECK( waves.get_width(state) == 2 );
+        CHECK_THROWS_WITH( waves.find("Nothing"), Catch::Contains("Nothing is not in") );
+        CHECK_THROWS_WITH( waves.get_value(count + 3, 0), Catch::Contains("has no value") );
+        CHECK_THROWS_WITH( waves.get_value(noise, 0), Catch::Contains("has no value") );
+        CHECK_THROWS_WITH( waves.get_value(9, 0), Catch::Contains("no signal 9") );
+
+        std::mt19937_64 times{3};
+        bool same = true;
+        for (int i = 0; i < 1000; ++i) {
+            uint64_t const time = times() % 40000;
+            same = same && waves.get_value(count, time) == time / 2;
+            same = same && waves.get_value(state, time) == (time / 2 / 7 * 7) % 4;
+            if (time > 0)
+                same = same && waves.get_value(noise, time) == random[(time - 1) / 2];
+        }
+        CHECK( same );
+        CHECK( waves.get_value(count, 50000) == 2 );
+
+        auto const changes = waves.get_changes(noise);
+        REQUIRE( changes.size() == 20000 );
+        CHECK( changes[12345] == std::make_pair(uint64_t{24691}, random[12345]) );
+    }
+
+    SECTION( "Traces" ) {
+        cache_test::Counters counters{100};
+        Simulator simulator{counters.netlist};
+        {
+            TraceWriter writer{};
+            Trace vcd{writer, "test_waves.vcd"};
+            Trace compressed{writer, "test_waves.bin", TraceFormat::Waves};
+            for (cache_test::Counter &counter : counters.list) {
+                vcd.add(simulator, &counter.q);
+                compressed.add(simulator, &counter.q);
+            }
+            for (int i = 0; i < 2000; ++i) {
+                simulator.clock();
+                vcd.sample(simulator);
+                compressed.sample(simulator);
+            }
+        }
+        MappedWaves waves{"test_waves.bin"};
+        // Sampled after the cycle, Q is 0 in the first
+        CHECK( waves.get_value(0, 1) == 0 );
+        CHECK( waves.get_value(0, 2) == 3 );
+        CHECK( waves.get_value(99, 1000) == (3 * 999) % 256 );
+        std::ifstream vcd{"test_waves.vcd", std::ios::ate};
+        std::ifstream compressed{"test_waves.bin", std::ios::ate};
+        // The values of a counter repeat, they are in a dictionary
+        CHECK( 10 * compressed.tellg() < vcd.tellg() );
+        std::remove("test_waves.vcd");
+    }
+
+    SECTION( "Not a wave file" ) {
+        { std::ofstream file{"test_waves.bin"}; file << "HWCKPT and more bytes than a header has"; }
+        CHECK_THROWS_WITH( MappedWaves{"test_waves.bin"}, Catch::Contains("not a wave file") );
+        CHECK_THROWS_WITH( MappedWaves{"test_waves_missing.bin"}, Catch::Contains("can not be opened") );
+    }
+
+    SECTION( "Broken wave files" ) {
+        {
+            WaveWriter writer{"test_waves.bin", 1};
+            uint32_t const signal = writer.add_signal("Q", 8);
+            for (uint64_t time = 0; time < 3000; ++time) {
+                writer.add_change(signal, time, time % 256);
+            }
+        }
+        WaveFileHeader header{};
+        {
+            std::ifstream file{"test_waves.bin", std::ios::binary};
+            file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        }
+        // Overwrite a value at offset of the file
+        auto corrupt = [](size_t offset, uint64_t value) {
+            std::fstream file{"test_waves.bin", std::ios::binary | std::ios::in | std::ios::out};
+            file.seekp(offset);
+            file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+        };
+        size_t const first_block = header.signals_offset + offsetof(WaveSignal, first_block);
+        corrupt(first_block, 2);
+        CHECK_THROWS_WITH( MappedWaves{"test_waves.bin"}, Catch::Contains("has a broken signal 0") );
+        corrupt(first_block, 0);
+        CHECK( MappedWaves{"test_waves.bin"}.get_value(0, 2999) == 2999 % 256 );
+        // A block which claims to be 4 GB when decompressed
+        WaveBlock block{};
+        {
+            std::ifstream file{"test_waves.bin", std::ios::binary};
+            file.seekg(header.index_offset);
+            file.read(reinterpret_cast<char*>(&block), sizeof(block));
+        }
+        size_t const sizes = header.index_offset + offsetof(WaveBlock, size);
+        corrupt(sizes, (uint64_t{0xfffffff0} << 32) | block.size);
+        CHECK_THROWS_WITH( MappedWaves{"test_waves.bin"}.get_value(0, 0), Catch::Contains("has a broken block") );
+        corrupt(sizes, (uint64_t{block.raw_size} << 32) | block.size);
+        CHECK( MappedWaves{"test_waves.bin"}.get_value(0, 0) == 0 );
+        // block_count * sizeof(WaveBlock) wraps to 32
+        corrupt(offsetof(WaveFileHeader, block_count), (uint64_t{1} << 59) + 1);
+        CHECK_THROWS_WITH( MappedWaves{"test_waves.bin"}, Catch::Contains("is truncated") );
+        std::remove("test_waves.bin");
+    }
+
+    SECTION( "Speed" ) {
+        std::vector<uint64_t> values(1 << 16);
+        std::mt19937_64 generator{11};
+        for (uint64_t &value : values) {
+            value = generator() % 1000;
+        }
+        BENCHMARK( "Write 16 signals of 64K changes" ) {
+            WaveWriter writer{"test_waves.bin"};
+            for (int signal = 0; signal < 16; ++signal) {
+                writer.add_signal("S" + std::to_string(signal), 16);
+            }
+            for (uint64_t time = 0; time < values.size(); ++time) {
+                for (uint32_t signal = 0; signal < 16; ++signal) {
+                    writer.add_change(signal, time, values[(time + signal) % values.size()]);
+                }
+            }
+            writer.close();
+            return writer.get_stats().compressed_bytes;
+        };
+        MappedWaves waves{"test_waves.bin"};
+        std::vector<uint64_t> times(1000);
+        for (uint64_t &time : times) {
+            time = generator() % values.size();
+        }
+        BENCHMARK( "1000 random reads" ) {
+            uint64_t sum = 0;
+            for (uint64_t time : times) {
+                sum += waves.get_value(static_cast<uint32_t>(time % 16), time);
+            }
+            return sum;
+        };
+    }
+    std::remove("test_waves.bin");
+}
+
+TEST_CASE( "Register-only tracing" ) {
+    using namespace cache_test;
+    Accumulator accumulator{1};
+    Counters counters{100, {&accumulator.step, &accumulator.acc}};
+    Simulator simulator{counters.netlist};
+    Program const &program = simulator.get_program();
+    std::vector<bool> computed(program.initial.size(), false);
+    for (Instruction const &ins : program.code) {
+        for (uint32_t slot : writes(program, ins)) {
+            computed[slot] = true;
+        }
+    }
+
+    SECTION( "Every net in every cycle" ) {
+        RegisterTrace trace{simulator};
+        // The values the simulator had in every cycle, computed values are
+        // read after clock(), the others before
+        std::vector<std::vector<uint64_t>> expected{};
+        Location const step = program.net_slots.at(&accumulator.step_wire);
+        for (uint64_t cycle = 0; cycle < 50; ++cycle) {
+            simulator.write(step, cycle % 5);
+            trace.sample(simulator);
+            std::vector<uint64_t> before{};
+            for (Net *net : counters.netlist.get_nets()) {
+                before.push_back(simulator.get_raw(net));
+            }
+            simulator.clock();
+            std::vector<uint64_t> values{};
+            for (size_t i = 0; i < counters.netlist.get_nets().size(); ++i) {
+                Net const *net = counters.netlist.get_nets()[i];
+                values.push_back(computed[program.net_slots.at(net).slot] ? simulator.get_raw(net) : before[i]);
+            }
+            expected.push_back(values);
+        }
+        bool same = true;
+        for (uint64_t cycle = 50; cycle-- > 0;) {
+            for (size_t i = 0; i < counters.netlist.get_nets().size(); ++i) {
+                same = same && trace.get_raw(counters.netlist.get_nets()[i], cycle) == expected[cycle][i];
+            }
+        }
+        CHECK( same );
+        CHECK( trace.get_raw(&accumulator.step_wire, 7) == 2 );
+        CHECK( trace.get_stats().samples == 50 );
+        // The state, the constants and the input of the accumulator
+        CHECK( trace.get_stats().roots == 3 * 100 + 3 );
+        CHECK_THROWS_WITH( trace.get_raw(&accumulator.sum, 50), Catch::Contains("not sampled") );
+    }
+
+    SECTION( "Errors" ) {
+        RegisterTrace trace{simulator};
+        simulator.clock();
+        trace.sample(simulator);
+        simulator.run(2);
+        CHECK_THROWS_WITH( trace.sample(simulator), Catch::Contains("expected cycle 2 not 3") );
+        Simulator other{counters.netlist};
+        CHECK_THROWS_WITH( trace.sample(other), Catch::Contains("its own program") );
+        Wire<1> outside{"Outside"};
+        CHECK_THROWS_WITH( trace.get_raw(&outside, 1), Catch::Contains("Outside is not in") );
+        CHECK_THROWS_WITH( trace.get_raw(&accumulator.sum, 0), Catch::Contains("Cycle 0 was not sampled") );
+    }
+
+    SECTION( "Cost" ) {
+        Counters many{1000};
+        Simulator many_simulator{many.netlist};
+        TraceWriter writer{};
+        BENCHMARK( "Simulator, 1000 counters, 100 cycles, every net traced" ) {
+            Trace trace{writer, "test_trace.vcd"};
+            for (Net *net : many.netlist.get_nets()) {
+                trace.add(many_simulator, net);
+            }
+            for (int i = 0; i < 100; ++i) {
+                many_simulator.clock();
+                trace.sample(many_simulator);
+            }
+            return trace.get_stats().stalls;
+        };
+        BENCHMARK( "Simulator, 1000 counters, 100 cycles, registers traced" ) {
+            RegisterTrace trace{many_simulator};
+            for (int i = 0; i < 100; ++i) {
+                trace.sample(many_simulator);
+                many_simulator.clock();
+            }
+            return trace.get_stats().changes;
+        };
+        RegisterTrace trace{many_simulator};
+        for (int i = 0; i < 100; ++i) {
+            trace.sample(many_simulator);
+            many_simulator.clock();
+        }
+        uint64_t const first = many_simulator.get_cycle() - 100;
+        BENCHMARK( "Reconstruct 1000 sums" ) {
+            uint64_t total = 0;
+            uint64_t offset = 0;
+            for (Counter &counter : many.list) {
+                total += trace.get_raw(&counter.sum, first + offset);
+                offset = (offset + 37) % 100;
+            }
+            return total;
+        };
+        std::remove("test_trace.vcd");
+    }
+}
+
+TEST_CASE( "Probes" ) {
+    using namespace cache_test;
+    auto cycles = [](std::vector<ProbeSample> const &samples) {
+        std::vector<uint64_t> sampled{};
+        for (ProbeSample const &sample : samples) {
+            sampled.push_back(sample.cycle);
+        }
+        return sampled;
+    };
+
+    SECTION( "Clock" ) {
+        Counter counter{};
+        Sink<8> sink{"Out"};
+        counter.sum.add_targets(&sink.input);
+        Clock clock{1, {&counter.step, &counter.cin, &counter.reg}};
+        ProbeSet probes{};
+        size_t const q = probes.add(&counter.q, {4, 1});
+        size_t const state = probes.add_register(&counter.reg, {4, 1});
+        size_t const out = probes.add_sink(&sink);
+        // While Q is 12, and one cycle after
+        ProbeOptions const window{1, 0, &counter.q, 12, 1};
+        size_t const sum = probes.add(&counter.sum, window);
+        CHECK_THROWS_WITH( probes.add(&counter.q, {0}), Catch::Contains("period of at least 1") );
+        CHECK_THROWS_WITH( probes.add_sink(&counter.adder), Catch::Contains("is not a sink") );
+        for (uint64_t cycle = 0; cycle < 10; ++cycle) {
+            clock.clock();
+            probes.sample(cycle);
+        }
+        CHECK( cycles(probes.get_samples(q)) == std::vector<uint64_t>{1, 5, 9} );
+        // The wire has the last value of the register, the register the next
+        CHECK( probes.get_samples(q)[1].value == 15 );
+        CHECK( probes.get_samples(state)[1].value == 18 );
+        CHECK( probes.get_samples(out).size() == 10 );
+        CHECK( probes.get_samples(out)[6].value == 21 );
+        CHECK( cycles(probes.get_samples(sum)) == std::vector<uint64_t>{4, 5} );
+        CHECK( probes.get_stats().samples == 3 + 3 + 10 + 2 );
+        CHECK_THROWS_WITH( probes.sample(Simulator{Netlist{&counter.step}}), Catch::Contains("not of this Simulator") );
+    }
+
+    SECTION( "Simulator" ) {
+        Accumulator accumulator{1};
+        Netlist netlist{&accumulator.step, &accumulator.acc};
+        Simulator simulator{netlist};
+        ProbeSet probes{simulator};
+        size_t const q = probes.add(&accumulator.q, {2});
+        size_t const state = probes.add_register(&accumulator.acc, {2});
+        size_t const out = probes.add_sink(&accumulator.out, {2});
+        ProbeOptions const window{1, 0, &accumulator.q, 4, 1};
+        size_t const sum = probes.add(&accumulator.sum, window);
+        CHECK_THROWS_WITH( probes.sample(0), Catch::Contains("of a Simulator") );
+        for (int cycle = 0; cycle < 4; ++cycle) {
+            simulator.clock();
+            probes.sample(simulator);
+        }
+        probes.set_enabled(q, false);
+        CHECK( !probes.is_enabled(q) );
+        for (int cycle = 0; cycle < 4; ++cycle) {
+            simulator.clock();
+            probes.sample(simulator);
+        }
+        CHECK( cycles(probes.get_samples(q)) == std::vector<uint64_t>{2, 4} );
+        CHECK( cycles(probes.get_samples(state)) == std::vector<uint64_t>{2, 4, 6, 8} );
+        // Registers are latched at the end of Simulator::clock(), sinks have
+        // the values of the cycle before
+        CHECK( probes.get_samples(state)[1].value == 4 );
+        CHECK( probes.get_samples(out)[1].value == 3 );
+        CHECK( cycles(probes.get_samples(sum)) == std::vector<uint64_t>{5, 6} );
+        Wire<1> outside{"Outside"};
+        CHECK_THROWS_WITH( probes.add(&outside), Catch::Contains("Outside is not in") );
+    }
+
+    SECTION( "Cost" ) {
+        Counters counters{1000};
+        Simulator simulator{counters.netlist};
+        ProbeSet disabled{simulator};
+        ProbeSet sparse{simulator};
+        for (Counter &counter : counters.list) {
+            disabled.set_enabled(disabled.add(&counter.sum), false);
+            sparse.add(&counter.sum, {1000});
+        }
+        BENCHMARK( "Simulator, 1000 counters, 1000 cycles" ) {
+            simulator.run(1000);
+        };
+        BENCHMARK( "Simulator, 1000 counters, 1000 cycles, 1000 disabled probes" ) {
+            for (int i = 0; i < 1000; ++i) {
+                simulator.clock();
+                disabled.sample(simulator);
+            }
+        };
+        BENCHMARK( "Simulator, 1000 counters, 1000 cycles, 1000 probes every 1000 cycles" ) {
+            for (int i = 0; i < 1000; ++i) {
+                simulator.clock();
+                sparse.sample(simulator);
+            }
+        };
+        CHECK( disabled.get_stats().samples == 0 );
+    }
+}
+
+TEST_CASE( "Recording sinks" ) {
+    using namespace cache_test;
+
+    SECTION( "Spans" ) {
+        Counter counter{};
+        RecordingSink<8> out{"Out", 16, 4};
+        counter.sum.add_targets(&out.input);
+        Clock clock{1, {&counter.step, &counter.cin, &counter.reg}};
+        for (int cycle = 0; cycle < 40; ++cycle) {
+            clock.clock();
+        }
+        CHECK( out.get_count() == 40 );
+        CHECK( out.get_first() == 0 );
+        CHECK( out.get_value(7) == 24 );
+        CHECK( out.get_value() == 120 );
+        RecordingSink<8>::Span span = out.get_span(10, 30);
+        CHECK( span.data[0] == 33 );
+        CHECK( span.size == 30 );
+        for (int cycle = 0; cycle < 40; ++cycle) {
+            clock.clock();
+        }
+        // The ring keeps the last 64 values, and wraps after value 63
+        CHECK( out.get_first() == 16 );
+        span = out.get_span(60, 20);
+        CHECK( span.size == 4 );
+        bool same = true;
+        for (uint64_t i = out.get_first(); i < out.get_count();) {
+            span = out.get_span(i, out.get_count() - i);
+            for (uint8_t value : span) {
+                same = same && value == static_cast<uint8_t>(3 * (i + 1));
+                ++i;
+            }
+        }
+        CHECK( same );
+        CHECK_THROWS_WITH( out.get_span(10, 1), Catch::Contains("does not hold values 10 to 11") );
+        CHECK_THROWS_WITH( out.get_value(80), Catch::Contains("does not hold") );
+        CHECK_THROWS_WITH( out.get_span(70, SIZE_MAX), Catch::Contains("does not hold") );
+        CHECK_THROWS_WITH( (RecordingSink<8>{"Empty", 0, 4}), Catch::Contains("at least one value") );
+    }
+
+    SECTION( "Consumer" ) {
+        Counter counter{};
+        std::vector<uint64_t> firsts{};
+        uint64_t total = 0;
+        uint64_t next = 0;
+        bool in_order = true;
+        {
+            RecordingSink<8> out{"Out", 64, 2, [&](uint64_t first, uint8_t const *values, size_t count) {
+                in_order = in_order && first == next;
+                next = first + count;
+                firsts.push_back(first);
+                for (size_t i = 0; i < count; ++i) {
+                    total += values[i];
+                }
+            }};
+            counter.sum.add_targets(&out.input);
+            Clock clock{1, {&counter.step, &counter.cin, &counter.reg}};
+            for (int cycle = 0; cycle < 1000; ++cycle) {
+                clock.clock();
+            }
+            out.flush();
+            CHECK( next == 1000 );
+            clock.clock();
+        }
+        uint64_t expected = 0;
+        for (uint64_t i = 0; i < 1001; ++i) {
+            expected += static_cast<uint8_t>(3 * (i + 1));
+        }
+        CHECK( in_order );
+        CHECK( total == expected );
+        CHECK( firsts.size() == 1000 / 64 + 2 );
+    }
+
+    SECTION( "Simulator" ) {
+        Counter counter{};
+        RecordingSink<8> out{"Out"};
+        counter.sum.add_targets(&out.input);
+        Netlist netlist{&counter.step, &counter.cin, &counter.reg};
+        Simulator simulator{netlist};
+        simulator.run(5);
+        CHECK( simulator.get_sink(&out) == 15 );
+        // The compiled design records as the Clock does
+        REQUIRE( out.get_count() == 5 );
+        for (uint64_t i = 0; i < 5; ++i) {
+            CHECK( out.get_value(i) == 3 * (i + 1) );
+        }
+        CHECK( !is_shareable(simulator.get_program()) );
+        CHECK_THROWS_WITH( simulator.fork(), Catch::Contains("can not be forked") );
+    }
+
+    SECTION( "Checking outputs" ) {
+        Counters counters{100};
+        std::list<Sink<8>> sinks(100);
+        std::list<RecordingSink<8>> recording{};
+        auto sink = sinks.begin();
+        for (Counter &counter : counters.list) {
+            recording.emplace_back("Out", 1024, 2);
+            counter.sum.add_targets({&sink->input, &recording.back().input});
+            ++sink;
+        }
+        Clock clock{1, counters.clockables};
+        BENCHMARK( "100 counters, 1000 cycles, Sink read every cycle" ) {
+            uint64_t total = 0;
+            for (int i = 0; i < 1000; ++i) {
+                clock.clock();
+                for (Sink<8> const &s : sinks) {
+                    total += s.get_value().get_value();
+                }
+            }
+            return total;
+        };
+        BENCHMARK( "100 counters, 1000 cycles, RecordingSink read after" ) {
+            for (int i = 0; i < 1000; ++i) {
+                clock.clock();
+            }
+            uint64_t total = 0;
+            for (RecordingSink<8> const &r : recording) {
+                uint64_t const first = r.get_count() - 1000;
+                for (uint64_t i = first; i < r.get_count();) {
+                    RecordingSink<8>::Span span = r.get_span(i, r.get_count() - i);
+                    for (uint8_t value : span) {
+                        total += value;
+                    }
+                    i += span.size;
+                }
+            }
+            return total;
+        };
+    }
+}
+
+namespace stream_test {
+
+// Sum = A + 5, with A from a stream
+struct Design {
+    explicit Design(InputStream<8> *(*make)(Wire<8> *wire)): a{make(&a_wire)} {
+        a_wire.add_targets(&adder.A);
+        five_wire.add_targets(&adder.B);
+        carry.add_targets(&adder.Cin);
+        sum.add_targets(&out.input);
+    }
+
+    Wire<8> a_wire{"A"};
+    Wire<8> five_wire{"Five"};
+    Wire<1> carry{"Carry"};
+    Wire<8> sum{"Sum"};
+    std::unique_ptr<InputStream<8>> a;
+    Constant<8> five{5, &five_wire};
+    Constant<1> cin{0, &carry};
+    Adder<8> adder{&sum, "Adder"};
+    Sink<8> out{"Out"};
+};
+
+}  // namespace stream_test
+
+TEST_CASE( "Input streams" ) {
+    using stream_test::Design;
+    static std::vector<uint8_t> stimulus{};
+    stimulus.resize(1000);
+    for (size_t i = 0; i < stimulus.size(); ++i) {
+        stimulus[i] = static_cast<uint8_t>(i * 7);
+    }
+    {
+        std::ofstream file{"test_stimulus.bin", std::ios::binary};
+        file.write(reinterpret_cast<char const*>(stimulus.data()), stimulus.size());
+    }
+    auto from_file = [](Wire<8> *wire) { return new InputStream<8>{"test_stimulus.bin", wire}; };
+    auto from_buffer = [](Wire<8> *wire) { return new InputStream<8>{stimulus.data(), stimulus.size(), wire}; };
+
+    SECTION( "Clock" ) {
+        for (auto make : {+from_file, +from_buffer}) {
+            Design design{make};
+            Clock clock{1, {design.a.get(), &design.five, &design.cin}};
+            bool same = true;
+            for (size_t cycle = 0; cycle < 1010; ++cycle) {
+                clock.clock();
+                uint8_t const a = stimulus[std::min<size_t>(cycle, 999)];
+                same = same && design.out.get_value() == static_cast<uint8_t>(a + 5);
+            }
+            CHECK( same );
+            CHECK( design.a->is_done() );
+            CHECK( design.a->get(5) == 35 );
+        }
+    }
+
+    SECTION( "Simulator" ) {
+        Design design{+from_file};
+        Netlist netlist{design.a.get(), &design.five, &design.cin};
+        Simulator simulator{netlist};
+        CHECK( simulator.get_program().inputs.size() == 1 );
+        CHECK( is_shareable(simulator.get_program()) );
+        bool same = true;
+        for (size_t cycle = 0; cycle < 1000; ++cycle) {
+            simulator.clock();
+            same = same && simulator.get_sink(&design.out) == static_cast<uint8_t>(stimulus[cycle] + 5);
+        }
+        CHECK( same );
+
+        // The Simulator reads the stream itself, also in run() and when lifted
+        Simulator runner{netlist};
+        runner.run(500);
+        CHECK( runner.get_sink(&design.out) == static_cast<uint8_t>(stimulus[499] + 5) );
+        Program lifted = compile(netlist);
+        lift_words(lifted);
+        Simulator lifted_runner{std::move(lifted)};
+        lifted_runner.run(700);
+        CHECK( lifted_runner.get_sink(&design.out) == static_cast<uint8_t>(stimulus[699] + 5) );
+        CHECK( design.a->get_position() == 0 );
+    }
+
+    SECTION( "Errors" ) {
+        Wire<16> wide{"Wide"};
+        CHECK_THROWS_WITH( (InputStream<16>{"test_stimulus_missing.bin", &wide}), Catch::Contains("can not be opened") );
+        { std::ofstream file{"test_stimulus_odd.bin"}; file << "abc"; }
+        CHECK_THROWS_WITH( (InputStream<16>{"test_stimulus_odd.bin", &wide}), Catch::Contains("16 bit values") );
+        { std::ofstream file{"test_stimulus_odd.bin"}; }
+        CHECK_THROWS_WITH( (InputStream<16>{"test_stimulus_odd.bin", &wide}), Catch::Contains("has no values") );
+        std::remove("test_stimulus_odd.bin");
+        CHECK_THROWS_WITH( (InputStream<16>{nullptr, 0, &wide}), Catch::Contains("at least one value") );
+
+        // A Clockable driving a wire which is not an InputSource
+        struct Driver: public Clockable {
+            explicit Driver(Wire<16> *wire): wire{wire} {}
+            Driver(Driver const &) = delete;
+            Driver &operator=(Driver const &) = delete;
+            void clock() override {}
+            void start_set_chain() override { wire->set(1); }
+            void start_reset_chain() override { wire->reset(); }
+            std::vector<Net*> get_start_wires() override { return {wire}; }
+            Wire<16> *wire;
+        };
+        Driver driver{&wide};
+        Netlist netlist{&driver};
+        CHECK_THROWS_WITH( Simulator{netlist}, Catch::Contains("can be compiled") );
+    }
+
+    SECTION( "Streaming" ) {
+        // 4 MB of stimulus through a Simulator
+        {
+            std::vector<uint8_t> big(1 << 22);
+            for (size_t i = 0; i < big.size(); ++i) {
+                big[i] = static_cast<uint8_t>(i * 13);
+            }
+            std::ofstream file{"test_stimulus.bin", std::ios::binary};
+            file.write(reinterpret_cast<char const*>(big.data()), big.size());
+        }
+        Design design{+from_file};
+        Netlist netlist{design.a.get(), &design.five, &design.cin};
+        Program constant_input = compile(netlist);
+        constant_input.inputs.clear();
+        Simulator constant{std::move(constant_input)};
+        Simulator simulator{netlist};
+        BENCHMARK( "Simulator, 4M cycles" ) {
+            constant.run(1 << 22);
+        };
+        BENCHMARK( "Simulator, 4M cycles from a mapped stimulus file" ) {
+            uint64_t const first = simulator.get_cycle();
+            simulator.run(1 << 22);
+            return simulator.get_cycle() - first;
+        };
+    }
+    std::remove("test_stimulus.bin");
+}
+
+TEST_CASE( "Stimulus feeds" ) {
+    using namespace cache_test;
+    // A + 5, with A from a feed
+    struct Design {
+        Design(size_t depth, size_t batch): a{&a_wire, depth, batch} {
+            a_wire.add_targets(&adder.A);
+            five_wire.add_targets(&adder.B);
+            carry.add_targets(&adder.Cin);
+            sum.add_targets(&out.input);
+        }
+        Wire<8> a_wire{"A"};
+        Wire<8> five_wire{"Five"};
+        Wire<1> carry{"Carry"};
+        Wire<8> sum{"Sum"};
+        StimulusFeed<8> a;
+        Constant<8> five{5, &five_wire};
+        Constant<1> cin{0, &carry};
+        Adder<8> adder{&sum, "Adder"};
+        Sink<8> out{"Out"};
+    };
+    auto generate = [](StimulusFeed<8> &feed, size_t count) {
+        std::vector<uint8_t> values(100);
+        for (size_t first = 0; first < count; first += values.size()) {
+            for (size_t i = 0; i < values.size(); ++i) {
+                values[i] = static_cast<uint8_t>((first + i) * 7);
+            }
+            feed.push(values.data(), std::min(values.size(), count - first));
+        }
+        feed.close();
+    };
+
+    SECTION( "Clock" ) {
+        // A small ring, so both sides wait
+        Design design{64, 16};
+        std::thread generator{[&]() { generate(design.a, 100000); }};
+        Clock clock{1, {&design.a, &design.five, &design.cin}};
+        bool same = true;
+        for (size_t cycle = 0; cycle < 100010; ++cycle) {
+            clock.clock();
+            uint8_t const a = static_cast<uint8_t>(std::min<size_t>(cycle, 99999) * 7);
+            same = same && design.out.get_value() == static_cast<uint8_t>(a + 5);
+        }
+        generator.join();
+        CHECK( same );
+        CHECK( design.a.is_done() );
+    }
+
+    SECTION( "Simulator" ) {
+        Design design{1 << 10, 64};
+        std::thread generator{[&]() { generate(design.a, 5000); }};
+        Netlist netlist{&design.a, &design.five, &design.cin};
+        Simulator simulator{netlist};
+        CHECK( !is_shareable(simulator.get_program()) );
+        bool same = true;
+        for (size_t cycle = 0; cycle < 5000; ++cycle) {
+            simulator.clock();
+            same = same && simulator.get_sink(&design.out) == static_cast<uint8_t>(cycle * 7 + 5);
+        }
+        generator.join();
+        CHECK( same );
+        CHECK( !design.a.is_done() );
+        design.a.next();
+        CHECK( design.a.is_done() );
+        // Once done, the feed does not wait for values again
+        uint64_t const stalls = design.a.get_consumer_stalls();
+        simulator.run(10);
+        CHECK( design.a.get_consumer_stalls() == stalls );
+        CHECK( simulator.get_sink(&design.out) == static_cast<uint8_t>(4999 * 7 + 5) );
+        CHECK_THROWS_WITH( (Design{16, 32}), Catch::Contains("1 to depth values") );
+    }
+
+    SECTION( "Forks" ) {
+        // Forks would take turns at the values of the one feed
+        Design design{1 << 10, 64};
+        Netlist netlist{&design.a, &design.five, &design.cin};
+        Simulator simulator{netlist};
+        CHECK( !simulator.is_replayable() );
+        CHECK_THROWS_WITH( simulator.fork(), Catch::Contains("can not be forked") );
+        CHECK_THROWS_WITH( run_forks(simulator, 2, 1, [](size_t, Simulator &) {}),
+            Catch::Contains("can not be forked") );
+        Farm farm{simulator};
+        CHECK_THROWS_WITH( farm.run_jobs(2, [](size_t, Simulator &) {}),
+            Catch::Contains("can not be forked") );
+        CHECK_THROWS_WITH( Checkpointer{simulator}, Catch::Contains("can not be checkpointed") );
+        CHECK( design.a.get_consumer_stalls() == 0 );
+    }
+
+    SECTION( "Pipelining" ) {
+        // Stimulus about as expensive as the simulation
+        auto expensive = [](uint64_t i) {
+            uint64_t x = i + 1;
+            for (int k = 0; k < 20; ++k) {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+            }
+            return static_cast<uint8_t>(x);
+        };
+        size_t const CYCLES = 100000;
+        BENCHMARK( "Simulator, 100000 cycles, stimulus made in the loop" ) {
+            Design design{1 << 14, 256};
+            Netlist netlist{&design.a, &design.five, &design.cin};
+            Program program = compile(netlist);
+            program.inputs.clear();
+            Simulator simulator{std::move(program)};
+            Location const a = simulator.get_program().state_slots.at(&design.a);
+            for (size_t cycle = 0; cycle < CYCLES; ++cycle) {
+                simulator.write(a, expensive(cycle));
+                simulator.clock();
+            }
+            return simulator.get_sink(&design.out);
+        };
+        BENCHMARK( "Simulator, 100000 cycles, stimulus from a generator thread" ) {
+            Design design{1 << 14, 256};
+            std::thread generator{[&]() {
+                uint8_t values[256];
+                for (size_t first = 0; first < CYCLES; first += 256) {
+                    for (size_t i = 0; i < 256; ++i) {
+                        values[i] = expensive(first + i);
+                    }
+                    design.a.push(values, std::min<size_t>(256, CYCLES - first));
+                }
+                design.a.close();
+            }};
+            Netlist netlist{&design.a, &design.five, &design.cin};
+            Simulator simulator{netlist};
+            simulator.run(CYCLES);
+            generator.join();
+            return simulator.get_sink(&design.out);
+        };
+    }
+}
+
+TEST_CASE( "Golden checker" ) {
+    using namespace cache_test;
+
+    SECTION( "First difference" ) {
+        std::vector<uint8_t> a(300, 1);
+        std::vector<uint8_t> b(300, 1);
+        CHECK( first_difference(a.data(), b.data(), 300) == 300 );
+        for (size_t at : {0, 63, 64, 130, 299}) {
+            b[at] = 2;
+            CHECK( first_difference(a.data(), b.data(), 300) == at );
+            b[at] = 1;
+        }
+    }
+
+    SECTION( "Sinks" ) {
+        Counter counter{};
+        RecordingSink<8> sum{"Sum", 64, 4};
+        RecordingSink<8> q{"Q", 64, 4};
+        counter.sum.add_targets(&sum.input);
+        counter.q.add_targets(&q.input);
+        std::vector<uint8_t> expected_sum(1000);
+        std::vector<uint8_t> expected_q(1000);
+        for (size_t i = 0; i < 1000; ++i) {
+            expected_sum[i] = static_cast<uint8_t>(3 * (i + 1));
+            expected_q[i] = static_cast<uint8_t>(3 * i);
+        }
+        expected_q[700] = 0;
+        expected_sum[900] = 0;
+        {
+            std::ofstream file{"test_golden.bin", std::ios::binary};
+            file.write(reinterpret_cast<char const*>(expected_q.data()), expected_q.size());
+        }
+        GoldenChecker checker{};
+        CHECK( checker.add("Sum", sum, expected_sum.data(), expected_sum.size()) == 0 );
+        CHECK( checker.add("Q", q, "test_golden.bin") == 1 );
+        Clock clock{1, {&counter.step, &counter.cin, &counter.reg}};
+        std::vector<Mismatch> mismatches{};
+        for (int cycle = 1; cycle <= 1100; ++cycle) {
+            clock.clock();
+            if (cycle % 100 != 0)
+                continue;
+            Mismatch const mismatch = checker.check();
+            if (mismatch.found)
+                mismatches.push_back(mismatch);
+        }
+        REQUIRE( mismatches.size() == 2 );
+        CHECK( mismatches[0].cycle == 700 );
+        CHECK( checker.get_name(mismatches[0].signal) == "Q" );
+        CHECK( mismatches[0].expected == 0 );
+        CHECK( mismatches[0].actual == static_cast<uint8_t>(2100) );
+        CHECK( mismatches[1].cycle == 900 );
+        CHECK( mismatches[1].signal == 0 );
+        // Up to the end of the expected values
+        CHECK( checker.get_checked(0) == 1000 );
+
+        for (int cycle = 0; cycle < 300; ++cycle) {
+            clock.clock();
+        }
+        GoldenChecker late{};
+        late.add("Sum", sum, expected_sum.data(), expected_sum.size());
+        CHECK( late.get_checked(0) == 1144 );
+        std::remove("test_golden.bin");
+    }
+
+    SECTION( "Overwritten" ) {
+        Counter counter{};
+        RecordingSink<8> sum{"Sum", 16, 2};
+        counter.sum.add_targets(&sum.input);
+        std::vector<uint8_t> expected(100);
+        GoldenChecker checker{};
+        checker.add("Sum", sum, expected.data(), expected.size());
+        Clock clock{1, {&counter.step, &counter.cin, &counter.reg}};
+        for (int cycle = 0; cycle < 40; ++cycle) {
+            clock.clock();
+        }
+        CHECK_THROWS_WITH( checker.check(), Catch::Contains("Sum: values from 0 were overwritten") );
+    }
+
+    SECTION( "Mismatches in one check" ) {
+        std::vector<uint16_t> actual(1000, 7);
+        std::vector<uint16_t> expected_a(1000, 7);
+        std::vector<uint16_t> expected_b(1000, 7);
+        expected_a[500] = 1;
+        expected_b[10] = 2;
+        for (bool a_first : {true, false}) {
+            GoldenChecker checker{};
+            size_t const a = a_first ? checker.add("A", actual, expected_a.data(), 1000) : 1;
+            size_t const b = checker.add("B", actual, expected_b.data(), 1000);
+            if (!a_first)
+                checker.add("A", actual, expected_a.data(), 1000);
+            Mismatch const first = checker.check();
+            CHECK( first.found );
+            CHECK( first.signal == b );
+            CHECK( first.cycle == 10 );
+            Mismatch const second = checker.check();
+            CHECK( second.found );
+            CHECK( second.signal == a );
+            CHECK( second.cycle == 500 );
+            CHECK_FALSE( checker.check().found );
+            CHECK( checker.get_checked(a) == 1000 );
+            CHECK( checker.get_checked(b) == 1000 );
+        }
+    }
+
+    SECTION( "1M cycles" ) {
+        size_t const CYCLES = 1 << 20;
+        std::vector<std::vector<uint32_t>> actual(4, std::vector<uint32_t>(CYCLES));
+        std::vector<std::vector<uint32_t>> expected(4);
+        for (size_t signal = 0; signal < 4; ++signal) {
+            for (size_t i = 0; i < CYCLES; ++i) {
+                actual[signal][i] = static_cast<uint32_t>(i * (signal + 1));
+            }
+            expected[signal] = actual[signal];
+        }
+        expected[2][CYCLES - 10] = 0;
+        BENCHMARK( "4 signals, 1M cycles, compared one value at a time" ) {
+            for (uint64_t i = 0; i < CYCLES; ++i) {
+                for (size_t signal = 0; signal < 4; ++signal) {
+                    if (actual[signal][i] != expected[signal][i])
+                        return i;
+                }
+            }
+            return uint64_t{0};
+        };
+        BENCHMARK( "4 signals, 1M cycles, GoldenChecker" ) {
+            GoldenChecker checker{};
+            for (size_t signal = 0; signal < 4; ++signal) {
+                checker.add("S" + std::to_string(signal), actual[signal], expected[signal].data(), CYCLES);
+            }
+            return checker.check().cycle;
+        };
+        GoldenChecker checker{};
+        for (size_t signal = 0; signal < 4; ++signal) {
+            checker.add("S" + std::to_string(signal), actual[signal], expected[signal].data(), CYCLES);
+        }
+        Mismatch const mismatch = checker.check();
+        CHECK( mismatch.cycle == CYCLES - 10 );
+        CHECK( mismatch.signal == 2 );
+    }
+}
+
+TEST_CASE( "Watchpoints" ) {
+    using namespace cache_test;
+
+    SECTION( "Expressions" ) {
+        Wire<8> a{"A"};
+        Wire<8> b{"B"};
+        std::unordered_map<std::string, WatchSignal> const names{{"a", &a}, {"b", &b}};
+        auto holds = [&](std::string const &expression, uint64_t a_value, uint64_t b_value) {
+            Watch const watch{expression, names};
+            std::vector<uint64_t> values{};
+            for (WatchSignal const &signal : watch.get_signals()) {
+                values.push_back((signal.net == &a) ? a_value : b_value);
+            }
+            return watch.evaluate(values.data());
+        };
+        CHECK( holds("a == 0x42 && b == 1", 0x42, 1) );
+        CHECK( !holds("a == 0x42 && b == 1", 0x42, 0) );
+        CHECK( holds("a == 3 || b", 0, 7) );
+        CHECK( !holds("!(a == 3 || b)", 0, 7) );
+        CHECK( holds("a < b && b <= 5 && !(a >= b) && b > 0b100 && a != 9", 2, 5) );
+        CHECK( holds("a == b", 4, 4) );
+        CHECK( holds("(a == 1 || a == 2) && (b == 1 || b == 2) || a == 9", 2, 1) );
+        CHECK( holds("a==1||b==2&&a==3", 1, 0) );
+        CHECK( Watch{"a == b && a", names}.get_signals().size() == 2 );
+        CHECK_THROWS_WITH( (Watch{"a == c", names}), Catch::Contains("unknown name c at 5") );
+        CHECK_THROWS_WITH( (Watch{"a == 0xZZ", names}), Catch::Contains("expected a number at 5") );
+        CHECK_THROWS_WITH( (Watch{"(a == 1", names}), Catch::Contains("expected )") );
+        CHECK_THROWS_WITH( (Watch{"a == 1 b", names}), Catch::Contains("expected && or ||") );
+        CHECK_THROWS_WITH( (Watch{"a == ", names}), Catch::Contains("expected a name or a number") );
+    }
+
+    SECTION( "Simulator and Clock" ) {
+        Counter counter{};
+        Watch const watch{"reg == 30 && carry == 0", {{"reg", &counter.reg}, {"carry", &counter.carry}}};
+        Netlist netlist{&counter.step, &counter.cin, &counter.reg};
+        Simulator simulator{netlist};
+        WatchResult result = run_until(simulator, watch, 100);
+        CHECK( result.hit );
+        CHECK( result.cycles == 10 );
+        CHECK( simulator.get_state(&counter.reg) == 30 );
+        // It wraps around after 256 / gcd(3, 256) cycles
+        result = run_until(simulator, watch, 1000);
+        CHECK( result.cycles == 256 );
+        CHECK( !run_until(simulator, watch, 5).hit );
+
+        Clock clock{1, {&counter.step, &counter.cin, &counter.reg}};
+        Watch const wire_watch{"q == 27", {{"q", &counter.q}}};
+        result = run_until(clock, wire_watch, 100);
+        CHECK( result.hit );
+        // The wire has the value of the cycle, the register the next state
+        CHECK( result.cycles == 10 );
+        CHECK( counter.reg.get_raw_state() == 30 );
+        // The net of a register and a wire computed from it are of the same
+        // cycle, in a Simulator as on a Clock
+        Counter fresh{};
+        Clock fresh_clock{1, {&fresh.step, &fresh.cin, &fresh.reg}};
+        Watch const mixed{"q == 24 && sum == 27", {{"q", &fresh.q}, {"sum", &fresh.sum}}};
+        CHECK( run_until(fresh_clock, mixed, 100).cycles == 9 );
+        Counter compiled{};
+        Netlist compiled_netlist{&compiled.step, &compiled.cin, &compiled.reg};
+        Simulator compiled_simulator{compiled_netlist};
+        Watch const compiled_mixed{"q == 24 && sum == 27", {{"q", &compiled.q}, {"sum", &compiled.sum}}};
+        CHECK( run_until(compiled_simulator, compiled_mixed, 100).cycles == 9 );
+        Wire<1> outside{"Outside"};
+        CHECK_THROWS_WITH( run_until(simulator, Watch("o", {{"o", &outside}}), 1), Catch::Contains("Outside is not in") );
+    }
+
+    SECTION( "Cost" ) {
+        Counters counters{100};
+        Simulator simulator{counters.netlist};
+        Counter &first = counters.list.front();
+        Counter &last = counters.list.back();
+        // Never true, the counters are in step
+        Watch const watch{"a == 1 && b == 2 || a == 200 && b != 200",
+            {{"a", &first.reg}, {"b", &last.reg}}};
+        BENCHMARK( "Simulator, 100 counters, 100000 cycles" ) {
+            simulator.run(100000);
+        };
+        BENCHMARK( "Simulator, 100 counters, 100000 cycles, polled by the caller" ) {
+            for (int i = 0; i < 100000; ++i) {
+                simulator.clock();
+                uint64_t const a = simulator.get_state(&first.reg);
+                uint64_t const b = simulator.get_state(&last.reg);
+                if ((a == 1 && b == 2) || (a == 200 && b != 200))
+                    return i;
+            }
+            return 0;
+        };
+        BENCHMARK( "Simulator, 100 counters, 100000 cycles, watched" ) {
+            return run_until(simulator, watch, 100000).cycles;
+        };
+    }
+}
+
+TEST_CASE( "Temporal assertions" ) {
+    using namespace cache_test;
+
+    SECTION( "Simulator" ) {
+        Counter counter{};
+        Netlist netlist{&counter.step, &counter.cin, &counter.reg};
+        Simulator simulator{netlist};
+        AssertionSet assertions{simulator, {{"q", &counter.q}, {"reg", &counter.reg}, {"carry", &counter.carry}}};
+        // Q steps by 3 every cycle
+        size_t const holds = assertions.add("Two steps", "q == 3", "q == 9", 2, 2);
+        size_t const late = assertions.add("One step", "q == 3", "q == 9", 0, 1);
+        size_t const window = assertions.add("Within", "q == 30", "q >= 36 && q < 40", 1, 4);
+        size_t const never = assertions.add_never("Never 60", "reg == 60");
+        size_t const always = assertions.add_always("No carry", "carry == 0");
+        CHECK_THROWS_WITH( assertions.add("Bad", "q", "q", 2, 1), Catch::Contains("the window is") );
+        CHECK_THROWS_WITH( assertions.add("Long", "q", "q", 0, 64), Catch::Contains("<= 63 cycles") );
+        CHECK_THROWS_WITH( assertions.add("Unknown", "x", "q", 0, 1), Catch::Contains("unknown name x") );
+        for (int cycle = 0; cycle < 30; ++cycle) {
+            simulator.clock();
+            assertions.sample(simulator);
+        }
+        std::vector<AssertionFailure> const &failures = assertions.get_failures();
+        REQUIRE( failures.size() == 2 );
+        // Q is 3 in cycle 2, the window of One step ends in cycle 3
+        CHECK( failures[0].assertion == late );
+        CHECK( failures[0].start == 2 );
+        CHECK( failures[0].cycle == 3 );
+        // Reg is 60 after cycle 20
+        CHECK( assertions.get_name(failures[1].assertion) == "Never 60" );
+        CHECK( failures[1].cycle == 20 );
+        CHECK( holds + window + never + always > 0 );
+        CHECK( assertions.get_pending() == 0 );
+        CHECK_THROWS_WITH( assertions.add("After", "q", "q", 0, 1), Catch::Contains("before the first sample") );
+    }
+
+    SECTION( "Clock" ) {
+        Counter counter{};
+        Clock clock{1, {&counter.step, &counter.cin, &counter.reg}};
+        AssertionSet assertions{{{"q", &counter.q}}};
+        assertions.add("Soon", "q == 6", "q == 12", 1, 3);
+        assertions.add("Never", "q == 6", "q == 100", 1, 3);
+        for (uint64_t cycle = 0; cycle < 10; ++cycle) {
+            clock.clock();
+            assertions.sample(cycle);
+        }
+        REQUIRE( assertions.get_failures().size() == 1 );
+        CHECK( assertions.get_failures()[0].assertion == 1 );
+        CHECK( assertions.get_failures()[0].start == 2 );
+        CHECK( assertions.get_failures()[0].cycle == 5 );
+        CHECK_THROWS_WITH( assertions.sample(Simulator{Netlist{&counter.step}}), Catch::Contains("not of this Simulator") );
+    }
+
+    SECTION( "Words and generic conditions" ) {
+        Counter counter{};
+        Netlist netlist{&counter.step, &counter.cin, &counter.reg};
+        Simulator simulator{netlist};
+        AssertionSet assertions{simulator, {{"q", &counter.q}, {"sum", &counter.sum}}};
+        // Over three words, which all hold
+        for (int i = 0; i < 130; ++i) {
+            int const q = 3 * (i % 40);
+            assertions.add("Step " + std::to_string(i), "q == " + std::to_string(q),
+                "q == " + std::to_string(q + 3), 1, 1);
+        }
+        size_t const wrong = assertions.add("Wrong", "q == 9", "q == 15", 1, 1);
+        // Of two signals, so not a table
+        size_t const generic = assertions.add("Generic", "q == 12", "q > 100 || sum > 200", 0, 0);
+        for (int cycle = 0; cycle < 30; ++cycle) {
+            simulator.clock();
+            assertions.sample(simulator);
+        }
+        std::vector<AssertionFailure> failures = assertions.get_failures();
+        REQUIRE( failures.size() == 2 );
+        std::sort(failures.begin(), failures.end(),
+            [](AssertionFailure const &a, AssertionFailure const &b) { return a.assertion < b.assertion; });
+        CHECK( failures[0].assertion == wrong );
+        CHECK( failures[0].start == 4 );
+        CHECK( failures[0].cycle == 5 );
+        CHECK( failures[1].assertion == generic );
+        CHECK( failures[1].start == 5 );
+        CHECK( failures[1].cycle == 5 );
+        // Q is 87 in cycle 30, for three of the steps
+        CHECK( assertions.get_pending() == 3 );
+    }
+
+    SECTION( "Cost" ) {
+        Counters counters{100};
+        std::unordered_map<std::string, WatchSignal> names{};
+        int index = 0;
+        for (Counter &counter : counters.list) {
+            names.emplace("q" + std::to_string(index++), &counter.q);
+        }
+        Simulator simulator{counters.netlist};
+        // 200 assertions which hold, two per counter
+        AssertionSet assertions{simulator, names};
+        for (int i = 0; i < 100; ++i) {
+            std::string const q = "q" + std::to_string(i);
+            assertions.add(q + " steps", q + " == 3", q + " == 12", 1, 4);
+            assertions.add(q + " wraps", q + " > 250", q + " < 10", 1, 2);
+        }
+        BENCHMARK( "Simulator, 100 counters, 10000 cycles" ) {
+            simulator.run(10000);
+        };
+        BENCHMARK( "Simulator, 100 counters, 10000 cycles, 200 assertions checked in C++" ) {
+            // The obligations of each assertion, the cycles they started in
+            std::vector<std::deque<uint64_t>> open(200);
+            uint64_t failed = 0;
+            std::vector<Location> qs{};
+            for (Counter &counter : counters.list) {
+                qs.push_back(simulator.get_program().net_slots.at(&counter.q));
+            }
+            for (int i = 0; i < 10000; ++i) {
+                simulator.clock();
+                uint64_t const cycle = simulator.get_cycle();
+                for (size_t c = 0; c < 100; ++c) {
+                    uint64_t const q = simulator.read(qs[c]);
+                    std::deque<uint64_t> &steps = open[2 * c];
+                    std::deque<uint64_t> &wraps = open[2 * c + 1];
+                    if (q == 12) {
+                        while (!steps.empty() && cycle - steps.front() >= 1)
+                            steps.pop_front();
+                    }
+                    while (!steps.empty() && cycle - steps.front() > 4) {
+                        steps.pop_front();
+                        ++failed;
+                    }
+                    if (q == 3)
+                        steps.push_back(cycle);
+                    if (q < 10) {
+                        while (!wraps.empty() && cycle - wraps.front() >= 1)
+                            wraps.pop_front();
+                    }
+                    while (!wraps.empty() && cycle - wraps.front() > 2) {
+                        wraps.pop_front();
+                        ++failed;
+                    }
+                    if (q > 250)
+                        wraps.push_back(cycle);
+                }
+            }
+            return failed;
+        };
+        BENCHMARK( "Simulator, 100 counters, 10000 cycles, 200 assertions" ) {
+            for (int i = 0; i < 10000; ++i) {
+                simulator.clock();
+                assertions.sample(simulator);
+            }
+        };
+        CHECK( assertions.get_failures().empty() );
+    }
 }